@@ -1,14 +1,51 @@
 #ifndef MINIFETCH_CLI_H
 #define MINIFETCH_CLI_H
 
+#define MF_WATCH_DEFAULT_INTERVAL 2U
+/* Terminals one hidden-mode render can drive (--sink, repeatable). */
+#define MF_SINKS_MAX 8U
+/* --export defaults: 12 s of animation at 10 frames per second. */
+#define MF_EXPORT_FRAMES_DEFAULT 120U
+#define MF_EXPORT_FRAME_MS_DEFAULT 100U
+#define MF_EXPORT_COLS_DEFAULT 80U
+#define MF_EXPORT_ROWS_DEFAULT 24U
+/* Seconds between hidden-mode panel re-collections (--refresh). */
+#define MF_HIDDEN_REFRESH_DEFAULT 5U
+
 struct mf_options {
     int show_all;
     int no_colour;
     int quiet;
     int help;
     int hidden;
+    int mounts_requested;
+    unsigned int mounts_top;
+    const char *mount_filter;
+    unsigned int watch_interval; /* seconds; 0 unless --watch */
+    int daemon;
+    int from_shm;
+    const char *root;        /* --root DIR */
+    const char *roots_under; /* --roots-under DIR */
+    const char *sinks[MF_SINKS_MAX]; /* --sink PATH; implies --hidden */
+    unsigned int sink_count;
+    unsigned int seed;        /* --seed N; noise field for hidden mode */
+    int gradient;             /* --gradient; an enum mf_hidden_gradient */
+    const char *engine;       /* --engine NAME|auto|list */
+    unsigned int refresh;     /* --refresh SEC; 0 freezes the panel */
+    int termcaps;             /* --termcaps: print what the terminal supports */
+    const char *record;       /* --record FILE; implies --hidden */
+    const char *replay;       /* --replay FILE */
+    const char *export_path;  /* --export FILE (.cast or .svg) */
+    unsigned int export_frames;   /* --frames N */
+    unsigned int export_frame_ms; /* --timebase MS */
+    unsigned int export_cols;     /* --size COLSxROWS */
+    unsigned int export_rows;
 };
 
+/* Fills opts with the built-in defaults. */
+void mf_cli_defaults(struct mf_options *opts);
+/* Overrides whatever opts holds (the defaults, then a config file) with
+ * the command line. Returns -1 on a bad argument. */
 int mf_cli_parse(int argc, char **argv, struct mf_options *opts);
 void mf_cli_print_usage(const char *prog);
 
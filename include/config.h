@@ -16,6 +16,23 @@
 #define CFG_SHOW_MEM     0
 #define CFG_SHOW_UPTIME  0
 #endif
+/* Samples /proc/stat for 100 ms when no recent sample is saved. */
+#define CFG_SHOW_LOAD    0
+/* Rates need a previous run (or --watch); totals are shown otherwise. */
+#define CFG_SHOW_NET     0
+#define CFG_SHOW_DISKIO  0
+/* Walks the sysfs node and cache trees. */
+#define CFG_SHOW_TOPOLOGY 0
+/* Walks every mount; shown with -a, --mounts or --mount-filter. */
+#define CFG_SHOW_MOUNTS  0
+/* Reads /proc/<pid>/stat for every process. */
+#define CFG_SHOW_PROCS   0
+/* Reads the cached sensor files; the first run of a boot walks sysfs. */
+#define CFG_SHOW_SENSORS 0
+/* Resolves the cgroup directory, then reads three pressure files. */
+#define CFG_SHOW_PRESSURE 0
+/* Processes listed per ranking on the Procs: line (at most 8). */
+#define CFG_PROCS_TOP    3
 
 /* ---------------- Colour palette ---------------- */
 #define CFG_LABEL_COLOR  "\x1b[38;5;245m"
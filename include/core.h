@@ -3,6 +3,24 @@
 
 #include <stddef.h>
 
+#define MF_PATH_OS_RELEASE "/etc/os-release"
+#define MF_PATH_HOSTNAME   "/etc/hostname"
+
+/* Identity fields of an os-release file; empty when absent. */
+struct mf_os_release {
+    char pretty[128];
+    char name[64];
+    char id[32];
+    char version_id[32];
+};
+
+/* Parses /etc/os-release (or /usr/lib/os-release) under rootfd, see
+ * mf_open_in_root. Returns -1 when neither names the OS. Linux builds
+ * with MINIFETCH_LINUX_EXT only. */
+int mf_os_release_read(int rootfd, struct mf_os_release *rel);
+/* First line of /etc/hostname under rootfd, or -1. */
+int mf_hostname_read(int rootfd, char *out, size_t outsz);
+
 int mf_collect_os(char *out, size_t outsz);
 int mf_collect_kernel(char *out, size_t outsz);
 int mf_collect_host(char *out, size_t outsz);
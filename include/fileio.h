@@ -0,0 +1,47 @@
+#ifndef MINIFETCH_FILEIO_H
+#define MINIFETCH_FILEIO_H
+
+#include <dirent.h>
+#include <stddef.h>
+
+/* Reads up to bufsz - 1 bytes of path into buf with open/read/close and
+ * NUL-terminates the result. Returns the byte count or -1. */
+long mf_read_file(const char *path, char *buf, size_t bufsz);
+
+/* Like mf_read_file, but resolves path with rootfd standing in for "/"
+ * (see mf_open_in_root). Safe to call from several threads. */
+long mf_read_file_in(int rootfd, const char *path, char *buf, size_t bufsz);
+
+/* Reads a whole file of unknown size (e.g. mountinfo on a host with
+ * thousands of mounts) into a malloc'd, NUL-terminated buffer. procfs
+ * seq files fill the whole buffer per read, so this is usually a single
+ * read(2). Returns NULL on failure; the caller frees. */
+char *mf_read_file_alloc(const char *path, size_t *len_out);
+
+/* --root (or MINIFETCH_SYSROOT): resolves every later mf_read_file,
+ * mf_read_file_alloc and mf_opendir path inside dirfd instead of the
+ * running system. AT_FDCWD (the default) restores plain paths. */
+void mf_fileio_set_root(int dirfd);
+int mf_fileio_root(void);
+
+/* Opens path as if rootfd were the root directory: openat2 with
+ * RESOLVE_IN_ROOT where available, else openat relative to rootfd with
+ * O_NOFOLLOW on the last component. O_CLOEXEC is always added. */
+int mf_open_in_root(int rootfd, const char *path, int flags);
+
+/* Directory counterparts for the collectors that walk /proc and /sys;
+ * they honour the root the same way. */
+int mf_open_dir(const char *path);
+DIR *mf_opendir(const char *path);
+
+/* With MINIFETCH_IO=uring, reads every path up front in one io_uring
+ * batch (Linux builds with MINIFETCH_IO_URING) so the following
+ * mf_read_file calls for them are served from memory. Otherwise, or when
+ * io_uring is unavailable, a no-op: mf_read_file uses plain syscalls. */
+void mf_prefetch_files(const char *const paths[], size_t count);
+
+/* Splits a NUL-terminated buffer into lines in place. Returns the next
+ * line (without its newline) and advances *cursor, or NULL at the end. */
+char *mf_next_line(char **cursor);
+
+#endif /* MINIFETCH_FILEIO_H */
@@ -0,0 +1,15 @@
+#ifndef MINIFETCH_FLEET_H
+#define MINIFETCH_FLEET_H
+
+/* --roots-under: treats every subdirectory of dir as an unpacked root
+ * filesystem and writes one tab-separated record per root to stdout as
+ * soon as it is read:
+ *
+ *     <subdir> TAB <PRETTY_NAME> TAB <ID> TAB <VERSION_ID> TAB <hostname>
+ *
+ * with "-" for anything missing. Roots are read on a small thread pool,
+ * so records arrive in completion order. Returns 0, or -1 when dir cannot
+ * be opened or the build lacks MINIFETCH_LINUX_EXT. */
+int mf_run_fleet(const char *dir);
+
+#endif /* MINIFETCH_FLEET_H */
@@ -0,0 +1,31 @@
+#ifndef MINIFETCH_FMT_H
+#define MINIFETCH_FMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bounded string builder shared by the collectors. Output is always
+ * NUL-terminated; anything past the capacity is silently dropped, the
+ * same way snprintf truncates. */
+struct mf_fmt {
+    char *buf;
+    size_t cap;
+    size_t len;
+};
+
+void mf_fmt_init(struct mf_fmt *f, char *buf, size_t cap);
+void mf_fmt_str(struct mf_fmt *f, const char *s);
+void mf_fmt_uint(struct mf_fmt *f, uint64_t v);
+/* q / 10^decimals with exactly `decimals` (0-6) fractional digits. */
+void mf_fmt_fixed(struct mf_fmt *f, uint64_t q, unsigned int decimals);
+/* IEC size with the historical "%.0f/%.1f/%.2f <unit>" precision ladder. */
+void mf_fmt_bytes(struct mf_fmt *f, uint64_t bytes);
+/* part/whole as a rounded integer percentage followed by '%'. */
+void mf_fmt_percent(struct mf_fmt *f, uint64_t part, uint64_t whole);
+/* "Nd Nh Nm", dropping leading zero units. */
+void mf_fmt_duration(struct mf_fmt *f, uint64_t seconds);
+
+/* Parses leading decimal digits; returns the number of digits consumed. */
+size_t mf_parse_u64(const char *s, uint64_t *out);
+
+#endif /* MINIFETCH_FMT_H */
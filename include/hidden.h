@@ -5,6 +5,61 @@
 
 #define MF_FORMATTED_LINE_MAX 512
 
+/* How the noise field is coloured (--gradient). */
+enum mf_hidden_gradient {
+    MF_HIDDEN_GRADIENT_MONO = 0,
+    MF_HIDDEN_GRADIENT_256 = 1,
+    MF_HIDDEN_GRADIENT_TRUECOLOR = 2
+};
+
 int mf_run_hidden_mode(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, int quiet_mode);
 
+/* Hidden mode on several terminals at once (e.g. wall displays): the
+ * noise field is rendered once per frame and each sink gets its own diff
+ * at its own size. Sinks are written without blocking; one that cannot
+ * keep up skips frames and one that goes away is dropped. Runs until
+ * SIGINT/SIGTERM, 'q' on a terminal stdin, or every sink is gone.
+ * Returns -1 if a sink cannot be opened. */
+int mf_run_hidden_broadcast(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, const char *const paths[], size_t npaths);
+
+/* Seeds the noise field (0 is the classic pattern), picks its colouring
+ * (an enum mf_hidden_gradient) and, when record_path is not NULL, makes
+ * mf_run_hidden_mode save every frame it draws there (see
+ * hidden_record.h). */
+void mf_hidden_configure(unsigned int seed, int gradient, const char *record_path);
+
+/* Lets hidden mode use what the terminal on stdout supports (an
+ * MF_TERMCAP_* mask, see termcaps.h): REP for runs of one glyph and
+ * synchronized output around large frames. Sinks and exports stick to
+ * VT100 either way. */
+void mf_hidden_set_termcaps(unsigned int flags);
+
+/* Refills formatted/widths with a freshly collected info panel (at most
+ * the max_rows given to mf_hidden_set_refresh) and returns its rows. */
+typedef size_t (*mf_hidden_collect_fn)(char formatted[][MF_FORMATTED_LINE_MAX], size_t widths[], void *ctx);
+
+/* Makes hidden mode and --sink re-collect the panel with collect every
+ * interval_s seconds on a thread of its own; each frame shows the newest
+ * panel collected. 0 keeps the panel as passed in. */
+void mf_hidden_set_refresh(mf_hidden_collect_fn collect, void *ctx, size_t max_rows, unsigned int interval_s);
+
+/* Selects the background field engine by name: "value" (the default),
+ * "simplex", "plasma", or "auto" for the richest one that fits a quarter
+ * of a frame at the screen's size on this machine. -1 if unknown. */
+int mf_hidden_set_engine(const char *name);
+/* Prints every engine with its cost per cell measured on this machine. */
+void mf_hidden_list_engines(void);
+
+/* Plays a recording back on stdout at its recorded pace, clipped to the
+ * terminal. No noise is computed. Returns -1 if the file cannot be read
+ * or turns out to be corrupt. */
+int mf_run_hidden_replay(const char *path);
+
+/* Renders frames frames, frame_ms of animation apart, at rows x cols as
+ * fast as the CPU allows and writes them as an animated SVG (path ends
+ * in ".svg") or an asciicast v2 file (anything else). The output depends
+ * only on the seed and the arguments. Returns -1 on failure. */
+int mf_run_hidden_export(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, const char *path,
+                         unsigned int frames, unsigned int frame_ms, int rows, int cols);
+
 #endif /* MINIFETCH_HIDDEN_H */
@@ -0,0 +1,92 @@
+#ifndef MINIFETCH_HIDDEN_RECORD_H
+#define MINIFETCH_HIDDEN_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "outbuf.h"
+
+/* One screen cell of hidden mode: the UTF-8 bytes drawn there and the
+ * colour ramp step they are drawn in (0 is the terminal's default). A
+ * wide glyph's second cell is empty (len 0); a zero-width glyph rides
+ * along with the cell before it. */
+struct mf_hidden_cell {
+    unsigned char len;
+    unsigned char fg;
+    char bytes[4];
+};
+
+/* Colour steps a cell's fg can name (1..MF_HIDDEN_RAMP_STEPS). */
+#define MF_HIDDEN_RAMP_STEPS 8U
+
+/* Hidden-mode recordings (--record / --replay). Only the cells that
+ * changed since the previous frame are stored:
+ *
+ *   file  := "MFR1" varint(cols) varint(rows) event*
+ *   event := 'F' varint(ms since previous frame) varint(runs) run*
+ *          | 'S' varint(cols) varint(rows)   resize; every cell blank
+ *   run   := varint(unchanged cells skipped) varint(count) cell{count}
+ *   cell  := one byte 0x20-0x7e              printable ASCII
+ *          | 0xff len byte{len}              anything else
+ *          | 0xfe fg cell                    colour change
+ *
+ * Like SGR on a terminal, a colour change holds for the cells after it
+ * until the next one; every frame starts in colour 0.
+ * Varints are unsigned LEB128 and positions run row-major, so a run may
+ * wrap onto the next row. Once the first frame is down, the slowly
+ * drifting noise field costs about half the bytes of its terminal diff. */
+#define MF_REC_DIM_MAX 4096
+
+struct mf_rec_writer {
+    struct mf_outbuf ob;
+    int rows;
+    int cols;
+    struct mf_hidden_cell *prev;
+};
+
+/* Creates path (mode 0644, truncated) for a rows x cols recording.
+ * Returns -1 on failure. */
+int mf_rec_open(struct mf_rec_writer *w, const char *path, int rows, int cols);
+/* Appends curr (rows x cols, as last opened or resized) as a frame
+ * shown dt_ms after the previous one. */
+void mf_rec_frame(struct mf_rec_writer *w, const struct mf_hidden_cell *curr, uint32_t dt_ms);
+int mf_rec_resize(struct mf_rec_writer *w, int rows, int cols);
+/* Flushes and closes; -1 if any write failed. */
+int mf_rec_close(struct mf_rec_writer *w);
+
+enum mf_rec_event {
+    MF_REC_END = 0,
+    MF_REC_FRAME = 1,
+    MF_REC_RESIZE = 2
+};
+
+struct mf_rec_reader {
+    unsigned char *data;
+    size_t len;
+    size_t pos;
+    int rows;
+    int cols;
+    struct mf_hidden_cell *cells; /* the screen after the last event */
+};
+
+int mf_rec_reader_open(struct mf_rec_reader *r, const char *path);
+/* Applies the next event to r->cells. Returns an enum mf_rec_event with
+ * the frame's delay in *dt_ms, or -1 for a truncated or corrupt file. */
+int mf_rec_reader_next(struct mf_rec_reader *r, uint32_t *dt_ms);
+void mf_rec_reader_close(struct mf_rec_reader *r);
+
+/* asciicast v2 (asciinema): a header line, then one output event per
+ * frame carrying the frame's escape sequences. */
+void mf_cast_begin(struct mf_outbuf *ob, int cols, int rows);
+void mf_cast_event(struct mf_outbuf *ob, uint64_t t_us, const char *data, size_t len);
+
+/* Animated SVG: every frame is stacked in one tall group that a CSS
+ * steps() animation scrolls past a rows-high viewport, so it plays in a
+ * browser or README with no script. */
+void mf_svg_begin(struct mf_outbuf *ob, int cols, int rows, uint32_t frames, uint32_t frame_ms);
+/* rgb[fg] is the fill for ramp step fg; step 0 keeps the default fill. */
+void mf_svg_frame(struct mf_outbuf *ob, const struct mf_hidden_cell *cells, int rows, int cols, uint32_t index,
+                  const unsigned char (*rgb)[3]);
+void mf_svg_end(struct mf_outbuf *ob);
+
+#endif /* MINIFETCH_HIDDEN_RECORD_H */
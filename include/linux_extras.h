@@ -2,8 +2,71 @@
 #define MINIFETCH_LINUX_EXTRAS_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#define MF_PATH_MEMINFO "/proc/meminfo"
+#define MF_PATH_UPTIME  "/proc/uptime"
+#define MF_PATH_STAT    "/proc/stat"
+#define MF_PATH_LOADAVG "/proc/loadavg"
+#define MF_PATH_CPUFREQ "/sys/devices/system/cpu/cpufreq"
+#define MF_PATH_PRESSURE    "/proc/pressure"
+#define MF_PATH_SELF_CGROUP "/proc/self/cgroup"
+#define MF_PATH_CGROUP2     "/sys/fs/cgroup"
+#define MF_PATH_SYS_SYSTEM  "/sys/devices/system"
+#define MF_PATH_NET_DEV     "/proc/net/dev"
+#define MF_PATH_DISKSTATS   "/proc/diskstats"
+#define MF_PATH_SYS_BLOCK   "/sys/block"
+#define MF_PATH_PROC        "/proc"
+#define MF_PATH_HWMON       "/sys/class/hwmon"
+#define MF_PATH_THERMAL     "/sys/class/thermal"
+#define MF_PATH_BOOT_ID     "/proc/sys/kernel/random/boot_id"
+#define MF_NET_STATE_NAME    "net"
+#define MF_DISKIO_STATE_NAME "diskio"
+#define MF_SENSORS_STATE_NAME "sensors"
 
 int mf_collect_mem(char *out, size_t outsz);
 int mf_collect_uptime(char *out, size_t outsz);
+/* Utilisation since the previous run (or over a short sample), per-core
+ * sparkline, load averages and mean cpufreq clock. */
+int mf_collect_load(char *out, size_t outsz);
+/* PSI avg10/avg60 for cpu, memory and io, from the caller's cgroup v2
+ * directory when it has them, else /proc/pressure. */
+int mf_collect_pressure(char *out, size_t outsz);
+/* NUMA nodes with their CPUs and memory, SMT state and cache sizes. */
+int mf_collect_topology(char *out, size_t outsz);
+/* Per-interface RX/TX and per-disk IOPS/throughput since the previous
+ * sample (saved state, or memory under --watch); totals without one. */
+int mf_collect_net(char *out, size_t outsz);
+int mf_collect_diskio(char *out, size_t outsz);
+/* Process, thread and zombie counts plus the largest processes by RSS
+ * and by lifetime CPU share, from one pass over /proc/<pid>/stat. */
+int mf_collect_procs(char *out, size_t outsz);
+/* CPU package temperatures (hwmon, else CPU thermal zones) and fan
+ * speeds. Sensor paths are found once per boot and cached. */
+int mf_collect_sensors(char *out, size_t outsz);
+
+/* Mount table summary: statvfs over every real filesystem in
+ * /proc/self/mountinfo, reported as a total plus the largest mounts. */
+#define MF_MOUNTS_TOP_DEFAULT 3U
+
+int mf_collect_mounts(char *out, size_t outsz);
+void mf_mounts_configure(unsigned int top_n, const char *filter);
+
+/* cgroup v2 limits that apply to this process, 0 meaning unlimited or
+ * unknown. Only available in Linux builds with MINIFETCH_LINUX_EXT. */
+struct mf_cgroup_limits {
+    uint64_t cpu_milli;        /* tightest cpu.max quota, in 1/1000 CPU */
+    unsigned int cpuset_count; /* CPUs in cpuset.cpus.effective */
+    uint64_t mem_max;          /* tightest memory.max, in bytes */
+};
+
+/* The process's cgroup v2 directory with a trailing slash, or NULL. */
+const char *mf_cgroup_dir(void);
+/* Scanned once per process; never NULL. */
+const struct mf_cgroup_limits *mf_cgroup_limits(void);
+int mf_cgroup_memory_current(uint64_t *bytes);
+
+/* Counts the CPUs in a sysfs list such as "0-3,8,10-11". */
+unsigned int mf_cpulist_count(const char *list);
 
 #endif /* MINIFETCH_LINUX_EXTRAS_H */
@@ -0,0 +1,33 @@
+#ifndef MINIFETCH_OUTBUF_H
+#define MINIFETCH_OUTBUF_H
+
+#include <stddef.h>
+
+/* A byte span whose length is known up front, e.g. a colour escape. */
+struct mf_span {
+    const char *ptr;
+    size_t len;
+};
+
+#define MF_SPAN_LIT(s) { (s), sizeof(s) - 1U }
+
+/* Caller-provided output arena. Bytes accumulate in storage and reach fd
+ * in as few write(2) calls as possible: once on mf_outbuf_flush, or early
+ * only when the arena fills up. */
+struct mf_outbuf {
+    char *data;
+    size_t len;
+    size_t cap;
+    int fd;
+    int error;
+};
+
+void mf_outbuf_init(struct mf_outbuf *ob, char *storage, size_t cap, int fd);
+void mf_outbuf_put(struct mf_outbuf *ob, const char *s, size_t n);
+void mf_outbuf_puts(struct mf_outbuf *ob, const char *s);
+void mf_outbuf_span(struct mf_outbuf *ob, const struct mf_span *span);
+void mf_outbuf_fill(struct mf_outbuf *ob, char c, size_t n);
+int mf_outbuf_flush(struct mf_outbuf *ob);
+int mf_write_all(int fd, const char *buf, size_t len);
+
+#endif /* MINIFETCH_OUTBUF_H */
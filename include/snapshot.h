@@ -0,0 +1,45 @@
+#ifndef MINIFETCH_SNAPSHOT_H
+#define MINIFETCH_SNAPSHOT_H
+
+#include <stdint.h>
+
+/* Fixed-layout table published by `minifetch --daemon` in the POSIX
+ * shared-memory object $MINIFETCH_SHM (default /minifetch-<uid>) and
+ * rendered by `--from-shm`. line[i] holds the output of the i-th entry of
+ * the field table, so writer and reader must be the same build; layout
+ * and count catch a mismatch. */
+#define MF_SNAPSHOT_LINES 32U
+#define MF_SNAPSHOT_VALUE_MAX 256U
+/* The daemon refreshes the stamp every second; older snapshots are from
+ * a daemon that is no longer running. */
+#define MF_SNAPSHOT_MAX_AGE_NS 10000000000ULL
+
+struct mf_snapshot_line {
+    int32_t ok; /* collector returned 0 */
+    char value[MF_SNAPSHOT_VALUE_MAX];
+};
+
+struct mf_snapshot {
+    uint32_t magic;
+    uint32_t layout;
+    uint32_t seq; /* odd while the daemon is writing */
+    uint32_t count;
+    uint64_t stamp_ns; /* CLOCK_MONOTONIC of the last publish */
+    struct mf_snapshot_line line[MF_SNAPSHOT_LINES];
+};
+
+/* Writer side. Creates (or takes over) the object and locks it so a
+ * second daemon fails instead of interleaving writes. NULL on failure. */
+struct mf_snapshot *mf_snapshot_publish(uint32_t count);
+/* Brackets every update; readers retry while a write is in progress, so
+ * the writer never waits on them. write_end also stamps the snapshot. */
+void mf_snapshot_write_begin(struct mf_snapshot *snap);
+void mf_snapshot_write_end(struct mf_snapshot *snap);
+void mf_snapshot_unpublish(struct mf_snapshot *snap);
+
+/* Reader side: maps the object read-only and copies out a consistent
+ * snapshot. Returns -1 when there is no trusted, current snapshot with
+ * count lines. */
+int mf_snapshot_copy(struct mf_snapshot *out, uint32_t count);
+
+#endif /* MINIFETCH_SNAPSHOT_H */
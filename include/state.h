@@ -0,0 +1,23 @@
+#ifndef MINIFETCH_STATE_H
+#define MINIFETCH_STATE_H
+
+#include <stddef.h>
+
+/* Small per-user files that carry a collector sample from one run to the
+ * next (e.g. CPU counters for a utilisation delta). They live in
+ * $MINIFETCH_STATE_DIR, $XDG_RUNTIME_DIR or /tmp as
+ * minifetch-<uid>-<name>, and are only trusted when owned by the caller
+ * and not writable by anyone else. */
+
+/* Reads the blob saved under name into buf. Returns its size, or -1 when
+ * there is none (or it does not fit). */
+long mf_state_load(const char *name, void *buf, size_t cap);
+
+/* Atomically replaces the blob saved under name. Returns 0 or -1. */
+int mf_state_store(const char *name, const void *buf, size_t len);
+
+/* Keeps every later load/store in process memory instead of on disk,
+ * for long-running modes (--watch) that sample on every refresh. */
+void mf_state_use_memory(void);
+
+#endif /* MINIFETCH_STATE_H */
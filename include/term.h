@@ -4,7 +4,8 @@
 #include <stddef.h>
 
 int mf_is_tty(void);
-void mf_format_bytes(double bytes, char *out, size_t outsz);
 size_t mf_utf8_display_width(const char *s);
+size_t mf_utf8_display_width_n(const char *s, size_t len);
+size_t mf_utf8_next(const char *s, unsigned int *width);
 
 #endif /* MINIFETCH_TERM_H */
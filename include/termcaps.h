@@ -0,0 +1,44 @@
+#ifndef MINIFETCH_TERMCAPS_H
+#define MINIFETCH_TERMCAPS_H
+
+/* What the terminal on stdin/stdout does beyond VT100, found by asking it
+ * (DA1, DA2, XTVERSION, DECRQM, DECRQSS and two cursor reports). The
+ * answers are kept per terminal in a state file (state.h) keyed by
+ * $TERM, $TERM_PROGRAM and $TERM_PROGRAM_VERSION (or $VTE_VERSION), so
+ * only the first run in a new terminal waits for them all. Where neither
+ * program variable is set (ssh, a console) the tty and its session id
+ * join the key instead: each login session is probed once, and one
+ * whose terminal did not answer is not asked again. */
+
+#define MF_TERMCAP_SYNC 0x01U      /* synchronized output, mode 2026 */
+#define MF_TERMCAP_FOCUS 0x02U     /* focus in/out reports, mode 1004 */
+#define MF_TERMCAP_REP 0x04U       /* REP: CSI n b repeats the last glyph */
+#define MF_TERMCAP_TRUECOLOR 0x08U /* 24-bit SGR colours */
+#define MF_TERMCAP_ANSWERED 0x80U  /* the terminal replied to DA1 */
+
+/* How long a probe waits for the terminal to answer. */
+#define MF_TERMCAPS_TIMEOUT_MS 150
+#define MF_TERMCAPS_VERSION_MAX 64
+
+/* Where mf_termcaps_detect found its answer. */
+enum mf_termcaps_source {
+    MF_TERMCAPS_NONE = 0, /* not a terminal, or it did not answer in time */
+    MF_TERMCAPS_PROBED = 1,
+    MF_TERMCAPS_CACHED = 2
+};
+
+struct mf_termcaps {
+    unsigned int flags;
+    char version[MF_TERMCAPS_VERSION_MAX]; /* XTVERSION, else ">" and DA2 */
+};
+
+/* Fills caps for the terminal on stdin/stdout, from the cache when it
+ * knows this terminal and otherwise by probing it for at most
+ * MF_TERMCAPS_TIMEOUT_MS. Must run before anything else is written to
+ * the terminal or read from it. Returns an enum mf_termcaps_source. */
+int mf_termcaps_detect(struct mf_termcaps *caps);
+
+/* Prints caps and where they came from (--termcaps). */
+void mf_termcaps_print(const struct mf_termcaps *caps, int source);
+
+#endif /* MINIFETCH_TERMCAPS_H */
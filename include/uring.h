@@ -0,0 +1,19 @@
+#ifndef MINIFETCH_URING_H
+#define MINIFETCH_URING_H
+
+#include <stddef.h>
+
+struct mf_uring_req {
+    const char *path;
+    char *buf;
+    size_t cap;
+    long result; /* bytes read, or -errno */
+};
+
+/* Opens, reads (once, up to cap bytes) and closes every path in a single
+ * io_uring submission. Returns 0 when the batch ran; per-request outcomes
+ * are in result. Returns -1 when io_uring is unavailable (old kernel,
+ * seccomp, sysctl) so the caller can fall back to plain syscalls. */
+int mf_uring_read_batch(struct mf_uring_req *reqs, size_t count);
+
+#endif /* MINIFETCH_URING_H */
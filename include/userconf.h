@@ -0,0 +1,58 @@
+#ifndef MINIFETCH_USERCONF_H
+#define MINIFETCH_USERCONF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Runtime settings from a config file, on top of the compiled-in
+ * defaults in config.h. The file is $MINIFETCH_CONFIG, else
+ * $XDG_CONFIG_HOME/minifetch/config, else ~/.config/minifetch/config:
+ * "key = value" lines, '#' comments.
+ *
+ *   fields = os kernel host cpu    which fields, in this order
+ *   label.NAME = TEXT              a field's label (printable ASCII)
+ *   label_width = N                label column width, 0-31
+ *   colour.label = SGR             e.g. 38;5;110; "none" for plain
+ *   colour.value = SGR
+ *   hidden.seed / hidden.gradient / hidden.engine / hidden.refresh
+ *                                  defaults for the matching options
+ *
+ * A valid file is compiled into the fixed layout below and cached as
+ * FILE.bin, which later runs map as it is while FILE stays unchanged. */
+
+#define MF_USERCONF_FIELDS_MAX 32U
+#define MF_USERCONF_LABEL_MAX 32U
+#define MF_USERCONF_SGR_MAX 32U
+#define MF_USERCONF_ENGINE_MAX 16U
+
+/* Which optional settings the file gave. */
+#define MF_USERCONF_HAS_FIELDS 0x01U
+#define MF_USERCONF_HAS_WIDTH 0x02U
+#define MF_USERCONF_HAS_LABEL_COLOUR 0x04U
+#define MF_USERCONF_HAS_VALUE_COLOUR 0x08U
+#define MF_USERCONF_HAS_SEED 0x10U
+#define MF_USERCONF_HAS_GRADIENT 0x20U
+#define MF_USERCONF_HAS_ENGINE 0x40U
+#define MF_USERCONF_HAS_REFRESH 0x80U
+
+struct mf_userconf {
+    uint32_t has;         /* MF_USERCONF_HAS_* */
+    uint32_t field_count;
+    uint8_t field[MF_USERCONF_FIELDS_MAX]; /* field table indices, in order */
+    char label[MF_USERCONF_FIELDS_MAX][MF_USERCONF_LABEL_MAX]; /* by index; "" keeps the built-in */
+    uint32_t label_width;
+    char label_colour[MF_USERCONF_SGR_MAX]; /* the whole escape */
+    char value_colour[MF_USERCONF_SGR_MAX];
+    uint32_t seed;
+    uint32_t gradient; /* an enum mf_hidden_gradient */
+    uint32_t refresh;
+    char engine[MF_USERCONF_ENGINE_MAX];
+};
+
+/* The config for a field table whose fields are called names[0..count).
+ * NULL, after a single failed stat(2), when there is no config file, and
+ * also when it cannot be read or is invalid, which is reported on
+ * stderr; the compiled-in defaults then apply. */
+const struct mf_userconf *mf_userconf_load(const char *const names[], size_t count);
+
+#endif /* MINIFETCH_USERCONF_H */
@@ -0,0 +1,13 @@
+#ifndef MINIFETCH_WCWIDTH_TABLE_H
+#define MINIFETCH_WCWIDTH_TABLE_H
+
+/* Two-level column width table generated by tools/gen_wcwidth.sh.
+ * Stage 1 maps (codepoint >> 8) to a block; each stage 2 block packs
+ * 256 widths (0, 1 or 2) as 2-bit entries. */
+#define MF_WCWIDTH_STAGE1_LEN  (0x110000 >> 8)
+#define MF_WCWIDTH_BLOCK_BYTES (256 / 4)
+
+extern const unsigned char g_wcwidth_stage1[MF_WCWIDTH_STAGE1_LEN];
+extern const unsigned char g_wcwidth_stage2[][MF_WCWIDTH_BLOCK_BYTES];
+
+#endif /* MINIFETCH_WCWIDTH_TABLE_H */
@@ -1,33 +1,266 @@
 #define _POSIX_C_SOURCE 200809L
 
-#include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "cli.h"
+#include "fmt.h"
+#include "hidden.h"
+#include "linux_extras.h"
+#include "outbuf.h"
 
-int mf_cli_parse(int argc, char **argv, struct mf_options *opts)
+/* Matches "--name VALUE" or "--name=VALUE". Returns 1 and advances *index
+ * past a separate value argument on a match, -1 when the value is missing
+ * and 0 when argv[*index] is some other argument. */
+static int mf_cli_long_value(int argc, char **argv, int *index, const char *name, const char **value)
 {
-    int ch;
-    int i;
-    int write_index;
+    const char *arg;
+    size_t len;
 
-    if (opts == NULL) {
+    arg = argv[*index];
+    len = strlen(name);
+    if (strncmp(arg, name, len) != 0) {
+        return 0;
+    }
+    if (arg[len] == '=') {
+        *value = arg + len + 1;
+        return 1;
+    }
+    if (arg[len] != '\0') {
+        return 0;
+    }
+    if (*index + 1 >= argc) {
+        return -1;
+    }
+    *index += 1;
+    *value = argv[*index];
+    return 1;
+}
+
+/* Parses all of value as a decimal in [min, max]. */
+static int mf_cli_uint(const char *value, uint64_t min, uint64_t max, unsigned int *out)
+{
+    uint64_t number;
+
+    if (value[0] == '\0' || value[mf_parse_u64(value, &number)] != '\0' || number < min || number > max) {
         return -1;
     }
+    *out = (unsigned int)number;
+    return 0;
+}
 
+void mf_cli_defaults(struct mf_options *opts)
+{
     opts->show_all = 0;
     opts->no_colour = 0;
     opts->quiet = 0;
     opts->help = 0;
     opts->hidden = 0;
+    opts->mounts_requested = 0;
+    opts->mounts_top = MF_MOUNTS_TOP_DEFAULT;
+    opts->mount_filter = NULL;
+    opts->watch_interval = 0U;
+    opts->daemon = 0;
+    opts->from_shm = 0;
+    opts->root = NULL;
+    opts->roots_under = NULL;
+    opts->sink_count = 0U;
+    opts->seed = 0U;
+    opts->gradient = MF_HIDDEN_GRADIENT_MONO;
+    opts->engine = NULL;
+    opts->refresh = MF_HIDDEN_REFRESH_DEFAULT;
+    opts->termcaps = 0;
+    opts->record = NULL;
+    opts->replay = NULL;
+    opts->export_path = NULL;
+    opts->export_frames = MF_EXPORT_FRAMES_DEFAULT;
+    opts->export_frame_ms = MF_EXPORT_FRAME_MS_DEFAULT;
+    opts->export_cols = MF_EXPORT_COLS_DEFAULT;
+    opts->export_rows = MF_EXPORT_ROWS_DEFAULT;
+}
+
+int mf_cli_parse(int argc, char **argv, struct mf_options *opts)
+{
+    int ch;
+    int i;
+    int write_index;
+
+    if (opts == NULL) {
+        return -1;
+    }
 
     write_index = 1;
     for (i = 1; i < argc; ++i) {
+        const char *value;
+        uint64_t number;
+        int rc;
+
         if (strcmp(argv[i], "--hidden") == 0) {
             opts->hidden = 1;
             continue;
         }
+        if (strcmp(argv[i], "--daemon") == 0) {
+            opts->daemon = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--termcaps") == 0) {
+            opts->termcaps = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--from-shm") == 0) {
+            opts->from_shm = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--watch") == 0) {
+            opts->watch_interval = MF_WATCH_DEFAULT_INTERVAL;
+            continue;
+        }
+        if (strncmp(argv[i], "--watch=", 8) == 0) {
+            value = argv[i] + 8;
+            if (value[0] == '\0' || value[mf_parse_u64(value, &number)] != '\0' || number == 0U || number > 3600U) {
+                return -1;
+            }
+            opts->watch_interval = (unsigned int)number;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--mounts", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0' || value[mf_parse_u64(value, &number)] != '\0' || number > 16U) {
+                return -1;
+            }
+            opts->mounts_top = (unsigned int)number;
+            opts->mounts_requested = 1;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--mount-filter", &value);
+        if (rc != 0) {
+            if (rc < 0) {
+                return -1;
+            }
+            opts->mount_filter = value;
+            opts->mounts_requested = 1;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--root", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->root = value;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--roots-under", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->roots_under = value;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--sink", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0' || opts->sink_count >= MF_SINKS_MAX) {
+                return -1;
+            }
+            opts->sinks[opts->sink_count++] = value;
+            opts->hidden = 1;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--record", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->record = value;
+            opts->hidden = 1;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--replay", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->replay = value;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--export", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->export_path = value;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--frames", &value);
+        if (rc != 0) {
+            if (rc < 0 || mf_cli_uint(value, 1U, 100000U, &opts->export_frames) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--timebase", &value);
+        if (rc != 0) {
+            if (rc < 0 || mf_cli_uint(value, 1U, 60000U, &opts->export_frame_ms) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--seed", &value);
+        if (rc != 0) {
+            if (rc < 0 || mf_cli_uint(value, 0U, UINT32_MAX, &opts->seed) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--gradient", &value);
+        if (rc != 0) {
+            if (rc < 0) {
+                return -1;
+            }
+            if (strcmp(value, "mono") == 0) {
+                opts->gradient = MF_HIDDEN_GRADIENT_MONO;
+            } else if (strcmp(value, "256") == 0) {
+                opts->gradient = MF_HIDDEN_GRADIENT_256;
+            } else if (strcmp(value, "truecolor") == 0) {
+                opts->gradient = MF_HIDDEN_GRADIENT_TRUECOLOR;
+            } else {
+                return -1;
+            }
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--engine", &value);
+        if (rc != 0) {
+            if (rc < 0 || value[0] == '\0') {
+                return -1;
+            }
+            opts->engine = value;
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--refresh", &value);
+        if (rc != 0) {
+            if (rc < 0 || mf_cli_uint(value, 0U, 86400U, &opts->refresh) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        rc = mf_cli_long_value(argc, argv, &i, "--size", &value);
+        if (rc != 0) {
+            char cols[8];
+            const char *x;
+
+            x = rc > 0 ? strchr(value, 'x') : NULL;
+            if (x == NULL || (size_t)(x - value) >= sizeof(cols)) {
+                return -1;
+            }
+            memcpy(cols, value, (size_t)(x - value));
+            cols[x - value] = '\0';
+            if (mf_cli_uint(cols, 1U, 1000U, &opts->export_cols) != 0 ||
+                mf_cli_uint(x + 1, 1U, 1000U, &opts->export_rows) != 0) {
+                return -1;
+            }
+            continue;
+        }
         argv[write_index++] = argv[i];
     }
     argv[write_index] = NULL;
@@ -64,6 +297,8 @@ int mf_cli_parse(int argc, char **argv, struct mf_options *opts)
 
 void mf_cli_print_usage(const char *prog)
 {
+    char storage[1024];
+    struct mf_outbuf ob;
     const char *name;
 
     if (prog == NULL) {
@@ -72,9 +307,41 @@ void mf_cli_print_usage(const char *prog)
         name = prog;
     }
 
-    fprintf(stdout, "Usage: %s [-a] [-c] [-q] [-h]\n", name);
-    fprintf(stdout, "  -a    show all available fields\n");
-    fprintf(stdout, "  -c    disable colour output\n");
-    fprintf(stdout, "  -q    quiet mode (values only)\n");
-    fprintf(stdout, "  -h    display this help\n");
+    mf_outbuf_init(&ob, storage, sizeof(storage), STDOUT_FILENO);
+    mf_outbuf_puts(&ob, "Usage: ");
+    mf_outbuf_puts(&ob, name);
+    mf_outbuf_puts(&ob,
+                   " [-a] [-c] [-q] [-h] [--watch[=SECS]] [--mounts N] [--mount-filter PATH]\n"
+                   "       [--daemon | --from-shm] [--root DIR | --roots-under DIR] [--termcaps]\n"
+                   "       [--hidden] [--sink TTY]... [--record FILE | --replay FILE | --export FILE]\n"
+                   "       [--frames N] [--timebase MS] [--size COLSxROWS] [--seed N]\n"
+                   "       [--gradient MODE] [--engine NAME] [--refresh SEC]\n"
+                   "  -a    show all available fields\n"
+                   "  -c    disable colour output\n"
+                   "  -q    quiet mode (values only)\n"
+                   "  -h    display this help\n"
+                   "  --watch[=SECS]        redraw every SECS seconds (default 2) with live rates\n"
+                   "  --mounts N            list the N largest mounts (0-16, default 3)\n"
+                   "  --mount-filter PATH   only count mounts at or below PATH\n"
+                   "  --daemon              keep collecting and publish to shared memory\n"
+                   "  --from-shm            render the daemon's snapshot (collects if none)\n"
+                   "  --root DIR            read files from DIR as if it were /\n"
+                   "  --roots-under DIR     one OS record per root filesystem under DIR\n"
+                   "  --termcaps            print what the terminal supports and exit\n"
+                   "Hidden mode:\n"
+                   "  --hidden              animate a noise field behind the panel\n"
+                   "  --sink TTY            draw on TTY (repeatable, up to 8; implies --hidden)\n"
+                   "  --record FILE         save every frame drawn to FILE (implies --hidden)\n"
+                   "  --replay FILE         play a --record file back at its recorded pace\n"
+                   "  --export FILE         render offline to asciicast, or SVG for *.svg\n"
+                   "  --frames N            frames to export (default 120)\n"
+                   "  --timebase MS         milliseconds between exported frames (default 100)\n"
+                   "  --size COLSxROWS      export size (default 80x24)\n"
+                   "  --seed N              pick another noise field\n"
+                   "  --gradient MODE       mono (default), 256 or truecolor\n"
+                   "  --engine NAME         value (default), simplex, plasma, auto; list prints costs\n"
+                   "  --refresh SEC         re-collect the panel every SEC seconds (default 5, 0 never)\n"
+                   "Settings are read from $MINIFETCH_CONFIG, else $XDG_CONFIG_HOME/minifetch/config,\n"
+                   "else ~/.config/minifetch/config.\n");
+    mf_outbuf_flush(&ob);
 }
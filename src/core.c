@@ -1,7 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <ctype.h>
-#include <stdio.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/statvfs.h>
@@ -10,69 +11,99 @@
 
 #include "core.h"
 #include "compat.h"
-#include "term.h"
+#include "fileio.h"
+#include "fmt.h"
+#include "linux_extras.h"
+
+/* The process-wide root goes through mf_read_file so prefetched copies
+ * are used; batch callers pass their own root. */
+static long mf_core_read(int rootfd, const char *path, char *buf, size_t bufsz)
+{
+    if (rootfd == mf_fileio_root()) {
+        return mf_read_file(path, buf, bufsz);
+    }
+    return mf_read_file_in(rootfd, path, buf, bufsz);
+}
 
 #if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
-static int mf_linux_read_os_release(char *out, size_t outsz)
+/* Copies the unquoted value of line into dst when it starts with key. */
+static void mf_os_release_field(char *line, const char *key, char *dst, size_t dstsz)
+{
+    size_t len = strlen(key);
+
+    if (dst[0] == '\0' && strncmp(line, key, len) == 0) {
+        mf_unquote(line + len);
+        mf_strlcpy(dst, line + len, dstsz);
+    }
+}
+#endif
+
+int mf_os_release_read(int rootfd, struct mf_os_release *rel)
 {
-    const char *candidates[] = { "/etc/os-release", "/usr/lib/os-release" };
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    const char *candidates[] = { MF_PATH_OS_RELEASE, "/usr/lib/os-release" };
     size_t i;
 
     for (i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
-        FILE *fp;
-        char line[256];
-        char pretty[256];
-        char name[256];
+        char data[4096];
+        char *cursor;
+        char *line;
 
-        pretty[0] = '\0';
-        name[0] = '\0';
-
-        fp = fopen(candidates[i], "r");
-        if (fp == NULL) {
+        memset(rel, 0, sizeof(*rel));
+        if (mf_core_read(rootfd, candidates[i], data, sizeof(data)) < 0) {
             continue;
         }
 
-        while (fgets(line, (int)sizeof(line), fp) != NULL) {
-            if (strncmp(line, "PRETTY_NAME=", 12) == 0) {
-                char *value;
-                value = line + 12;
-                mf_unquote(value);
-                mf_strlcpy(pretty, value, sizeof(pretty));
-                break;
-            }
-            if (name[0] == '\0' && strncmp(line, "NAME=", 5) == 0) {
-                char *value;
-                value = line + 5;
-                mf_unquote(value);
-                mf_strlcpy(name, value, sizeof(name));
-            }
+        cursor = data;
+        while ((line = mf_next_line(&cursor)) != NULL) {
+            mf_os_release_field(line, "PRETTY_NAME=", rel->pretty, sizeof(rel->pretty));
+            mf_os_release_field(line, "NAME=", rel->name, sizeof(rel->name));
+            mf_os_release_field(line, "ID=", rel->id, sizeof(rel->id));
+            mf_os_release_field(line, "VERSION_ID=", rel->version_id, sizeof(rel->version_id));
         }
 
-        fclose(fp);
-
-        if (pretty[0] != '\0') {
-            mf_strlcpy(out, pretty, outsz);
-            return 0;
-        }
-        if (name[0] != '\0') {
-            mf_strlcpy(out, name, outsz);
+        if (rel->pretty[0] != '\0' || rel->name[0] != '\0') {
             return 0;
         }
     }
-
+#else
+    (void)rootfd;
+    (void)rel;
+#endif
     return -1;
 }
-#endif
+
+int mf_hostname_read(int rootfd, char *out, size_t outsz)
+{
+    char data[256];
+    char *cursor;
+    char *line;
+
+    if (mf_core_read(rootfd, MF_PATH_HOSTNAME, data, sizeof(data)) < 0) {
+        return -1;
+    }
+    cursor = data;
+    line = mf_next_line(&cursor);
+    if (line == NULL) {
+        return -1;
+    }
+    mf_rstrip(line);
+    if (line[0] == '\0') {
+        return -1;
+    }
+    mf_strlcpy(out, line, outsz);
+    return 0;
+}
 
 int mf_collect_os(char *out, size_t outsz)
 {
+    struct mf_os_release rel;
     struct utsname info;
 
-#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
-    if (mf_linux_read_os_release(out, outsz) == 0) {
+    if (mf_os_release_read(mf_fileio_root(), &rel) == 0) {
+        mf_strlcpy(out, rel.pretty[0] != '\0' ? rel.pretty : rel.name, outsz);
         return 0;
     }
-#endif
 
     if (uname(&info) == 0) {
         mf_strlcpy(out, info.sysname, outsz);
@@ -98,20 +129,14 @@ int mf_collect_kernel(char *out, size_t outsz)
 
 int mf_collect_host(char *out, size_t outsz)
 {
-    FILE *fp;
     struct utsname info;
 
-    fp = fopen("/etc/hostname", "r");
-    if (fp != NULL) {
-        if (fgets(out, (int)outsz, fp) != NULL) {
-            mf_rstrip(out);
-            fclose(fp);
-            if (out[0] != '\0') {
-                return 0;
-            }
-        } else {
-            fclose(fp);
-        }
+    if (mf_hostname_read(mf_fileio_root(), out, outsz) == 0) {
+        return 0;
+    }
+    /* The running kernel's nodename says nothing about another root. */
+    if (mf_fileio_root() != AT_FDCWD) {
+        return -1;
     }
 
     if (uname(&info) == 0) {
@@ -125,13 +150,53 @@ int mf_collect_host(char *out, size_t outsz)
 int mf_collect_cpu(char *out, size_t outsz)
 {
     long cpus;
+    struct mf_fmt f;
 
     cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    if (mf_fileio_root() != AT_FDCWD) {
+        char online[256];
+
+        /* sysconf describes the running system, not the root. */
+        cpus = 0;
+        if (mf_read_file(MF_PATH_SYS_SYSTEM "/cpu/online", online, sizeof(online)) > 0) {
+            cpus = (long)mf_cpulist_count(online);
+        }
+    }
+#endif
     if (cpus < 1) {
         cpus = 1;
     }
 
-    snprintf(out, outsz, "%ld", cpus);
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_uint(&f, (uint64_t)cpus);
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    {
+        const struct mf_cgroup_limits *lim;
+        uint64_t milli;
+
+        /* Inside a container the usable share is what matters for
+         * sizing thread pools: the tighter of the cpuset and quota. */
+        lim = mf_cgroup_limits();
+        milli = (uint64_t)cpus * 1000U;
+        if (lim->cpuset_count > 0U && (uint64_t)lim->cpuset_count * 1000U < milli) {
+            milli = (uint64_t)lim->cpuset_count * 1000U;
+        }
+        if (lim->cpu_milli > 0U && lim->cpu_milli < milli) {
+            milli = lim->cpu_milli;
+        }
+        if (milli < (uint64_t)cpus * 1000U) {
+            mf_fmt_str(&f, " (cgroup limit ");
+            if (milli % 1000U == 0U) {
+                mf_fmt_uint(&f, milli / 1000U);
+            } else {
+                mf_fmt_fixed(&f, (milli + 5U) / 10U, 2U);
+            }
+            mf_fmt_str(&f, ")");
+        }
+    }
+#endif
     return 0;
 }
 
@@ -175,32 +240,35 @@ int mf_collect_shell(char *out, size_t outsz)
 int mf_collect_disk(char *out, size_t outsz)
 {
     struct statvfs vfs;
-    double total_bytes;
-    double available_bytes;
-    double used_bytes;
-    double percent;
-    char used_buf[64];
-    char total_buf[64];
-
-    if (statvfs("/", &vfs) != 0) {
+    uint64_t total_bytes;
+    uint64_t available_bytes;
+    uint64_t used_bytes;
+    struct mf_fmt f;
+
+    if (mf_fileio_root() != AT_FDCWD) {
+        if (fstatvfs(mf_fileio_root(), &vfs) != 0) {
+            return -1;
+        }
+    } else if (statvfs("/", &vfs) != 0) {
         return -1;
     }
 
-    total_bytes = (double)vfs.f_blocks * (double)vfs.f_frsize;
-    available_bytes = (double)vfs.f_bavail * (double)vfs.f_frsize;
-    used_bytes = total_bytes - available_bytes;
-    if (total_bytes <= 0.0) {
+    total_bytes = (uint64_t)vfs.f_blocks * (uint64_t)vfs.f_frsize;
+    available_bytes = (uint64_t)vfs.f_bavail * (uint64_t)vfs.f_frsize;
+    if (total_bytes == 0U) {
         return -1;
     }
-    if (used_bytes < 0.0) {
-        used_bytes = 0.0;
+    used_bytes = 0U;
+    if (total_bytes > available_bytes) {
+        used_bytes = total_bytes - available_bytes;
     }
 
-    percent = (used_bytes / total_bytes) * 100.0;
-
-    mf_format_bytes(used_bytes, used_buf, sizeof(used_buf));
-    mf_format_bytes(total_bytes, total_buf, sizeof(total_buf));
-
-    snprintf(out, outsz, "%s / %s (%.0f%%)", used_buf, total_buf, percent);
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_bytes(&f, used_bytes);
+    mf_fmt_str(&f, " / ");
+    mf_fmt_bytes(&f, total_bytes);
+    mf_fmt_str(&f, " (");
+    mf_fmt_percent(&f, used_bytes, total_bytes);
+    mf_fmt_str(&f, ")");
     return 0;
 }
@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fleet.h"
+#include "core.h"
+#include "compat.h"
+#include "outbuf.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Each root costs a few small reads, so the pool is sized for I/O
+ * latency (cold page cache, network storage) rather than CPU count. */
+#define MF_FLEET_WORKERS 8U
+#define MF_FLEET_NAME_MAX 256U
+#define MF_FLEET_RECORD_MAX 1024U
+
+struct mf_fleet {
+    int dirfd;
+    char (*names)[MF_FLEET_NAME_MAX];
+    size_t count;
+    size_t next;
+    pthread_mutex_t lock; /* guards next and stdout */
+};
+
+/* Appends a field, turning control bytes from the image (tabs,
+ * newlines, escape sequences) into '?' so a record stays one line and
+ * cannot drive the terminal. */
+static void mf_fleet_field(char *rec, size_t *len, const char *value)
+{
+    if (value[0] == '\0') {
+        value = "-";
+    }
+    if (*len > 0U && *len < MF_FLEET_RECORD_MAX - 1U) {
+        rec[(*len)++] = '\t';
+    }
+    for (; *value != '\0' && *len < MF_FLEET_RECORD_MAX - 1U; ++value) {
+        unsigned char c = (unsigned char)*value;
+
+        rec[(*len)++] = (c < 0x20U || c == 0x7fU) ? '?' : (char)c;
+    }
+}
+
+static void mf_fleet_visit(struct mf_fleet *fleet, const char *name)
+{
+    struct mf_os_release rel;
+    char host[256];
+    char rec[MF_FLEET_RECORD_MAX];
+    size_t len;
+    int rootfd;
+
+    rootfd = openat(fleet->dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (rootfd < 0) {
+        return;
+    }
+    if (mf_os_release_read(rootfd, &rel) != 0) {
+        memset(&rel, 0, sizeof(rel));
+    }
+    if (mf_hostname_read(rootfd, host, sizeof(host)) != 0) {
+        host[0] = '\0';
+    }
+    close(rootfd);
+
+    len = 0U;
+    mf_fleet_field(rec, &len, name);
+    mf_fleet_field(rec, &len, rel.pretty[0] != '\0' ? rel.pretty : rel.name);
+    mf_fleet_field(rec, &len, rel.id);
+    mf_fleet_field(rec, &len, rel.version_id);
+    mf_fleet_field(rec, &len, host);
+    rec[len++] = '\n';
+
+    /* One write per record keeps lines whole on pipes and files alike. */
+    pthread_mutex_lock(&fleet->lock);
+    mf_write_all(STDOUT_FILENO, rec, len);
+    pthread_mutex_unlock(&fleet->lock);
+}
+
+static void *mf_fleet_worker(void *arg)
+{
+    struct mf_fleet *fleet = (struct mf_fleet *)arg;
+
+    for (;;) {
+        size_t i;
+
+        pthread_mutex_lock(&fleet->lock);
+        i = fleet->next++;
+        pthread_mutex_unlock(&fleet->lock);
+        if (i >= fleet->count) {
+            return NULL;
+        }
+        mf_fleet_visit(fleet, fleet->names[i]);
+    }
+}
+
+/* Lists the subdirectories of dirfd; symlinks are skipped so a root
+ * cannot point the scan somewhere else. */
+static int mf_fleet_list(struct mf_fleet *fleet)
+{
+    struct dirent *ent;
+    size_t cap;
+    DIR *dir;
+    int fd;
+
+    fd = dup(fleet->dirfd);
+    if (fd < 0) {
+        return -1;
+    }
+    dir = fdopendir(fd);
+    if (dir == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    cap = 0U;
+    while ((ent = readdir(dir)) != NULL) {
+        struct stat st;
+
+        if (ent->d_name[0] == '.' || strlen(ent->d_name) >= MF_FLEET_NAME_MAX) {
+            continue;
+        }
+        /* d_type is not POSIX; one fstatat per root is noise next to
+         * the reads that follow. */
+        if (fstatat(fleet->dirfd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode)) {
+            continue;
+        }
+        if (fleet->count == cap) {
+            char (*grown)[MF_FLEET_NAME_MAX];
+
+            cap = cap == 0U ? 64U : cap * 2U;
+            grown = (char (*)[MF_FLEET_NAME_MAX])realloc(fleet->names, cap * MF_FLEET_NAME_MAX);
+            if (grown == NULL) {
+                break;
+            }
+            fleet->names = grown;
+        }
+        mf_strlcpy(fleet->names[fleet->count++], ent->d_name, MF_FLEET_NAME_MAX);
+    }
+    closedir(dir);
+    return 0;
+}
+#endif
+
+int mf_run_fleet(const char *dir)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    pthread_t tids[MF_FLEET_WORKERS];
+    int started[MF_FLEET_WORKERS];
+    struct mf_fleet fleet;
+    size_t workers;
+    size_t i;
+
+    memset(&fleet, 0, sizeof(fleet));
+    fleet.dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fleet.dirfd < 0) {
+        return -1;
+    }
+    if (mf_fleet_list(&fleet) != 0) {
+        close(fleet.dirfd);
+        return -1;
+    }
+    pthread_mutex_init(&fleet.lock, NULL);
+
+    workers = fleet.count < MF_FLEET_WORKERS ? fleet.count : MF_FLEET_WORKERS;
+    for (i = 1; i < workers; ++i) {
+        started[i] = pthread_create(&tids[i], NULL, mf_fleet_worker, &fleet) == 0;
+    }
+    /* The calling thread is worker 0; it also drains the queue alone if
+     * no thread could be started. */
+    mf_fleet_worker(&fleet);
+    for (i = 1; i < workers; ++i) {
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&fleet.lock);
+    free(fleet.names);
+    close(fleet.dirfd);
+    return 0;
+#else
+    (void)dir;
+    return -1;
+#endif
+}
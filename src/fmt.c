@@ -0,0 +1,217 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fmt.h"
+
+#define MF_ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+static const uint64_t g_pow10[] = { 1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U };
+
+void mf_fmt_init(struct mf_fmt *f, char *buf, size_t cap)
+{
+    f->buf = buf;
+    f->cap = cap;
+    f->len = 0U;
+    if (buf != NULL && cap > 0U) {
+        buf[0] = '\0';
+    }
+}
+
+static void mf_fmt_put(struct mf_fmt *f, const char *s, size_t n)
+{
+    size_t room;
+
+    if (f->buf == NULL || f->cap == 0U) {
+        return;
+    }
+    room = f->cap - 1U - f->len;
+    if (n > room) {
+        n = room;
+    }
+    memcpy(f->buf + f->len, s, n);
+    f->len += n;
+    f->buf[f->len] = '\0';
+}
+
+void mf_fmt_str(struct mf_fmt *f, const char *s)
+{
+    mf_fmt_put(f, s, strlen(s));
+}
+
+/* Writes v right-aligned into the end of tmp and returns the digit count.
+ * min_digits pads with leading zeros. */
+static size_t mf_fmt_digits(char tmp[24], uint64_t v, size_t min_digits)
+{
+    size_t n;
+
+    n = 0U;
+    do {
+        tmp[23 - n] = (char)('0' + (int)(v % 10U));
+        v /= 10U;
+        n++;
+    } while (v != 0U || n < min_digits);
+    return n;
+}
+
+void mf_fmt_uint(struct mf_fmt *f, uint64_t v)
+{
+    char tmp[24];
+    size_t n;
+
+    n = mf_fmt_digits(tmp, v, 1U);
+    mf_fmt_put(f, tmp + 24 - n, n);
+}
+
+void mf_fmt_fixed(struct mf_fmt *f, uint64_t q, unsigned int decimals)
+{
+    char tmp[24];
+    size_t n;
+
+    mf_fmt_uint(f, q / g_pow10[decimals]);
+    if (decimals > 0U) {
+        mf_fmt_put(f, ".", 1U);
+        n = mf_fmt_digits(tmp, q % g_pow10[decimals], decimals);
+        mf_fmt_put(f, tmp + 24 - n, n);
+    }
+}
+
+/* Rounds q + r / 2^shift to the nearest integer, ties to even, matching
+ * the default rounding printf applies to exactly representable values. */
+static uint64_t mf_round_shift(uint64_t q, uint64_t r, unsigned int shift)
+{
+    uint64_t half;
+
+    if (shift == 0U) {
+        return q;
+    }
+    half = (uint64_t)1U << (shift - 1U);
+    if (r > half || (r == half && (q & 1U) != 0U)) {
+        q++;
+    }
+    return q;
+}
+
+void mf_fmt_bytes(struct mf_fmt *f, uint64_t bytes)
+{
+    static const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB", "PiB" };
+    unsigned int unit_index;
+    unsigned int shift;
+    unsigned int decimals;
+    uint64_t whole;
+    uint64_t lo;
+    uint64_t lo_scaled;
+    uint64_t q;
+
+    unit_index = 0U;
+    while (unit_index < MF_ARRAY_LEN(units) - 1U && (bytes >> (10U * (unit_index + 1U))) != 0U) {
+        unit_index++;
+    }
+
+    /* value = bytes / 2^shift is exact, so the precision thresholds can be
+     * tested on the integer part alone. */
+    shift = 10U * unit_index;
+    whole = bytes >> shift;
+    lo = shift == 0U ? 0U : bytes & (((uint64_t)1U << shift) - 1U);
+
+    if (whole >= 100U) {
+        decimals = 0U;
+    } else if (whole >= 10U) {
+        decimals = 1U;
+    } else {
+        decimals = 2U;
+    }
+
+    /* lo < 2^50 and 10^decimals <= 100, so lo_scaled cannot overflow. */
+    lo_scaled = lo * g_pow10[decimals];
+    q = whole * g_pow10[decimals] + (lo_scaled >> shift);
+    q = mf_round_shift(q, shift == 0U ? 0U : lo_scaled & (((uint64_t)1U << shift) - 1U), shift);
+
+    mf_fmt_fixed(f, q, decimals);
+    mf_fmt_put(f, " ", 1U);
+    mf_fmt_str(f, units[unit_index]);
+}
+
+void mf_fmt_percent(struct mf_fmt *f, uint64_t part, uint64_t whole)
+{
+    uint64_t q;
+    uint64_t r;
+    uint64_t diff;
+
+    if (whole == 0U) {
+        mf_fmt_put(f, "0%", 2U);
+        return;
+    }
+
+    /* Keep part * 200 in range; the lost low bits cannot move a whole
+     * percentage point at these magnitudes. */
+    while (part > UINT64_MAX / 200U) {
+        part >>= 1;
+        whole >>= 1;
+    }
+    if (whole == 0U) {
+        whole = 1U;
+    }
+
+    q = (part * 100U) / whole;
+    r = (part * 100U) % whole;
+    diff = r * 2U > whole ? r * 2U - whole : whole - r * 2U;
+    if (diff <= (whole >> 40)) {
+        /* Within double rounding error of .5: the historical output came
+         * from printf rounding (part / whole) * 100.0, so settle the tie
+         * with that exact product instead of the true quotient. */
+        double p;
+        double half;
+
+        p = ((double)part / (double)whole) * 100.0;
+        half = (double)q + 0.5;
+        if (p > half || (p == half && (q & 1U) != 0U)) {
+            q++;
+        }
+    } else if (r * 2U > whole) {
+        q++;
+    }
+
+    mf_fmt_uint(f, q);
+    mf_fmt_put(f, "%", 1U);
+}
+
+void mf_fmt_duration(struct mf_fmt *f, uint64_t seconds)
+{
+    uint64_t total_minutes;
+    uint64_t days;
+    uint64_t hours;
+    uint64_t minutes;
+
+    total_minutes = seconds / 60U;
+    days = total_minutes / (60U * 24U);
+    total_minutes -= days * 60U * 24U;
+    hours = total_minutes / 60U;
+    minutes = total_minutes - hours * 60U;
+
+    if (days > 0U) {
+        mf_fmt_uint(f, days);
+        mf_fmt_put(f, "d ", 2U);
+    }
+    if (days > 0U || hours > 0U) {
+        mf_fmt_uint(f, hours);
+        mf_fmt_put(f, "h ", 2U);
+    }
+    mf_fmt_uint(f, minutes);
+    mf_fmt_put(f, "m", 1U);
+}
+
+size_t mf_parse_u64(const char *s, uint64_t *out)
+{
+    uint64_t v;
+    size_t n;
+
+    v = 0U;
+    n = 0U;
+    while (s[n] >= '0' && s[n] <= '9') {
+        v = v * 10U + (uint64_t)(s[n] - '0');
+        n++;
+    }
+    *out = v;
+    return n;
+}
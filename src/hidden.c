@@ -1,6 +1,10 @@
 #define _POSIX_C_SOURCE 200809L
 
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,8 +16,12 @@
 #include <unistd.h>
 
 #include "hidden.h"
+#include "hidden_record.h"
+#include "fmt.h"
 #include "logo.h"
+#include "outbuf.h"
 #include "term.h"
+#include "termcaps.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -25,18 +33,199 @@
 #define MF_HIDDEN_GRADIENT " .+100"
 #define MF_HIDDEN_COLUMN_GAP 3
 #define MF_HIDDEN_SIZE_REFRESH_SEC 0.5
+/* How long a new terminal size must hold before it is drawn at. */
+#define MF_HIDDEN_RESIZE_SETTLE_SEC 0.1
 #define MF_HIDDEN_BUFFER_CAP (1u << 20)
 #define MF_HIDDEN_FRAMETIME_S (1.0 / MF_HIDDEN_FPS)
+/* One frame on the wire and one ready behind it. A slow terminal never
+ * builds a backlog: the producer skips frames while both are taken and
+ * the next diff it encodes covers everything skipped. */
+#define MF_HIDDEN_RING_SLOTS 2U
+/* Worst case per cell: a cursor move ("\x1b[RRRRR;CCCCCH"), a truecolor
+ * SGR and 4 bytes. */
+#define MF_HIDDEN_CELL_BYTES_MAX 40U
+#define MF_HIDDEN_SGR_MAX 20U
+#define MF_HIDDEN_CLEAR_MAX 32U
+/* Synchronized output marks around a frame, "\x1b[?2026h" and "l". */
+#define MF_HIDDEN_SYNC_LEN 8U
+/* Frames shorter than this reach the terminal in one read anyway. */
+#define MF_HIDDEN_SYNC_MIN 4096U
+/* Shortest run of one glyph a REP pays for: "\x1b[Nb" is 4 bytes. */
+#define MF_HIDDEN_REP_MIN 5U
+/* How long a closing sink may take to finish its last frame. */
+#define MF_HIDDEN_SINK_CLOSE_MS 100
+/* Output arena for --export files. */
+#define MF_HIDDEN_EXPORT_ARENA (64U * 1024U)
+/* Columns an engine fills per call. */
+#define MF_HIDDEN_ROW_CHUNK 256
+/* --engine auto keeps the field under this share of a frame on one core. */
+#define MF_HIDDEN_ENGINE_BUDGET 0.25
+
+/* Escape bytes of one frame, owned by the producer until pushed and by
+ * the writer until drained. */
+struct mf_hidden_frame {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+/* Single-producer/single-consumer ring between the thread that renders
+ * frames and the one that writes them to the terminal. head and tail only
+ * grow; the lock exists so an idle writer can sleep on ready. */
+struct mf_hidden_ring {
+    struct mf_hidden_frame slot[MF_HIDDEN_RING_SLOTS];
+    unsigned int head; /* written by the producer */
+    unsigned int tail; /* written by the writer */
+    int stop;
+    int failed; /* write(2) failed: the terminal is gone */
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+};
+
+/* Cell buffers and noise coordinates for one screen, carved out of a
+ * single arena sized to the largest screen seen so far, so a terminal
+ * that shrinks or is dragged back and forth reuses it. fx and fy only
+ * depend on the position and are filled once per arena. */
+struct mf_hidden_screen {
+    void *arena;
+    size_t cap_cells;
+    int cap_rows;
+    int cap_cols;
+    int rows;
+    int cols;
+    struct mf_hidden_cell *curr;
+    struct mf_hidden_cell *prev;
+    double *fx;
+    double *fy;
+};
+
+/* A terminal size waiting to hold still: dragging a window corner sends
+ * a burst of sizes and only the last one is worth drawing at. */
+struct mf_hidden_resize {
+    int pending;
+    int rows;
+    int cols;
+    double since; /* when rows x cols was first read */
+};
+
+/* The info panel as the overlay draws it. */
+struct mf_hidden_panel {
+    char (*formatted)[MF_FORMATTED_LINE_MAX];
+    const size_t *widths;
+    size_t count;
+};
+
+/* Background re-collection of the panel (--refresh). Generation g lives
+ * in slot g & 1; generation 0 is the caller's own rows. The collector
+ * fills the next generation only once the renderer has taken up the
+ * current one, so it never writes a panel that may still be on screen,
+ * and the renderer never waits: it picks up whatever is published when
+ * a frame starts. */
+struct mf_hidden_live {
+    char (*formatted[2])[MF_FORMATTED_LINE_MAX];
+    size_t *widths[2];
+    size_t count[2];
+    unsigned int published; /* written by the collector */
+    unsigned int seen;      /* written by the renderer */
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t tid;
+    int running;
+};
 
-struct mf_hidden_cell {
-    unsigned char len;
-    char bytes[4];
+/* One --sink terminal: its own size, frame buffers and the part of the
+ * last encoded frame it has not accepted yet. */
+struct mf_hidden_sink {
+    int fd; /* -1 once the terminal is gone */
+    int rows;
+    int cols;
+    struct mf_hidden_cell *curr;
+    struct mf_hidden_cell *prev;
+    size_t cap; /* cells curr and prev have room for */
+    struct mf_hidden_frame out;
+    size_t sent;
+    int clear_pending;
+    unsigned char sgr; /* colour the terminal is drawing in */
 };
 
 static volatile sig_atomic_t g_hidden_running = 1;
+static volatile sig_atomic_t g_hidden_winch = 0;
+static int g_hidden_alt_screen = 0;
+static int g_hidden_input_state = 0; /* 1 after ESC, 2 inside a CSI */
+static unsigned int g_hidden_caps = 0U;
 static struct termios g_hidden_orig_tio;
 static int g_hidden_raw_enabled = 0;
 static int g_hidden_scroll_region_set = 0;
+static unsigned int g_hidden_seed_mix = 0U;
+static const char *g_hidden_record_path = NULL;
+static int g_hidden_gradient = MF_HIDDEN_GRADIENT_MONO;
+static mf_hidden_collect_fn g_hidden_collect = NULL;
+static void *g_hidden_collect_ctx = NULL;
+static size_t g_hidden_collect_rows = 0U;
+static unsigned int g_hidden_refresh_s = 0U;
+
+/* --gradient colours, dark to light; step 0 is the terminal default. */
+static const unsigned char g_hidden_ramp[MF_HIDDEN_RAMP_STEPS + 1U][3] = {
+    { 0xc0, 0xc0, 0xc0 },
+    { 0x10, 0x1a, 0x40 },
+    { 0x14, 0x2e, 0x6e },
+    { 0x12, 0x4a, 0x8c },
+    { 0x10, 0x6e, 0xa0 },
+    { 0x1c, 0x92, 0xa8 },
+    { 0x46, 0xb4, 0xa8 },
+    { 0x8c, 0xd2, 0xb0 },
+    { 0xe0, 0xf0, 0xd0 }
+};
+/* The SGR that switches the terminal to each step, built once. */
+static char g_hidden_sgr[MF_HIDDEN_RAMP_STEPS + 1U][MF_HIDDEN_SGR_MAX];
+static unsigned char g_hidden_sgr_len[MF_HIDDEN_RAMP_STEPS + 1U];
+
+static void mf_hidden_perm_init(void);
+
+void mf_hidden_set_termcaps(unsigned int flags)
+{
+    g_hidden_caps = flags;
+}
+
+void mf_hidden_configure(unsigned int seed, int gradient, const char *record_path)
+{
+    unsigned int i;
+
+    /* Seed 0 leaves the lattice hashes alone: the default field is the
+     * one hidden mode has always drawn. */
+    g_hidden_seed_mix = seed * 0x9e3779b9U;
+    g_hidden_gradient = gradient;
+    g_hidden_record_path = record_path;
+    mf_hidden_perm_init();
+
+    /* Built even for mono: a colour recording replays in 256 colours
+     * unless truecolor is asked for. */
+    for (i = 0; i <= MF_HIDDEN_RAMP_STEPS; ++i) {
+        const unsigned char *rgb = g_hidden_ramp[i];
+        struct mf_fmt f;
+
+        mf_fmt_init(&f, g_hidden_sgr[i], sizeof(g_hidden_sgr[i]));
+        if (i == 0U) {
+            mf_fmt_str(&f, "\x1b[39m");
+        } else if (gradient == MF_HIDDEN_GRADIENT_TRUECOLOR) {
+            mf_fmt_str(&f, "\x1b[38;2;");
+            mf_fmt_uint(&f, rgb[0]);
+            mf_fmt_str(&f, ";");
+            mf_fmt_uint(&f, rgb[1]);
+            mf_fmt_str(&f, ";");
+            mf_fmt_uint(&f, rgb[2]);
+            mf_fmt_str(&f, "m");
+        } else {
+            /* Nearest entry of the 6x6x6 cube at 16-231. */
+            mf_fmt_str(&f, "\x1b[38;5;");
+            mf_fmt_uint(&f, 16U + 36U * ((rgb[0] * 5U + 127U) / 255U) + 6U * ((rgb[1] * 5U + 127U) / 255U) +
+                                (rgb[2] * 5U + 127U) / 255U);
+            mf_fmt_str(&f, "m");
+        }
+        g_hidden_sgr_len[i] = (unsigned char)f.len;
+    }
+}
 
 static void mf_hidden_cell_set_char(struct mf_hidden_cell *cell, char c)
 {
@@ -44,6 +233,7 @@ static void mf_hidden_cell_set_char(struct mf_hidden_cell *cell, char c)
         return;
     }
     cell->len = 1;
+    cell->fg = 0;
     cell->bytes[0] = c;
 }
 
@@ -62,6 +252,7 @@ static void mf_hidden_cell_set_utf8(struct mf_hidden_cell *cell, const char *byt
     }
     memcpy(cell->bytes, bytes, copy_len);
     cell->len = (unsigned char)copy_len;
+    cell->fg = 0;
 }
 
 static void mf_hidden_on_signal(int sig)
@@ -70,6 +261,12 @@ static void mf_hidden_on_signal(int sig)
     g_hidden_running = 0;
 }
 
+static void mf_hidden_on_winch(int sig)
+{
+    (void)sig;
+    g_hidden_winch = 1;
+}
+
 static void mf_hidden_show_cursor(void)
 {
     fputs("\x1b[?25h\x1b[0m", stdout);
@@ -116,11 +313,25 @@ static void mf_hidden_reset_scroll_region(void)
     }
 }
 
+/* Draws on the alternate screen: it has no scrollback for a taller
+ * window to pull rows down from and is not reflowed on resize, so cells
+ * stay where they were drawn and a grown screen only needs its new part
+ * painted. Leaving it restores what the terminal showed before. */
+static void mf_hidden_enter_alt_screen(void)
+{
+    fputs("\x1b[?1049h", stdout);
+    g_hidden_alt_screen = 1;
+}
+
 static void mf_hidden_cleanup(void)
 {
     mf_hidden_disable_raw();
     mf_hidden_reset_scroll_region();
     mf_hidden_show_cursor();
+    if (g_hidden_alt_screen) {
+        fputs("\x1b[?1049l", stdout);
+        g_hidden_alt_screen = 0;
+    }
     fflush(stdout);
 }
 
@@ -132,6 +343,9 @@ static void mf_hidden_setup_signals(void)
     sa.sa_handler = mf_hidden_on_signal;
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = mf_hidden_on_winch;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &sa, NULL);
 }
 
 static unsigned int mf_hidden_hash_u32(unsigned int x)
@@ -146,34 +360,7 @@ static unsigned int mf_hidden_hash_u32(unsigned int x)
 
 static double mf_hidden_hash_unit(unsigned int x)
 {
-    return mf_hidden_hash_u32(x) / 4294967295.0;
-}
-
-static size_t mf_hidden_utf8_glyph_len(const char *s)
-{
-    unsigned char c;
-
-    if (s == NULL) {
-        return 0;
-    }
-
-    c = (unsigned char)s[0];
-    if (c == 0) {
-        return 0;
-    }
-    if ((c & 0x80U) == 0) {
-        return 1;
-    }
-    if ((c & 0xE0U) == 0xC0U) {
-        return 2;
-    }
-    if ((c & 0xF0U) == 0xE0U) {
-        return 3;
-    }
-    if ((c & 0xF8U) == 0xF0U) {
-        return 4;
-    }
-    return 1;
+    return mf_hidden_hash_u32(x ^ g_hidden_seed_mix) / 4294967295.0;
 }
 
 static double mf_hidden_smooth(double t)
@@ -238,6 +425,157 @@ static double mf_hidden_fbm3(double x, double y, double z, int octaves, double l
     return sum / denom;
 }
 
+/* Value noise shaped into contour bands; the field hidden mode has
+ * always drawn. Eight lattice hashes per octave. */
+static void mf_hidden_row_value(double *levels, int n, const double *fx, double fy, double z)
+{
+    int x;
+
+    for (x = 0; x < n; ++x) {
+        double v = mf_hidden_fbm3(fx[x], fy, z, 4, 2.0, 0.5);
+        double bands = 0.5 * (sin(v * 10.0 * M_PI) + 1.0);
+
+        levels[x] = 0.65 * v + 0.35 * bands;
+    }
+}
+
+/* The twelve cube-edge gradients, four repeated so a hash picks one
+ * with a mask instead of a division. */
+static const signed char g_hidden_grad3[16][3] = {
+    { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+    { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+    { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 },
+    { 1, 1, 0 }, { -1, 1, 0 }, { 0, -1, 1 }, { 0, -1, -1 }
+};
+
+/* Simplex corners hash through a shuffled byte table: three L1 loads
+ * are cheaper than the two multiply rounds of mf_hidden_hash_u32, and
+ * simplex pays them at four corners per sample. Shuffled per seed. */
+static unsigned char g_hidden_perm[256];
+
+static void mf_hidden_perm_init(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < 256U; ++i) {
+        g_hidden_perm[i] = (unsigned char)i;
+    }
+    for (i = 255U; i > 0U; --i) {
+        unsigned int r = mf_hidden_hash_u32(i ^ g_hidden_seed_mix) % (i + 1U);
+        unsigned char tmp = g_hidden_perm[i];
+
+        g_hidden_perm[i] = g_hidden_perm[r];
+        g_hidden_perm[r] = tmp;
+    }
+}
+
+/* floor() without the libm call; exact for the magnitudes used here. */
+static int mf_hidden_floor(double v)
+{
+    int i = (int)v;
+
+    return v < (double)i ? i - 1 : i;
+}
+
+static double mf_hidden_simplex_corner(int i, int j, int k, double x, double y, double z)
+{
+    double t = 0.6 - x * x - y * y - z * z;
+    unsigned int h;
+    const signed char *g;
+
+    if (t <= 0.0) {
+        return 0.0;
+    }
+    h = g_hidden_perm[(g_hidden_perm[(g_hidden_perm[k & 255] + j) & 255] + i) & 255];
+    g = g_hidden_grad3[h & 15U];
+    t *= t;
+    return t * t * ((double)g[0] * x + (double)g[1] * y + (double)g[2] * z);
+}
+
+/* 3D simplex noise in [-1, 1]: four corner hashes instead of eight. */
+static double mf_hidden_simplex3(double x, double y, double z)
+{
+    const double f3 = 1.0 / 3.0;
+    const double g3 = 1.0 / 6.0;
+    double s = (x + y + z) * f3;
+    int i = mf_hidden_floor(x + s);
+    int j = mf_hidden_floor(y + s);
+    int k = mf_hidden_floor(z + s);
+    double t = (double)(i + j + k) * g3;
+    double x0 = x - ((double)i - t);
+    double y0 = y - ((double)j - t);
+    double z0 = z - ((double)k - t);
+    /* The second and third corners of whichever of the six tetrahedra
+     * of the skewed cube holds the point. */
+    int xy = x0 >= y0;
+    int xz = x0 >= z0;
+    int yz = y0 >= z0;
+    int i1 = xy & xz;
+    int j1 = (!xy) & yz;
+    int k1 = (!xz) & (!yz);
+    int i2 = xy | xz;
+    int j2 = (!xy) | yz;
+    int k2 = !(xz & yz);
+    double n;
+
+    n = mf_hidden_simplex_corner(i, j, k, x0, y0, z0);
+    n += mf_hidden_simplex_corner(i + i1, j + j1, k + k1, x0 - i1 + g3, y0 - j1 + g3, z0 - k1 + g3);
+    n += mf_hidden_simplex_corner(i + i2, j + j2, k + k2, x0 - i2 + 2.0 * g3, y0 - j2 + 2.0 * g3, z0 - k2 + 2.0 * g3);
+    n += mf_hidden_simplex_corner(i + 1, j + 1, k + 1, x0 - 1.0 + 3.0 * g3, y0 - 1.0 + 3.0 * g3, z0 - 1.0 + 3.0 * g3);
+    return 32.0 * n;
+}
+
+/* The value engine's banding over simplex fBm. Simplex has no axis
+ * grain for the finer octaves to hide, so two octaves do what value
+ * noise needs four for. */
+static void mf_hidden_row_simplex(double *levels, int n, const double *fx, double fy, double z)
+{
+    int x;
+
+    for (x = 0; x < n; ++x) {
+        double v = 0.5 * mf_hidden_simplex3(fx[x], fy, z) + 0.25 * mf_hidden_simplex3(fx[x] * 2.0, fy * 2.0, z * 2.0);
+        double bands;
+
+        v = 0.5 + 0.5 * v / 0.75;
+        bands = 0.5 * (sin(v * 10.0 * M_PI) + 1.0);
+        levels[x] = 0.65 * v + 0.35 * bands;
+    }
+}
+
+/* Analytic plasma: a sum of travelling sines, two sin() per cell once
+ * the row term is hoisted. No lattice, no hashing. */
+static void mf_hidden_row_plasma(double *levels, int n, const double *fx, double fy, double z)
+{
+    double t = z * 25.0 + (double)(g_hidden_seed_mix >> 16) * (2.0 * M_PI / 65536.0);
+    double row = sin(fy * 24.0 + t);
+    int x;
+
+    for (x = 0; x < n; ++x) {
+        double xv = fx[x] * 6.0;
+        double v = row + sin(xv + t * 0.7) + sin(xv + fy * 12.0 - t * 1.3);
+
+        levels[x] = (v + 3.0) / 6.0;
+    }
+}
+
+/* Background field generators, richest first (see --engine auto). Each
+ * fills a stretch of one row with levels in [0, 1]. */
+struct mf_hidden_engine {
+    const char *name;
+    void (*fill_row)(double *levels, int n, const double *fx, double fy, double z);
+};
+
+static const struct mf_hidden_engine g_hidden_engines[] = {
+    { "value",   mf_hidden_row_value },
+    { "simplex", mf_hidden_row_simplex },
+    { "plasma",  mf_hidden_row_plasma }
+};
+
+#define MF_HIDDEN_ENGINE_COUNT (sizeof(g_hidden_engines) / sizeof(g_hidden_engines[0]))
+
+static const struct mf_hidden_engine *g_hidden_engine = &g_hidden_engines[0];
+static int g_hidden_engine_auto = 0;
+
 static double mf_hidden_now_sec(void)
 {
     struct timespec ts;
@@ -245,10 +583,10 @@ static double mf_hidden_now_sec(void)
     return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
 }
 
-static void mf_hidden_get_term_size(int *rows, int *cols)
+static void mf_hidden_get_term_size(int fd, int *rows, int *cols)
 {
     struct winsize ws;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) {
+    if (ioctl(fd, TIOCGWINSZ, &ws) == 0) {
         *rows = ws.ws_row > 0 ? ws.ws_row : 24;
         *cols = ws.ws_col > 0 ? ws.ws_col : 80;
     } else {
@@ -257,7 +595,11 @@ static void mf_hidden_get_term_size(int *rows, int *cols)
     }
 }
 
-static void mf_hidden_build_gradient(char lut[256])
+/* Maps a noise level to its glyph and, under --gradient, its colour.
+ * Colour is quantized to the glyph steps rather than the 256 levels, so
+ * a cell changes colour only where its glyph changes too: neighbouring
+ * cells share runs and the diff stays as small as in mono. */
+static void mf_hidden_build_gradient(char lut[256], unsigned char colour[256])
 {
     size_t i;
     size_t len;
@@ -276,70 +618,187 @@ static void mf_hidden_build_gradient(char lut[256])
             idx = len - 1;
         }
         lut[i] = gradient[idx];
+        colour[i] = g_hidden_gradient == MF_HIDDEN_GRADIENT_MONO ? 0U : (unsigned char)(1U + idx * (MF_HIDDEN_RAMP_STEPS - 1U) / (len - 1U));
     }
 }
 
-static int mf_hidden_ensure_buffers(int rows, int cols, struct mf_hidden_cell **curr, struct mf_hidden_cell **prev, double **fx, double **fy, int *buf_rows, int *buf_cols)
+/* Matches no cell that is ever drawn, so the next diff redraws it. */
+static void mf_hidden_cell_set_unknown(struct mf_hidden_cell *cell)
+{
+    cell->len = 0U;
+    cell->fg = 0xffU;
+}
+
+/* Makes s a rows x cols screen. prev keeps what it said about the cells
+ * the old and new sizes share and calls every other cell unknown; curr
+ * is left for the caller to fill. The arena only grows. */
+static int mf_hidden_screen_resize(struct mf_hidden_screen *s, int rows, int cols)
 {
     size_t total;
-    struct mf_hidden_cell *new_curr;
-    struct mf_hidden_cell *new_prev;
-    double *new_fx;
-    double *new_fy;
+    int keep_rows;
+    int keep_cols;
+    int y;
+    int x;
 
     if (rows <= 0 || cols <= 0) {
         return -1;
     }
-
-    if (*buf_rows == rows && *buf_cols == cols && *curr && *prev && *fx && *fy) {
+    if (s->arena != NULL && rows == s->rows && cols == s->cols) {
         return 0;
     }
 
     total = (size_t)rows * (size_t)cols;
-    new_curr = (struct mf_hidden_cell *)malloc(total * sizeof(struct mf_hidden_cell));
-    new_prev = (struct mf_hidden_cell *)malloc(total * sizeof(struct mf_hidden_cell));
-    new_fx = (double *)malloc((size_t)cols * sizeof(double));
-    new_fy = (double *)malloc((size_t)rows * sizeof(double));
-
-    if (!new_curr || !new_prev || !new_fx || !new_fy) {
-        free(new_curr);
-        free(new_prev);
-        free(new_fx);
-        free(new_fy);
-        return -1;
+    keep_rows = rows < s->rows ? rows : s->rows;
+    keep_cols = cols < s->cols ? cols : s->cols;
+    if (total > s->cap_cells || rows > s->cap_rows || cols > s->cap_cols) {
+        struct mf_hidden_screen grown = *s;
+        char *arena;
+
+        grown.cap_cells = total > s->cap_cells ? total : s->cap_cells;
+        grown.cap_rows = rows > s->cap_rows ? rows : s->cap_rows;
+        grown.cap_cols = cols > s->cap_cols ? cols : s->cap_cols;
+        /* The doubles go first so both they and the cells are aligned. */
+        arena = (char *)malloc(((size_t)grown.cap_cols + (size_t)grown.cap_rows) * sizeof(double) +
+                               2U * grown.cap_cells * sizeof(struct mf_hidden_cell));
+        if (arena == NULL) {
+            return -1;
+        }
+        grown.arena = arena;
+        grown.fx = (double *)(void *)arena;
+        grown.fy = grown.fx + grown.cap_cols;
+        grown.curr = (struct mf_hidden_cell *)(void *)(grown.fy + grown.cap_rows);
+        grown.prev = grown.curr + grown.cap_cells;
+        for (x = 0; x < grown.cap_cols; ++x) {
+            grown.fx[x] = (double)x * MF_HIDDEN_SCALE;
+        }
+        for (y = 0; y < grown.cap_rows; ++y) {
+            grown.fy[y] = (double)y * MF_HIDDEN_SCALE * 0.5;
+        }
+        for (y = 0; y < keep_rows; ++y) {
+            memcpy(&grown.prev[(size_t)y * (size_t)cols], &s->prev[(size_t)y * (size_t)s->cols],
+                   (size_t)keep_cols * sizeof(struct mf_hidden_cell));
+        }
+        free(s->arena);
+        *s = grown;
+    } else if (cols > s->cols) {
+        /* Rows move to a wider stride: last first, so none is
+         * overwritten before it has moved. */
+        for (y = keep_rows - 1; y > 0; --y) {
+            memmove(&s->prev[(size_t)y * (size_t)cols], &s->prev[(size_t)y * (size_t)s->cols],
+                    (size_t)keep_cols * sizeof(struct mf_hidden_cell));
+        }
+    } else if (cols < s->cols) {
+        for (y = 1; y < keep_rows; ++y) {
+            memmove(&s->prev[(size_t)y * (size_t)cols], &s->prev[(size_t)y * (size_t)s->cols],
+                    (size_t)keep_cols * sizeof(struct mf_hidden_cell));
+        }
     }
+    s->rows = rows;
+    s->cols = cols;
+
+    for (y = 0; y < rows; ++y) {
+        for (x = y < keep_rows ? keep_cols : 0; x < cols; ++x) {
+            mf_hidden_cell_set_unknown(&s->prev[(size_t)y * (size_t)cols + (size_t)x]);
+        }
+    }
+    return 0;
+}
+
+/* For a screen that has just been cleared: prev says blank everywhere. */
+static void mf_hidden_screen_blank(struct mf_hidden_screen *s)
+{
+    size_t total = (size_t)s->rows * (size_t)s->cols;
+    size_t idx;
 
-    free(*curr);
-    free(*prev);
-    free(*fx);
-    free(*fy);
+    for (idx = 0; idx < total; ++idx) {
+        mf_hidden_cell_set_char(&s->prev[idx], ' ');
+        mf_hidden_cell_set_char(&s->curr[idx], ' ');
+    }
+}
 
-    *curr = new_curr;
-    *prev = new_prev;
-    *fx = new_fx;
-    *fy = new_fy;
-    *buf_rows = rows;
-    *buf_cols = cols;
+/* Reads fd's size and returns 1 once a size other than *rows x *cols
+ * has held for MF_HIDDEN_RESIZE_SETTLE_SEC, storing it there. While
+ * rz->pending the caller should draw nothing: the terminal is no longer
+ * the size the frame would be drawn for. */
+static int mf_hidden_resize_poll(struct mf_hidden_resize *rz, int fd, double now, int *rows, int *cols)
+{
+    int new_rows;
+    int new_cols;
 
-    {
-        size_t idx;
-        for (idx = 0; idx < total; ++idx) {
-            mf_hidden_cell_set_char(&(*prev)[idx], ' ');
-            mf_hidden_cell_set_char(&(*curr)[idx], ' ');
-        }
+    mf_hidden_get_term_size(fd, &new_rows, &new_cols);
+    if (new_rows == *rows && new_cols == *cols) {
+        rz->pending = 0;
+        return 0;
     }
+    if (!rz->pending || new_rows != rz->rows || new_cols != rz->cols) {
+        rz->pending = 1;
+        rz->rows = new_rows;
+        rz->cols = new_cols;
+        rz->since = now;
+        return 0;
+    }
+    if (now - rz->since < MF_HIDDEN_RESIZE_SETTLE_SEC) {
+        return 0;
+    }
+    rz->pending = 0;
+    *rows = new_rows;
+    *cols = new_cols;
+    return 1;
+}
 
-    {
-        int x;
-        for (x = 0; x < cols; ++x) {
-            (*fx)[x] = (double)x * MF_HIDDEN_SCALE;
+/* Writes text into row starting at display column *col_disp (relative to
+ * origin) and pads with spaces until span columns are used. Wide glyphs
+ * take two cells, the second left empty so the diff renderer emits nothing
+ * for it; zero-width glyphs ride along with the previous cell when it has
+ * room for the extra bytes. */
+static void mf_hidden_put_text(struct mf_hidden_cell *buf, int cols, int row, int origin, size_t *col_disp, size_t limit, const char *text, size_t span)
+{
+    size_t written = 0;
+    struct mf_hidden_cell *last = NULL;
+    const char *p = text;
+
+    while (*p != '\0' && written < span && *col_disp < limit) {
+        unsigned int glyph_width;
+        size_t glyph_len = mf_utf8_next(p, &glyph_width);
+        int col_index = origin + (int)*col_disp;
+        size_t cell_index;
+
+        if (glyph_len == 0) {
+            break;
+        }
+        if (glyph_width == 0) {
+            if (last != NULL && (size_t)last->len + glyph_len <= sizeof(last->bytes)) {
+                memcpy(last->bytes + last->len, p, glyph_len);
+                last->len = (unsigned char)(last->len + glyph_len);
+            }
+            p += glyph_len;
+            continue;
         }
-        for (x = 0; x < rows; ++x) {
-            (*fy)[x] = (double)x * MF_HIDDEN_SCALE * 0.5;
+        if (glyph_width == 2 && (written + 2 > span || *col_disp + 2 > limit || col_index + 1 >= cols)) {
+            break;
         }
+        last = NULL;
+        if (col_index >= 0 && col_index < cols) {
+            cell_index = (size_t)row * (size_t)cols + (size_t)col_index;
+            mf_hidden_cell_set_utf8(&buf[cell_index], p, glyph_len);
+            last = &buf[cell_index];
+            if (glyph_width == 2) {
+                buf[cell_index + 1].len = 0;
+            }
+        }
+        p += glyph_len;
+        *col_disp += glyph_width;
+        written += glyph_width;
     }
 
-    return 0;
+    while (written < span && *col_disp < limit) {
+        int col_index = origin + (int)*col_disp;
+        if (col_index >= 0 && col_index < cols) {
+            mf_hidden_cell_set_char(&buf[(size_t)row * (size_t)cols + (size_t)col_index], ' ');
+        }
+        ++*col_disp;
+        ++written;
+    }
 }
 
 static void mf_hidden_overlay_buffer(struct mf_hidden_cell *buf, int rows, int cols, char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count)
@@ -415,39 +874,8 @@ static void mf_hidden_overlay_buffer(struct mf_hidden_cell *buf, int rows, int c
         }
 
         if (logo_display_width > 0) {
-            size_t written = 0;
-            if (i < g_logo_line_count) {
-                const char *p = g_logo_lines[i];
-                while (*p != '\0' && written < logo_display_width) {
-                    size_t glyph_len = mf_hidden_utf8_glyph_len(p);
-                    int col_index;
-                    size_t cell_index;
-                    if (glyph_len == 0) {
-                        break;
-                    }
-                    if (col_disp >= inner_width) {
-                        break;
-                    }
-                    col_index = start_col + 1 + (int)col_disp;
-                    if (col_index >= 0 && col_index < cols) {
-                        cell_index = (size_t)row * (size_t)cols + (size_t)col_index;
-                        mf_hidden_cell_set_utf8(&buf[cell_index], p, glyph_len);
-                    }
-                    p += glyph_len;
-                    ++col_disp;
-                    ++written;
-                }
-            }
-            while (written < logo_display_width && col_disp < inner_width) {
-                int col_index = start_col + 1 + (int)col_disp;
-                size_t cell_index;
-                if (col_index >= 0 && col_index < cols) {
-                    cell_index = (size_t)row * (size_t)cols + (size_t)col_index;
-                    mf_hidden_cell_set_char(&buf[cell_index], ' ');
-                }
-                ++col_disp;
-                ++written;
-            }
+            const char *text = i < g_logo_line_count ? g_logo_lines[i] : "";
+            mf_hidden_put_text(buf, cols, row, start_col + 1, &col_disp, inner_width, text, logo_display_width);
         }
 
         if (logo_display_width > 0 && info_display_width > 0) {
@@ -465,43 +893,120 @@ static void mf_hidden_overlay_buffer(struct mf_hidden_cell *buf, int rows, int c
         }
 
         if (info_display_width > 0) {
-            size_t written = 0;
-            if (i < count) {
-                const char *p = formatted[i];
-                while (*p != '\0' && written < info_display_width) {
-                    size_t glyph_len = mf_hidden_utf8_glyph_len(p);
-                    int col_index;
-                    size_t cell_index;
-                    if (glyph_len == 0) {
-                        break;
-                    }
-                    if (col_disp >= inner_width) {
-                        break;
-                    }
-                    col_index = start_col + 1 + (int)col_disp;
-                    if (col_index >= 0 && col_index < cols) {
-                        cell_index = (size_t)row * (size_t)cols + (size_t)col_index;
-                        mf_hidden_cell_set_utf8(&buf[cell_index], p, glyph_len);
-                    }
-                    p += glyph_len;
-                    ++col_disp;
-                    ++written;
-                }
-            }
-            while (written < info_display_width && col_disp < inner_width) {
-                int col_index = start_col + 1 + (int)col_disp;
-                size_t cell_index;
-                if (col_index >= 0 && col_index < cols) {
-                    cell_index = (size_t)row * (size_t)cols + (size_t)col_index;
-                    mf_hidden_cell_set_char(&buf[cell_index], ' ');
+            const char *text = i < count ? formatted[i] : "";
+            mf_hidden_put_text(buf, cols, row, start_col + 1, &col_disp, inner_width, text, info_display_width);
+        }
+    }
+}
+
+static void mf_hidden_fill_noise(struct mf_hidden_cell *buf, int rows, int cols, const double *fx, const double *fy, double z, const char lut[256],
+                                 const unsigned char colour[256])
+{
+    double levels[MF_HIDDEN_ROW_CHUNK];
+    int y;
+
+    for (y = 0; y < rows; ++y) {
+        struct mf_hidden_cell *row = &buf[(size_t)y * (size_t)cols];
+        int x0;
+
+        for (x0 = 0; x0 < cols; x0 += MF_HIDDEN_ROW_CHUNK) {
+            int n = cols - x0 < MF_HIDDEN_ROW_CHUNK ? cols - x0 : MF_HIDDEN_ROW_CHUNK;
+            int x;
+
+            g_hidden_engine->fill_row(levels, n, fx + x0, fy[y], z);
+            for (x = 0; x < n; ++x) {
+                int lut_idx = (int)(levels[x] * 255.0 + 0.5);
+
+                if (lut_idx < 0) {
+                    lut_idx = 0;
+                } else if (lut_idx > 255) {
+                    lut_idx = 255;
                 }
-                ++col_disp;
-                ++written;
+                mf_hidden_cell_set_char(&row[x0 + x], lut[lut_idx]);
+                row[x0 + x].fg = colour[lut_idx];
             }
         }
     }
 }
 
+/* CPU time engine e spends per cell, in nanoseconds, measured on this
+ * machine by filling rows until 2 ms of thread time have passed. */
+static double mf_hidden_engine_cost(const struct mf_hidden_engine *e)
+{
+    double levels[MF_HIDDEN_ROW_CHUNK];
+    double fx[MF_HIDDEN_ROW_CHUNK];
+    struct timespec ts;
+    double start;
+    double elapsed;
+    unsigned long rows = 0;
+    int x;
+
+    for (x = 0; x < MF_HIDDEN_ROW_CHUNK; ++x) {
+        fx[x] = (double)x * MF_HIDDEN_SCALE;
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    start = (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+    do {
+        e->fill_row(levels, MF_HIDDEN_ROW_CHUNK, fx, (double)rows * MF_HIDDEN_SCALE * 0.5, 0.37);
+        rows++;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        elapsed = (double)ts.tv_sec + (double)ts.tv_nsec / 1e9 - start;
+    } while (elapsed < 0.002);
+    return elapsed * 1e9 / ((double)rows * MF_HIDDEN_ROW_CHUNK);
+}
+
+/* Under --engine auto, switches to the richest engine that renders a
+ * field of cells within MF_HIDDEN_ENGINE_BUDGET of a frame; the cheapest
+ * when none does. Costs are measured once per process. */
+static void mf_hidden_engine_pick(size_t cells)
+{
+    static double cost[MF_HIDDEN_ENGINE_COUNT];
+    double budget_ns = MF_HIDDEN_ENGINE_BUDGET * MF_HIDDEN_FRAMETIME_S * 1e9;
+    size_t i;
+
+    if (!g_hidden_engine_auto) {
+        return;
+    }
+    for (i = 0; i < MF_HIDDEN_ENGINE_COUNT; ++i) {
+        if (cost[i] == 0.0) {
+            cost[i] = mf_hidden_engine_cost(&g_hidden_engines[i]);
+        }
+        g_hidden_engine = &g_hidden_engines[i];
+        if (cost[i] * (double)cells <= budget_ns) {
+            break;
+        }
+    }
+}
+
+int mf_hidden_set_engine(const char *name)
+{
+    size_t i;
+
+    if (strcmp(name, "auto") == 0) {
+        g_hidden_engine_auto = 1;
+        return 0;
+    }
+    for (i = 0; i < MF_HIDDEN_ENGINE_COUNT; ++i) {
+        if (strcmp(name, g_hidden_engines[i].name) == 0) {
+            g_hidden_engine = &g_hidden_engines[i];
+            g_hidden_engine_auto = 0;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void mf_hidden_list_engines(void)
+{
+    size_t i;
+
+    for (i = 0; i < MF_HIDDEN_ENGINE_COUNT; ++i) {
+        double ns = mf_hidden_engine_cost(&g_hidden_engines[i]);
+
+        printf("%-8s %7.1f ns/cell  %6.2f ms per 200x50 frame\n", g_hidden_engines[i].name, ns, ns * 200.0 * 50.0 / 1e6);
+    }
+}
+
 static void mf_hidden_write_hud(struct mf_hidden_cell *buf, int rows, int cols)
 {
     const char *hud = "press q to exit hidden mode";
@@ -523,85 +1028,481 @@ static void mf_hidden_write_hud(struct mf_hidden_cell *buf, int rows, int cols)
     }
 }
 
-static void mf_hidden_present_diff(const struct mf_hidden_cell *curr, struct mf_hidden_cell *prev, int rows, int cols)
+/* Makes sure frame can hold a full redraw of a rows x cols screen. */
+static int mf_hidden_frame_reserve(struct mf_hidden_frame *frame, int rows, int cols)
+{
+    size_t need = (size_t)rows * (size_t)cols * MF_HIDDEN_CELL_BYTES_MAX + MF_HIDDEN_CLEAR_MAX + 2U * MF_HIDDEN_SYNC_LEN;
+    char *grown;
+
+    if (frame->cap >= need) {
+        return 0;
+    }
+    grown = (char *)realloc(frame->data, need);
+    if (grown == NULL) {
+        return -1;
+    }
+    frame->data = grown;
+    frame->cap = need;
+    return 0;
+}
+
+static void mf_hidden_frame_put(struct mf_hidden_frame *frame, const char *bytes, size_t len)
+{
+    memcpy(frame->data + frame->len, bytes, len);
+    frame->len += len;
+}
+
+/* Sets the scroll region above the HUD row of a rows-high screen. */
+static void mf_hidden_encode_region(struct mf_hidden_frame *frame, int rows)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, frame->data + frame->len, frame->cap - frame->len);
+    mf_fmt_str(&f, "\x1b[r");
+    if (rows > 1) {
+        mf_fmt_str(&f, "\x1b[1;");
+        mf_fmt_uint(&f, (uint64_t)(rows - 1));
+        mf_fmt_str(&f, "r");
+    }
+    frame->len += f.len;
+}
+
+/* Clears the screen and sets the scroll region above the HUD row. */
+static void mf_hidden_encode_clear(struct mf_hidden_frame *frame, int rows)
+{
+    mf_hidden_encode_region(frame, rows);
+    mf_hidden_frame_put(frame, "\x1b[2J\x1b[H", 7U);
+}
+
+static int mf_hidden_cell_same(const struct mf_hidden_cell *a, const struct mf_hidden_cell *b)
+{
+    return a->len == b->len && a->fg == b->fg && memcmp(a->bytes, b->bytes, a->len) == 0;
+}
+
+/* Appends the cells that differ from prev, one cursor move per changed
+ * run, and brings prev up to date. *sgr is the colour the terminal is
+ * left in by everything encoded so far; an SGR goes out only where a
+ * cell's colour differs from it, never per cell. With rep, a run of one
+ * ASCII glyph is sent once and repeated by the terminal (REP). frame
+ * must have room for a full redraw (mf_hidden_frame_reserve). */
+static void mf_hidden_encode_diff(const struct mf_hidden_cell *curr, struct mf_hidden_cell *prev, int rows, int cols, unsigned char *sgr,
+                                  int rep, struct mf_hidden_frame *frame)
 {
     size_t total = (size_t)rows * (size_t)cols;
     size_t pos = 0;
 
     while (pos < total) {
-        if (curr[pos].len != prev[pos].len || memcmp(curr[pos].bytes, prev[pos].bytes, curr[pos].len) != 0) {
+        if (!mf_hidden_cell_same(&curr[pos], &prev[pos])) {
             size_t row = pos / (size_t)cols;
             size_t col = pos % (size_t)cols;
             size_t idx = pos + 1;
+            struct mf_fmt f;
 
             while (idx < total) {
                 size_t next_row = idx / (size_t)cols;
                 if (next_row != row) {
                     break;
                 }
-                if (curr[idx].len == prev[idx].len && memcmp(curr[idx].bytes, prev[idx].bytes, curr[idx].len) == 0) {
+                if (mf_hidden_cell_same(&curr[idx], &prev[idx])) {
                     break;
                 }
                 ++idx;
             }
 
-            fprintf(stdout, "\x1b[%lu;%luH", (unsigned long)(row + 1), (unsigned long)(col + 1));
+            mf_fmt_init(&f, frame->data + frame->len, frame->cap - frame->len);
+            mf_fmt_str(&f, "\x1b[");
+            mf_fmt_uint(&f, (uint64_t)(row + 1));
+            mf_fmt_str(&f, ";");
+            mf_fmt_uint(&f, (uint64_t)(col + 1));
+            mf_fmt_str(&f, "H");
+            frame->len += f.len;
             while (pos < idx) {
-                fwrite(curr[pos].bytes, 1, curr[pos].len, stdout);
+                if (curr[pos].len > 0U && curr[pos].fg != *sgr) {
+                    *sgr = curr[pos].fg;
+                    mf_hidden_frame_put(frame, g_hidden_sgr[*sgr], g_hidden_sgr_len[*sgr]);
+                }
+                mf_hidden_frame_put(frame, curr[pos].bytes, curr[pos].len);
                 prev[pos] = curr[pos];
                 ++pos;
+                if (rep && curr[pos - 1U].len == 1U) {
+                    size_t same = 0U;
+
+                    while (pos + same < idx && mf_hidden_cell_same(&curr[pos + same], &curr[pos - 1U])) {
+                        ++same;
+                    }
+                    if (same >= MF_HIDDEN_REP_MIN) {
+                        mf_fmt_init(&f, frame->data + frame->len, frame->cap - frame->len);
+                        mf_fmt_str(&f, "\x1b[");
+                        mf_fmt_uint(&f, (uint64_t)same);
+                        mf_fmt_str(&f, "b");
+                        frame->len += f.len;
+                        memcpy(&prev[pos], &curr[pos], same * sizeof(*curr));
+                        pos += same;
+                    }
+                }
             }
         } else {
             prev[pos] = curr[pos];
             ++pos;
         }
     }
+}
 
-    fflush(stdout);
+/* Brackets a frame in synchronized output where the terminal has it, so
+ * one too big to arrive in a single read is still painted at once. */
+static void mf_hidden_frame_sync(struct mf_hidden_frame *frame)
+{
+    if ((g_hidden_caps & MF_TERMCAP_SYNC) == 0U || frame->len < MF_HIDDEN_SYNC_MIN) {
+        return;
+    }
+    memmove(frame->data + MF_HIDDEN_SYNC_LEN, frame->data, frame->len);
+    memcpy(frame->data, "\x1b[?2026h", MF_HIDDEN_SYNC_LEN);
+    memcpy(frame->data + MF_HIDDEN_SYNC_LEN + frame->len, "\x1b[?2026l", MF_HIDDEN_SYNC_LEN);
+    frame->len += 2U * MF_HIDDEN_SYNC_LEN;
 }
 
-int mf_run_hidden_mode(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, int quiet_mode)
+/* The free slot the producer may fill next, or NULL while the writer
+ * still holds every slot. */
+static struct mf_hidden_frame *mf_hidden_ring_claim(struct mf_hidden_ring *ring)
 {
-    char gradient_lut[256];
-    int rows;
-    int cols;
-    struct mf_hidden_cell *curr_buf = NULL;
-    struct mf_hidden_cell *prev_buf = NULL;
-    double *fx = NULL;
-    double *fy = NULL;
-    int buf_rows = 0;
-    int buf_cols = 0;
-    double start_time;
-    double next_deadline;
-    double last_size_check;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
 
-    (void)quiet_mode;
+    if (ring->head - tail >= MF_HIDDEN_RING_SLOTS) {
+        return NULL;
+    }
+    return &ring->slot[ring->head % MF_HIDDEN_RING_SLOTS];
+}
 
-    if (!isatty(STDOUT_FILENO)) {
-        size_t i;
-        for (i = 0; i < count; ++i) {
-            fputs(formatted[i], stdout);
-            fputc('\n', stdout);
+static void mf_hidden_ring_push(struct mf_hidden_ring *ring)
+{
+    __atomic_store_n(&ring->head, ring->head + 1U, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_signal(&ring->ready);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/* Writer stage: drains frames in order with plain write(2), so a terminal
+ * that applies backpressure blocks only this thread. */
+static void *mf_hidden_writer(void *arg)
+{
+    struct mf_hidden_ring *ring = (struct mf_hidden_ring *)arg;
+
+    for (;;) {
+        struct mf_hidden_frame *frame;
+        unsigned int head;
+
+        pthread_mutex_lock(&ring->lock);
+        for (;;) {
+            head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            if (head != ring->tail || __atomic_load_n(&ring->stop, __ATOMIC_RELAXED)) {
+                break;
+            }
+            pthread_cond_wait(&ring->ready, &ring->lock);
+        }
+        pthread_mutex_unlock(&ring->lock);
+        if (head == ring->tail) {
+            return NULL;
+        }
+
+        /* Frames still queued at shutdown are stale; only the one
+         * already on the wire is finished. */
+        frame = &ring->slot[ring->tail % MF_HIDDEN_RING_SLOTS];
+        if (!ring->failed && !__atomic_load_n(&ring->stop, __ATOMIC_RELAXED) &&
+            mf_write_all(STDOUT_FILENO, frame->data, frame->len) != 0) {
+            __atomic_store_n(&ring->failed, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&ring->tail, ring->tail + 1U, __ATOMIC_RELEASE);
+    }
+}
+
+/* Starts the writer with SIGINT/SIGTERM blocked so they land on the
+ * producer, which owns the shutdown. */
+static int mf_hidden_ring_start(struct mf_hidden_ring *ring, pthread_t *tid)
+{
+    sigset_t block;
+    sigset_t old;
+    int rc;
+
+    memset(ring, 0, sizeof(*ring));
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->ready, NULL);
+
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    rc = pthread_create(tid, NULL, mf_hidden_writer, ring);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        pthread_cond_destroy(&ring->ready);
+        pthread_mutex_destroy(&ring->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/* Waits for the frame being written, then releases the slots. */
+static void mf_hidden_ring_stop(struct mf_hidden_ring *ring, pthread_t tid)
+{
+    size_t i;
+
+    pthread_mutex_lock(&ring->lock);
+    __atomic_store_n(&ring->stop, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&ring->ready);
+    pthread_mutex_unlock(&ring->lock);
+    pthread_join(tid, NULL);
+
+    for (i = 0; i < MF_HIDDEN_RING_SLOTS; ++i) {
+        free(ring->slot[i].data);
+    }
+    pthread_cond_destroy(&ring->ready);
+    pthread_mutex_destroy(&ring->lock);
+}
+
+void mf_hidden_set_refresh(mf_hidden_collect_fn collect, void *ctx, size_t max_rows, unsigned int interval_s)
+{
+    g_hidden_collect = collect;
+    g_hidden_collect_ctx = ctx;
+    g_hidden_collect_rows = max_rows;
+    g_hidden_refresh_s = interval_s;
+}
+
+static void *mf_hidden_collector(void *arg)
+{
+    struct mf_hidden_live *live = (struct mf_hidden_live *)arg;
+    struct timespec due;
+
+    clock_gettime(CLOCK_MONOTONIC, &due);
+    pthread_mutex_lock(&live->lock);
+    for (;;) {
+        unsigned int gen;
+        unsigned int slot;
+
+        due.tv_sec += (time_t)g_hidden_refresh_s;
+        while (!live->stop && pthread_cond_timedwait(&live->wake, &live->lock, &due) != ETIMEDOUT) {
+        }
+        if (live->stop) {
+            break;
+        }
+        /* The renderer has not shown the last panel yet (it is skipping
+         * frames): keep it rather than overwrite one in use. */
+        gen = live->published;
+        if (__atomic_load_n(&live->seen, __ATOMIC_ACQUIRE) != gen) {
+            continue;
+        }
+        pthread_mutex_unlock(&live->lock);
+        slot = (gen + 1U) & 1U;
+        live->count[slot] = g_hidden_collect(live->formatted[slot], live->widths[slot], g_hidden_collect_ctx);
+        __atomic_store_n(&live->published, gen + 1U, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&live->lock);
+    }
+    pthread_mutex_unlock(&live->lock);
+    return NULL;
+}
+
+/* Starts the collector when --refresh is on; otherwise, or if it cannot
+ * start, the panel simply stays as first collected. */
+static void mf_hidden_live_start(struct mf_hidden_live *live)
+{
+    pthread_condattr_t attr;
+    sigset_t block;
+    sigset_t old;
+    size_t i;
+
+    memset(live, 0, sizeof(*live));
+    if (g_hidden_collect == NULL || g_hidden_refresh_s == 0U) {
+        return;
+    }
+    for (i = 0; i < 2U; ++i) {
+        live->formatted[i] = calloc(g_hidden_collect_rows, sizeof(*live->formatted[i]));
+        live->widths[i] = calloc(g_hidden_collect_rows, sizeof(*live->widths[i]));
+        if (live->formatted[i] == NULL || live->widths[i] == NULL) {
+            return;
+        }
+    }
+    pthread_mutex_init(&live->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&live->wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    /* Like the writer, it leaves SIGINT/SIGTERM to the renderer. */
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    live->running = pthread_create(&live->tid, NULL, mf_hidden_collector, live) == 0;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (!live->running) {
+        pthread_cond_destroy(&live->wake);
+        pthread_mutex_destroy(&live->lock);
+    }
+}
+
+/* Called as a frame starts: switches to the newest panel, if any. */
+static void mf_hidden_live_poll(struct mf_hidden_live *live, struct mf_hidden_panel *panel)
+{
+    unsigned int gen;
+
+    if (!live->running) {
+        return;
+    }
+    gen = __atomic_load_n(&live->published, __ATOMIC_ACQUIRE);
+    if (gen != live->seen) {
+        panel->formatted = live->formatted[gen & 1U];
+        panel->widths = live->widths[gen & 1U];
+        panel->count = live->count[gen & 1U];
+        __atomic_store_n(&live->seen, gen, __ATOMIC_RELEASE);
+    }
+}
+
+/* Waits for a collection in progress to finish. */
+static void mf_hidden_live_stop(struct mf_hidden_live *live)
+{
+    size_t i;
+
+    if (live->running) {
+        pthread_mutex_lock(&live->lock);
+        live->stop = 1;
+        pthread_cond_signal(&live->wake);
+        pthread_mutex_unlock(&live->lock);
+        pthread_join(live->tid, NULL);
+        pthread_cond_destroy(&live->wake);
+        pthread_mutex_destroy(&live->lock);
+    }
+    for (i = 0; i < 2U; ++i) {
+        free(live->formatted[i]);
+        free(live->widths[i]);
+    }
+}
+
+/* Non-blocking check for 'q' on stdin. Escape sequences, such as arrow
+ * keys, are skipped whole. */
+static int mf_hidden_quit_pressed(void)
+{
+    fd_set set;
+    struct timeval tv;
+
+    FD_ZERO(&set);
+    FD_SET(STDIN_FILENO, &set);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    if (select(STDIN_FILENO + 1, &set, NULL, NULL, &tv) > 0) {
+        char in[64];
+        ssize_t n = read(STDIN_FILENO, in, sizeof(in));
+        ssize_t i;
+
+        for (i = 0; i < n; ++i) {
+            char ch = in[i];
+
+            if (g_hidden_input_state == 2) {
+                if (ch >= 0x40 && ch <= 0x7e) {
+                    g_hidden_input_state = 0;
+                }
+            } else if (g_hidden_input_state == 1) {
+                g_hidden_input_state = ch == '[' ? 2 : 0;
+            } else if (ch == '\x1b') {
+                g_hidden_input_state = 1;
+            } else if (ch == 'q' || ch == 'Q') {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void mf_hidden_sleep_until(double deadline)
+{
+    double sleep_s = deadline - mf_hidden_now_sec();
+    struct timespec ts;
+
+    if (sleep_s <= 0.0) {
+        return;
+    }
+    ts.tv_sec = (time_t)sleep_s;
+    ts.tv_nsec = (long)((sleep_s - (double)ts.tv_sec) * 1e9);
+    if (ts.tv_nsec < 0) {
+        ts.tv_nsec = 0;
+    }
+    nanosleep(&ts, NULL);
+}
+
+/* Sleeps until the frame after next_deadline is due and returns its
+ * deadline; a late frame restarts the cadence instead of bursting. */
+static double mf_hidden_wait_frame(double next_deadline)
+{
+    double now;
+
+    next_deadline += MF_HIDDEN_FRAMETIME_S;
+    now = mf_hidden_now_sec();
+    if (next_deadline <= now) {
+        next_deadline = now + MF_HIDDEN_FRAMETIME_S;
+    } else {
+        mf_hidden_sleep_until(next_deadline);
+    }
+    return next_deadline;
+}
+
+int mf_run_hidden_mode(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, int quiet_mode)
+{
+    char gradient_lut[256];
+    unsigned char colour_lut[256];
+    int rows;
+    int cols;
+    struct mf_hidden_screen screen;
+    struct mf_hidden_resize resize;
+    struct mf_hidden_ring ring;
+    pthread_t writer;
+    int clear_pending;
+    int region_pending;
+    unsigned char sgr = 0;
+    double start_time;
+    double next_deadline;
+    double last_size_check;
+    struct mf_rec_writer rec;
+    int recording = 0;
+    uint64_t rec_last_ms = 0U;
+    struct mf_hidden_live refresh;
+    struct mf_hidden_panel panel;
+    int rc = 0;
+
+    (void)quiet_mode;
+
+    if (!isatty(STDOUT_FILENO)) {
+        size_t i;
+        for (i = 0; i < count; ++i) {
+            fputs(formatted[i], stdout);
+            fputc('\n', stdout);
         }
         return 0;
     }
 
+    mf_hidden_get_term_size(STDOUT_FILENO, &rows, &cols);
+    if (g_hidden_record_path != NULL) {
+        if (mf_rec_open(&rec, g_hidden_record_path, rows, cols) != 0) {
+            return -1;
+        }
+        recording = 1;
+    }
+
     setvbuf(stdout, NULL, _IOFBF, MF_HIDDEN_BUFFER_CAP);
 
     mf_hidden_setup_signals();
+    mf_hidden_enter_alt_screen();
     mf_hidden_hide_cursor();
     mf_hidden_enable_raw();
 
-    mf_hidden_get_term_size(&rows, &cols);
-    mf_hidden_build_gradient(gradient_lut);
-    if (mf_hidden_ensure_buffers(rows, cols, &curr_buf, &prev_buf, &fx, &fy, &buf_rows, &buf_cols) != 0) {
+    mf_hidden_build_gradient(gradient_lut, colour_lut);
+    memset(&screen, 0, sizeof(screen));
+    if (mf_hidden_screen_resize(&screen, rows, cols) != 0) {
         mf_hidden_cleanup();
-        free(curr_buf);
-        free(prev_buf);
-        free(fx);
-        free(fy);
+        if (recording) {
+            mf_rec_close(&rec);
+        }
         return -1;
     }
+    mf_hidden_screen_blank(&screen);
+    mf_hidden_engine_pick((size_t)rows * (size_t)cols);
 
     fprintf(stdout, "\x1b[2J");
     if (rows > 1) {
@@ -609,113 +1510,590 @@ int mf_run_hidden_mode(char formatted[][MF_FORMATTED_LINE_MAX], const size_t wid
         g_hidden_scroll_region_set = 1;
     }
     fprintf(stdout, "\x1b[H");
+    /* Everything after this goes through the writer thread. */
+    fflush(stdout);
 
     atexit(mf_hidden_cleanup);
 
+    if (mf_hidden_ring_start(&ring, &writer) != 0) {
+        mf_hidden_cleanup();
+        if (recording) {
+            mf_rec_close(&rec);
+        }
+        free(screen.arena);
+        return -1;
+    }
+    clear_pending = 0;
+    region_pending = 0;
+    memset(&resize, 0, sizeof(resize));
+    panel.formatted = formatted;
+    panel.widths = widths;
+    panel.count = count;
+    mf_hidden_live_start(&refresh);
+
     start_time = mf_hidden_now_sec();
     next_deadline = start_time + MF_HIDDEN_FRAMETIME_S;
     last_size_check = start_time;
 
-    while (g_hidden_running) {
+    while (g_hidden_running && !__atomic_load_n(&ring.failed, __ATOMIC_RELAXED)) {
         double now = mf_hidden_now_sec();
+        struct mf_hidden_frame *frame;
         double z;
-        int y;
 
-        if (now - last_size_check > MF_HIDDEN_SIZE_REFRESH_SEC) {
-            int new_rows;
-            int new_cols;
-            mf_hidden_get_term_size(&new_rows, &new_cols);
-            if (new_rows != rows || new_cols != cols) {
-                rows = new_rows;
-                cols = new_cols;
-            if (mf_hidden_ensure_buffers(rows, cols, &curr_buf, &prev_buf, &fx, &fy, &buf_rows, &buf_cols) != 0) {
+        if (g_hidden_winch || resize.pending || now - last_size_check > MF_HIDDEN_SIZE_REFRESH_SEC) {
+            int old_rows = rows;
+            int old_cols = cols;
+
+            g_hidden_winch = 0;
+            last_size_check = now;
+            if (mf_hidden_resize_poll(&resize, STDOUT_FILENO, now, &rows, &cols)) {
+                if (mf_hidden_screen_resize(&screen, rows, cols) != 0) {
+                    break;
+                }
+                if (recording && mf_rec_resize(&rec, rows, cols) != 0) {
+                    break;
+                }
+                mf_hidden_engine_pick((size_t)rows * (size_t)cols);
+                /* Sent ahead of the next frame the writer gets. A grown
+                 * screen still shows everything it did, so only the new
+                 * cells (and whatever moved) are drawn; a shrunk one is
+                 * cleared, as the terminal may have cut or scrolled it. */
+                if (rows >= old_rows && cols >= old_cols) {
+                    region_pending = 1;
+                } else {
+                    mf_hidden_screen_blank(&screen);
+                    clear_pending = 1;
+                }
+            }
+        }
+
+        z = (now - start_time) * MF_HIDDEN_SPEED;
+        if (z < 0.0) {
+            z = 0.0;
+        }
+
+        /* Writer still busy with older frames: drop this one unrendered.
+         * prev keeps describing what was last queued, so the next diff
+         * catches the terminal up. Nothing is drawn either while a new
+         * size settles. */
+        frame = resize.pending ? NULL : mf_hidden_ring_claim(&ring);
+        if (frame != NULL) {
+            if (mf_hidden_frame_reserve(frame, rows, cols) != 0) {
                 break;
             }
-                fprintf(stdout, "\x1b[r\x1b[2J");
-                if (rows > 1) {
-                    fprintf(stdout, "\x1b[1;%dr", rows - 1);
-                    g_hidden_scroll_region_set = 1;
-                }
-                fprintf(stdout, "\x1b[H");
-            {
-                size_t total = (size_t)rows * (size_t)cols;
-                size_t idx;
-                for (idx = 0; idx < total; ++idx) {
-                    prev_buf[idx] = curr_buf[idx];
+            mf_hidden_fill_noise(screen.curr, rows, cols, screen.fx, screen.fy, z, gradient_lut, colour_lut);
+            /* A fresh panel lands in curr like any other text, so the
+             * diff sends only the cells whose text changed. */
+            mf_hidden_live_poll(&refresh, &panel);
+            mf_hidden_overlay_buffer(screen.curr, rows, cols, panel.formatted, panel.widths, panel.count);
+            mf_hidden_write_hud(screen.curr, rows, cols);
+            frame->len = 0U;
+            if (clear_pending) {
+                mf_hidden_encode_clear(frame, rows);
+                g_hidden_scroll_region_set = rows > 1;
+                clear_pending = 0;
+            } else if (region_pending) {
+                mf_hidden_encode_region(frame, rows);
+                g_hidden_scroll_region_set = rows > 1;
+                region_pending = 0;
+            }
+            mf_hidden_encode_diff(screen.curr, screen.prev, rows, cols, &sgr, (g_hidden_caps & MF_TERMCAP_REP) != 0U, frame);
+            if (frame->len > 0U) {
+                mf_hidden_frame_sync(frame);
+                mf_hidden_ring_push(&ring);
+                if (recording) {
+                    uint64_t t_ms = (uint64_t)((now - start_time) * 1000.0);
+
+                    mf_rec_frame(&rec, screen.curr, (uint32_t)(t_ms - rec_last_ms));
+                    rec_last_ms = t_ms;
                 }
             }
         }
+
+        if (mf_hidden_quit_pressed()) {
+            break;
+        }
+        next_deadline = mf_hidden_wait_frame(next_deadline);
+    }
+
+    mf_hidden_live_stop(&refresh);
+    mf_hidden_ring_stop(&ring, writer);
+    mf_hidden_cleanup();
+    if (recording && mf_rec_close(&rec) != 0) {
+        rc = -1;
+    }
+    free(screen.arena);
+    return rc;
+}
+
+/* Keeps the buffers when they are big enough, as they are whenever the
+ * terminal shrinks. */
+static int mf_hidden_sink_resize(struct mf_hidden_sink *sink, int rows, int cols)
+{
+    size_t total = (size_t)rows * (size_t)cols;
+    size_t idx;
+
+    if (total > sink->cap) {
+        struct mf_hidden_cell *curr;
+        struct mf_hidden_cell *prev;
+
+        curr = (struct mf_hidden_cell *)malloc(total * sizeof(struct mf_hidden_cell));
+        prev = (struct mf_hidden_cell *)malloc(total * sizeof(struct mf_hidden_cell));
+        if (curr == NULL || prev == NULL) {
+            free(curr);
+            free(prev);
+            return -1;
+        }
+        free(sink->curr);
+        free(sink->prev);
+        sink->curr = curr;
+        sink->prev = prev;
+        sink->cap = total;
+    }
+    for (idx = 0; idx < total; ++idx) {
+        mf_hidden_cell_set_char(&sink->curr[idx], ' ');
+        mf_hidden_cell_set_char(&sink->prev[idx], ' ');
+    }
+    sink->rows = rows;
+    sink->cols = cols;
+    /* prev now says blank, so the screen has to be blank too. */
+    sink->clear_pending = 1;
+    return 0;
+}
+
+/* Hands the sink as much of its pending frame as it takes without
+ * blocking. 0 when the frame is out, 1 while bytes remain, -1 when the
+ * terminal is gone. */
+static int mf_hidden_sink_flush(struct mf_hidden_sink *sink)
+{
+    while (sink->sent < sink->out.len) {
+        ssize_t n = write(sink->fd, sink->out.data + sink->sent, sink->out.len - sink->sent);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+        }
+        sink->sent += (size_t)n;
+    }
+    return 0;
+}
+
+static void mf_hidden_sink_drop(struct mf_hidden_sink *sink)
+{
+    if (sink->fd >= 0) {
+        close(sink->fd);
+        sink->fd = -1;
+    }
+}
+
+/* Lets a live sink finish the frame it is on, so no escape sequence is
+ * left cut in half, then restores the cursor and scroll region. */
+static void mf_hidden_sink_close(struct mf_hidden_sink *sink)
+{
+    static const char restore[] = "\x1b[r\x1b[?25h\x1b[0m";
+    struct pollfd pfd;
+    int rc;
+
+    if (sink->fd >= 0) {
+        pfd.fd = sink->fd;
+        pfd.events = POLLOUT;
+        while ((rc = mf_hidden_sink_flush(sink)) == 1 && poll(&pfd, 1, MF_HIDDEN_SINK_CLOSE_MS) > 0) {
+        }
+        if (rc == 0) {
+            (void)mf_write_all(sink->fd, restore, sizeof(restore) - 1U);
+        }
+        mf_hidden_sink_drop(sink);
+    }
+    free(sink->curr);
+    free(sink->prev);
+    free(sink->out.data);
+}
+
+int mf_run_hidden_broadcast(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, const char *const paths[], size_t npaths)
+{
+    char gradient_lut[256];
+    unsigned char colour_lut[256];
+    struct mf_hidden_sink *sinks;
+    struct mf_hidden_screen field;
+    double start_time;
+    double next_deadline;
+    double last_size_check;
+    struct mf_hidden_live refresh;
+    struct mf_hidden_panel panel;
+    struct sigaction sa;
+    size_t i;
+    int rc;
+
+    sinks = (struct mf_hidden_sink *)calloc(npaths, sizeof(*sinks));
+    if (sinks == NULL) {
+        return -1;
+    }
+    rc = 0;
+    for (i = 0; i < npaths; ++i) {
+        sinks[i].fd = open(paths[i], O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (sinks[i].fd < 0) {
+            rc = -1;
+        }
+    }
+    for (i = 0; i < npaths && rc == 0; ++i) {
+        int rows;
+        int cols;
+
+        mf_hidden_get_term_size(sinks[i].fd, &rows, &cols);
+        rc = mf_hidden_sink_resize(&sinks[i], rows, cols);
+    }
+    if (rc != 0) {
+        for (i = 0; i < npaths; ++i) {
+            mf_hidden_sink_drop(&sinks[i]);
+            free(sinks[i].curr);
+            free(sinks[i].prev);
+        }
+        free(sinks);
+        return -1;
+    }
+
+    mf_hidden_setup_signals();
+    /* A sink that is a FIFO with no reader should be dropped, not end
+     * the process. */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+    mf_hidden_enable_raw();
+    mf_hidden_build_gradient(gradient_lut, colour_lut);
+    memset(&field, 0, sizeof(field));
+    panel.formatted = formatted;
+    panel.widths = widths;
+    panel.count = count;
+    mf_hidden_live_start(&refresh);
+
+    start_time = mf_hidden_now_sec();
+    next_deadline = start_time + MF_HIDDEN_FRAMETIME_S;
+    last_size_check = start_time;
+
+    while (g_hidden_running) {
+        double now = mf_hidden_now_sec();
+        int rows = 0;
+        int cols = 0;
+        int rendered = 0;
+        size_t live = 0;
+        double z;
+
+        if (now - last_size_check > MF_HIDDEN_SIZE_REFRESH_SEC) {
+            for (i = 0; i < npaths; ++i) {
+                int new_rows;
+                int new_cols;
+
+                if (sinks[i].fd < 0) {
+                    continue;
+                }
+                mf_hidden_get_term_size(sinks[i].fd, &new_rows, &new_cols);
+                if ((new_rows != sinks[i].rows || new_cols != sinks[i].cols) &&
+                    mf_hidden_sink_resize(&sinks[i], new_rows, new_cols) != 0) {
+                    mf_hidden_sink_drop(&sinks[i]);
+                }
+            }
             last_size_check = now;
         }
 
+        /* One field covers the largest sink; smaller ones show its top
+         * left corner, so every display shows the same pattern. */
+        for (i = 0; i < npaths; ++i) {
+            if (sinks[i].fd >= 0) {
+                rows = sinks[i].rows > rows ? sinks[i].rows : rows;
+                cols = sinks[i].cols > cols ? sinks[i].cols : cols;
+                live++;
+            }
+        }
+        if (live == 0U) {
+            break;
+        }
+        if (mf_hidden_screen_resize(&field, rows, cols) != 0) {
+            break;
+        }
+        mf_hidden_engine_pick((size_t)rows * (size_t)cols);
+        mf_hidden_live_poll(&refresh, &panel);
+
         z = (now - start_time) * MF_HIDDEN_SPEED;
         if (z < 0.0) {
             z = 0.0;
         }
 
-        for (y = 0; y < rows; ++y) {
-            int x;
-            double fyv = fy[y];
-            size_t row_base = (size_t)y * (size_t)cols;
-            for (x = 0; x < cols; ++x) {
-                double fxv = fx[x];
-                double n = mf_hidden_fbm3(fxv, fyv, z, 4, 2.0, 0.5);
-                double bands = 0.5 * (sin(n * 10.0 * M_PI) + 1.0);
-                double v = 0.65 * n + 0.35 * bands;
-                int lut_idx = (int)(v * 255.0 + 0.5);
-                if (lut_idx < 0) {
-                    lut_idx = 0;
-                } else if (lut_idx > 255) {
-                    lut_idx = 255;
-                }
-                mf_hidden_cell_set_char(&curr_buf[row_base + (size_t)x], gradient_lut[lut_idx]);
-            }
-        }
-
-        mf_hidden_overlay_buffer(curr_buf, rows, cols, formatted, widths, count);
-        mf_hidden_write_hud(curr_buf, rows, cols);
-        mf_hidden_present_diff(curr_buf, prev_buf, rows, cols);
-
-        {
-            fd_set set;
-            struct timeval tv;
-            FD_ZERO(&set);
-            FD_SET(STDIN_FILENO, &set);
-            tv.tv_sec = 0;
-            tv.tv_usec = 0;
-            if (select(STDIN_FILENO + 1, &set, NULL, NULL, &tv) > 0) {
-                char ch;
-                if (read(STDIN_FILENO, &ch, 1) > 0) {
-                    if (ch == 'q' || ch == 'Q') {
-                        break;
-                    }
+        for (i = 0; i < npaths; ++i) {
+            struct mf_hidden_sink *sink = &sinks[i];
+            int y;
+
+            if (sink->fd < 0) {
+                continue;
+            }
+            /* Still busy with an older frame: skip this one for it. prev
+             * matches what it was sent, so its next diff catches up. */
+            rc = mf_hidden_sink_flush(sink);
+            if (rc != 0) {
+                if (rc < 0) {
+                    mf_hidden_sink_drop(sink);
                 }
+                continue;
+            }
+            if (mf_hidden_frame_reserve(&sink->out, sink->rows, sink->cols) != 0) {
+                mf_hidden_sink_drop(sink);
+                continue;
+            }
+            if (!rendered) {
+                mf_hidden_fill_noise(field.curr, field.rows, field.cols, field.fx, field.fy, z, gradient_lut, colour_lut);
+                rendered = 1;
+            }
+            for (y = 0; y < sink->rows; ++y) {
+                memcpy(&sink->curr[(size_t)y * (size_t)sink->cols], &field.curr[(size_t)y * (size_t)field.cols],
+                       (size_t)sink->cols * sizeof(struct mf_hidden_cell));
+            }
+            mf_hidden_overlay_buffer(sink->curr, sink->rows, sink->cols, panel.formatted, panel.widths, panel.count);
+            mf_hidden_write_hud(sink->curr, sink->rows, sink->cols);
+
+            sink->out.len = 0U;
+            sink->sent = 0U;
+            if (sink->clear_pending) {
+                mf_hidden_frame_put(&sink->out, "\x1b[?25l", 6U);
+                mf_hidden_encode_clear(&sink->out, sink->rows);
+                sink->clear_pending = 0;
+            }
+            mf_hidden_encode_diff(sink->curr, sink->prev, sink->rows, sink->cols, &sink->sgr, 0, &sink->out);
+            if (mf_hidden_sink_flush(sink) < 0) {
+                mf_hidden_sink_drop(sink);
             }
         }
 
-        next_deadline += MF_HIDDEN_FRAMETIME_S;
+        if (mf_hidden_quit_pressed()) {
+            break;
+        }
+        next_deadline = mf_hidden_wait_frame(next_deadline);
+    }
+
+    mf_hidden_live_stop(&refresh);
+    for (i = 0; i < npaths; ++i) {
+        mf_hidden_sink_close(&sinks[i]);
+    }
+    mf_hidden_disable_raw();
+    free(sinks);
+    free(field.arena);
+    return 0;
+}
+
+/* Copies the part of the recorded screen that fits a rows x cols
+ * terminal; a wide glyph cut in half by the right edge becomes a blank. */
+static void mf_hidden_clip(struct mf_hidden_cell *dst, int rows, int cols, const struct mf_rec_reader *r)
+{
+    int y;
+
+    for (y = 0; y < rows; ++y) {
+        int x;
+
+        for (x = 0; x < cols; ++x) {
+            struct mf_hidden_cell *cell = &dst[(size_t)y * (size_t)cols + (size_t)x];
+            size_t src = (size_t)y * (size_t)r->cols + (size_t)x;
+
+            if (y >= r->rows || x >= r->cols) {
+                mf_hidden_cell_set_char(cell, ' ');
+                continue;
+            }
+            *cell = r->cells[src];
+            if (x == cols - 1 && x + 1 < r->cols && r->cells[src + 1].len == 0U) {
+                mf_hidden_cell_set_char(cell, ' ');
+            }
+        }
+    }
+}
+
+int mf_run_hidden_replay(const char *path)
+{
+    struct mf_rec_reader reader;
+    struct mf_hidden_screen screen;
+    struct mf_hidden_resize resize;
+    struct mf_hidden_ring ring;
+    pthread_t writer;
+    int rows;
+    int cols;
+    int clear_pending = 1;
+    int region_pending = 0;
+    unsigned char sgr = 0;
+    int quit = 0;
+    double deadline;
+    double last_size_check;
+    int rc = 0;
+
+    if (mf_rec_reader_open(&reader, path) != 0) {
+        return -1;
+    }
+    mf_hidden_get_term_size(STDOUT_FILENO, &rows, &cols);
+    memset(&screen, 0, sizeof(screen));
+    memset(&resize, 0, sizeof(resize));
+    if (mf_hidden_screen_resize(&screen, rows, cols) != 0 || mf_hidden_ring_start(&ring, &writer) != 0) {
+        mf_rec_reader_close(&reader);
+        free(screen.arena);
+        return -1;
+    }
+    mf_hidden_screen_blank(&screen);
+
+    mf_hidden_setup_signals();
+    mf_hidden_enter_alt_screen();
+    mf_hidden_hide_cursor();
+    mf_hidden_enable_raw();
+    /* Everything after this goes through the writer thread. */
+    fflush(stdout);
+    atexit(mf_hidden_cleanup);
+
+    deadline = mf_hidden_now_sec();
+    last_size_check = deadline;
+    while (!quit && g_hidden_running && !__atomic_load_n(&ring.failed, __ATOMIC_RELAXED)) {
+        struct mf_hidden_frame *frame;
+        uint32_t dt_ms;
+        double now;
+        int ev;
+
+        ev = mf_rec_reader_next(&reader, &dt_ms);
+        if (ev == MF_REC_RESIZE) {
+            continue;
+        }
+        if (ev != MF_REC_FRAME) {
+            rc = ev < 0 ? -1 : 0;
+            /* Let the last frame reach the screen before stopping. */
+            while (ev == MF_REC_END && g_hidden_running && !__atomic_load_n(&ring.failed, __ATOMIC_RELAXED) &&
+                   __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) != ring.head) {
+                mf_hidden_sleep_until(mf_hidden_now_sec() + 0.001);
+            }
+            break;
+        }
+
+        /* Keep the recorded pace; a terminal that fell behind resumes
+         * from now instead of bursting. Long gaps are slept in frame
+         * steps so 'q' stays responsive. */
         now = mf_hidden_now_sec();
-        if (next_deadline <= now) {
-            next_deadline = now + MF_HIDDEN_FRAMETIME_S;
-        } else {
-            double sleep_s = next_deadline - now;
-            struct timespec ts;
-            if (sleep_s < 0.0) {
-                sleep_s = 0.0;
+        deadline += (double)dt_ms / 1000.0;
+        if (deadline < now) {
+            deadline = now;
+        }
+        while (!quit && g_hidden_running && now < deadline) {
+            mf_hidden_sleep_until(deadline - now > MF_HIDDEN_FRAMETIME_S ? now + MF_HIDDEN_FRAMETIME_S : deadline);
+            quit = mf_hidden_quit_pressed();
+            now = mf_hidden_now_sec();
+        }
+
+        if (g_hidden_winch || resize.pending || now - last_size_check > MF_HIDDEN_SIZE_REFRESH_SEC) {
+            int old_rows = rows;
+            int old_cols = cols;
+
+            g_hidden_winch = 0;
+            last_size_check = now;
+            if (mf_hidden_resize_poll(&resize, STDOUT_FILENO, now, &rows, &cols)) {
+                if (mf_hidden_screen_resize(&screen, rows, cols) != 0) {
+                    break;
+                }
+                /* As in live mode: only a grown screen keeps its cells. */
+                if (rows >= old_rows && cols >= old_cols) {
+                    region_pending = 1;
+                } else {
+                    mf_hidden_screen_blank(&screen);
+                    clear_pending = 1;
+                }
+            }
+        }
+
+        frame = resize.pending ? NULL : mf_hidden_ring_claim(&ring);
+        if (frame != NULL) {
+            if (mf_hidden_frame_reserve(frame, rows, cols) != 0) {
+                break;
             }
-            ts.tv_sec = (time_t)sleep_s;
-            ts.tv_nsec = (long)((sleep_s - (double)ts.tv_sec) * 1e9);
-            if (ts.tv_nsec < 0) {
-                ts.tv_nsec = 0;
+            mf_hidden_clip(screen.curr, rows, cols, &reader);
+            frame->len = 0U;
+            if (clear_pending) {
+                mf_hidden_encode_clear(frame, rows);
+                g_hidden_scroll_region_set = rows > 1;
+                clear_pending = 0;
+            } else if (region_pending) {
+                mf_hidden_encode_region(frame, rows);
+                g_hidden_scroll_region_set = rows > 1;
+                region_pending = 0;
             }
-            nanosleep(&ts, NULL);
+            mf_hidden_encode_diff(screen.curr, screen.prev, rows, cols, &sgr, (g_hidden_caps & MF_TERMCAP_REP) != 0U, frame);
+            if (frame->len > 0U) {
+                mf_hidden_frame_sync(frame);
+                mf_hidden_ring_push(&ring);
+            }
+        }
+
+        if (mf_hidden_quit_pressed()) {
+            break;
         }
     }
 
+    mf_hidden_ring_stop(&ring, writer);
     mf_hidden_cleanup();
-    free(curr_buf);
-    free(prev_buf);
-    free(fx);
-    free(fy);
-    return 0;
+    mf_rec_reader_close(&reader);
+    free(screen.arena);
+    return rc;
+}
+
+int mf_run_hidden_export(char formatted[][MF_FORMATTED_LINE_MAX], const size_t widths[], size_t count, const char *path,
+                         unsigned int frames, unsigned int frame_ms, int rows, int cols)
+{
+    char gradient_lut[256];
+    unsigned char colour_lut[256];
+    struct mf_hidden_screen screen;
+    struct mf_hidden_frame frame = { NULL, 0U, 0U };
+    struct mf_outbuf ob;
+    size_t path_len = strlen(path);
+    int svg = path_len >= 4U && strcmp(path + path_len - 4U, ".svg") == 0;
+    char *arena;
+    unsigned int i;
+    unsigned char sgr = 0;
+    int fd = -1;
+    int rc = -1;
+
+    memset(&screen, 0, sizeof(screen));
+    arena = (char *)malloc(MF_HIDDEN_EXPORT_ARENA);
+    if (arena != NULL && mf_hidden_screen_resize(&screen, rows, cols) == 0 &&
+        mf_hidden_frame_reserve(&frame, rows, cols) == 0) {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (fd >= 0) {
+        mf_hidden_screen_blank(&screen);
+        mf_hidden_engine_pick((size_t)rows * (size_t)cols);
+        mf_outbuf_init(&ob, arena, MF_HIDDEN_EXPORT_ARENA, fd);
+        mf_hidden_build_gradient(gradient_lut, colour_lut);
+        if (svg) {
+            mf_svg_begin(&ob, cols, rows, frames, frame_ms);
+        } else {
+            mf_cast_begin(&ob, cols, rows);
+        }
+        for (i = 0; i < frames; ++i) {
+            /* The field live mode shows i * frame_ms after it starts,
+             * without the HUD; nothing here reads the clock. */
+            double z = (double)i * (double)frame_ms / 1000.0 * MF_HIDDEN_SPEED;
+
+            mf_hidden_fill_noise(screen.curr, rows, cols, screen.fx, screen.fy, z, gradient_lut, colour_lut);
+            mf_hidden_overlay_buffer(screen.curr, rows, cols, formatted, widths, count);
+            if (svg) {
+                mf_svg_frame(&ob, screen.curr, rows, cols, i, g_hidden_ramp);
+                continue;
+            }
+            frame.len = 0U;
+            if (i == 0U) {
+                mf_hidden_frame_put(&frame, "\x1b[?25l\x1b[2J\x1b[H", 13U);
+            }
+            mf_hidden_encode_diff(screen.curr, screen.prev, rows, cols, &sgr, 0, &frame);
+            mf_cast_event(&ob, (uint64_t)i * frame_ms * 1000U, frame.data, frame.len);
+        }
+        if (svg) {
+            mf_svg_end(&ob);
+        }
+        rc = mf_outbuf_flush(&ob);
+        if (close(fd) != 0) {
+            rc = -1;
+        }
+    }
+    free(arena);
+    free(frame.data);
+    free(screen.arena);
+    return rc;
 }
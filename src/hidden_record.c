@@ -0,0 +1,565 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hidden_record.h"
+#include "fmt.h"
+
+#define MF_REC_MAGIC "MFR1"
+#define MF_REC_MAGIC_LEN 4U
+#define MF_REC_ARENA (64U * 1024U)
+#define MF_REC_TAG_FRAME 'F'
+#define MF_REC_TAG_SIZE 'S'
+#define MF_REC_CELL_ESCAPE 0xffU
+#define MF_REC_CELL_COLOUR 0xfeU
+
+/* SVG geometry, in tenths of a pixel: a 14px monospace cell. */
+#define MF_SVG_CELL_W 84U
+#define MF_SVG_CELL_H 170U
+#define MF_SVG_BASELINE 130U
+
+static int mf_rec_cell_eq(const struct mf_hidden_cell *a, const struct mf_hidden_cell *b)
+{
+    return a->len == b->len && a->fg == b->fg && memcmp(a->bytes, b->bytes, a->len) == 0;
+}
+
+/* Whether an escaped cell's bytes are safe to send to a terminal: one
+ * well-formed UTF-8 scalar that is not a control character, or nothing
+ * at all (the second column of a wide character). A recording is
+ * replayed straight to the tty, so anything else could smuggle escape
+ * sequences into it. */
+static int mf_rec_glyph_ok(const unsigned char *b, size_t len)
+{
+    unsigned long cp;
+    size_t need;
+    size_t i;
+
+    if (len == 0U) {
+        return 1;
+    }
+    if (b[0] < 0x80U) {
+        return len == 1U && b[0] >= 0x20U && b[0] <= 0x7eU;
+    }
+    if (b[0] >= 0xc2U && b[0] <= 0xdfU) {
+        need = 2U;
+        cp = b[0] & 0x1fU;
+    } else if (b[0] >= 0xe0U && b[0] <= 0xefU) {
+        need = 3U;
+        cp = b[0] & 0x0fU;
+    } else if (b[0] >= 0xf0U && b[0] <= 0xf4U) {
+        need = 4U;
+        cp = b[0] & 0x07U;
+    } else {
+        return 0;
+    }
+    if (len != need) {
+        return 0;
+    }
+    for (i = 1; i < len; ++i) {
+        if ((b[i] & 0xc0U) != 0x80U) {
+            return 0;
+        }
+        cp = (cp << 6) | (b[i] & 0x3fU);
+    }
+    /* Overlong forms, C1 controls, surrogates and beyond U+10FFFF. */
+    if ((need == 3U && cp < 0x800UL) || (need == 4U && cp < 0x10000UL) || cp < 0xa0UL ||
+        (cp >= 0xd800UL && cp <= 0xdfffUL) || cp > 0x10ffffUL) {
+        return 0;
+    }
+    return 1;
+}
+
+static void mf_rec_blank(struct mf_hidden_cell *cells, size_t total)
+{
+    size_t i;
+
+    for (i = 0; i < total; ++i) {
+        cells[i].len = 1;
+        cells[i].fg = 0;
+        cells[i].bytes[0] = ' ';
+    }
+}
+
+static struct mf_hidden_cell *mf_rec_alloc_blank(int rows, int cols)
+{
+    size_t total = (size_t)rows * (size_t)cols;
+    struct mf_hidden_cell *cells;
+
+    cells = (struct mf_hidden_cell *)malloc(total * sizeof(*cells));
+    if (cells != NULL) {
+        mf_rec_blank(cells, total);
+    }
+    return cells;
+}
+
+static void mf_rec_put_varint(struct mf_outbuf *ob, uint64_t v)
+{
+    char buf[10];
+    size_t n = 0;
+
+    while (v >= 0x80U) {
+        buf[n++] = (char)(unsigned char)(v | 0x80U);
+        v >>= 7;
+    }
+    buf[n++] = (char)(unsigned char)v;
+    mf_outbuf_put(ob, buf, n);
+}
+
+static void mf_rec_put_cell(struct mf_outbuf *ob, const struct mf_hidden_cell *cell, unsigned char *fg)
+{
+    unsigned char c = (unsigned char)cell->bytes[0];
+    char head[2];
+
+    if (cell->fg != *fg) {
+        head[0] = (char)MF_REC_CELL_COLOUR;
+        head[1] = (char)cell->fg;
+        mf_outbuf_put(ob, head, 2U);
+        *fg = cell->fg;
+    }
+    if (cell->len == 1U && c >= 0x20U && c <= 0x7eU) {
+        mf_outbuf_put(ob, cell->bytes, 1U);
+        return;
+    }
+    head[0] = (char)MF_REC_CELL_ESCAPE;
+    head[1] = (char)cell->len;
+    mf_outbuf_put(ob, head, 2U);
+    mf_outbuf_put(ob, cell->bytes, cell->len);
+}
+
+int mf_rec_open(struct mf_rec_writer *w, const char *path, int rows, int cols)
+{
+    char *arena;
+    int fd;
+
+    memset(w, 0, sizeof(*w));
+    if (rows <= 0 || cols <= 0 || rows > MF_REC_DIM_MAX || cols > MF_REC_DIM_MAX) {
+        return -1;
+    }
+    arena = (char *)malloc(MF_REC_ARENA);
+    w->prev = mf_rec_alloc_blank(rows, cols);
+    fd = arena != NULL && w->prev != NULL ? open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (fd < 0) {
+        free(arena);
+        free(w->prev);
+        w->prev = NULL;
+        return -1;
+    }
+    mf_outbuf_init(&w->ob, arena, MF_REC_ARENA, fd);
+    w->rows = rows;
+    w->cols = cols;
+    mf_outbuf_put(&w->ob, MF_REC_MAGIC, MF_REC_MAGIC_LEN);
+    mf_rec_put_varint(&w->ob, (uint64_t)cols);
+    mf_rec_put_varint(&w->ob, (uint64_t)rows);
+    return 0;
+}
+
+void mf_rec_frame(struct mf_rec_writer *w, const struct mf_hidden_cell *curr, uint32_t dt_ms)
+{
+    size_t total = (size_t)w->rows * (size_t)w->cols;
+    size_t runs = 0;
+    size_t last = 0;
+    size_t pos;
+    unsigned char fg = 0;
+    char tag = MF_REC_TAG_FRAME;
+
+    /* The run count leads the frame, so count before emitting. */
+    for (pos = 0; pos < total; ++pos) {
+        if (!mf_rec_cell_eq(&curr[pos], &w->prev[pos]) && (pos == 0 || mf_rec_cell_eq(&curr[pos - 1], &w->prev[pos - 1]))) {
+            runs++;
+        }
+    }
+    mf_outbuf_put(&w->ob, &tag, 1U);
+    mf_rec_put_varint(&w->ob, dt_ms);
+    mf_rec_put_varint(&w->ob, runs);
+
+    pos = 0;
+    while (pos < total) {
+        size_t end;
+
+        if (mf_rec_cell_eq(&curr[pos], &w->prev[pos])) {
+            ++pos;
+            continue;
+        }
+        end = pos + 1;
+        while (end < total && !mf_rec_cell_eq(&curr[end], &w->prev[end])) {
+            ++end;
+        }
+        mf_rec_put_varint(&w->ob, pos - last);
+        mf_rec_put_varint(&w->ob, end - pos);
+        for (; pos < end; ++pos) {
+            mf_rec_put_cell(&w->ob, &curr[pos], &fg);
+            w->prev[pos] = curr[pos];
+        }
+        last = end;
+    }
+}
+
+int mf_rec_resize(struct mf_rec_writer *w, int rows, int cols)
+{
+    struct mf_hidden_cell *prev;
+    char tag = MF_REC_TAG_SIZE;
+
+    if (rows <= 0 || cols <= 0 || rows > MF_REC_DIM_MAX || cols > MF_REC_DIM_MAX) {
+        return -1;
+    }
+    prev = mf_rec_alloc_blank(rows, cols);
+    if (prev == NULL) {
+        return -1;
+    }
+    free(w->prev);
+    w->prev = prev;
+    w->rows = rows;
+    w->cols = cols;
+    mf_outbuf_put(&w->ob, &tag, 1U);
+    mf_rec_put_varint(&w->ob, (uint64_t)cols);
+    mf_rec_put_varint(&w->ob, (uint64_t)rows);
+    return 0;
+}
+
+int mf_rec_close(struct mf_rec_writer *w)
+{
+    int rc;
+
+    if (w->prev == NULL) {
+        return -1;
+    }
+    rc = mf_outbuf_flush(&w->ob);
+    if (close(w->ob.fd) != 0) {
+        rc = -1;
+    }
+    free(w->ob.data);
+    free(w->prev);
+    w->prev = NULL;
+    return rc;
+}
+
+static int mf_rec_get_varint(struct mf_rec_reader *r, uint64_t *v)
+{
+    unsigned int shift = 0;
+
+    *v = 0U;
+    while (r->pos < r->len && shift < 64U) {
+        unsigned char b = r->data[r->pos++];
+
+        *v |= (uint64_t)(b & 0x7fU) << shift;
+        if ((b & 0x80U) == 0U) {
+            return 0;
+        }
+        shift += 7U;
+    }
+    return -1;
+}
+
+static int mf_rec_get_size(struct mf_rec_reader *r, int *rows, int *cols)
+{
+    uint64_t c;
+    uint64_t n;
+
+    if (mf_rec_get_varint(r, &c) != 0 || mf_rec_get_varint(r, &n) != 0) {
+        return -1;
+    }
+    if (c == 0U || n == 0U || c > MF_REC_DIM_MAX || n > MF_REC_DIM_MAX) {
+        return -1;
+    }
+    *cols = (int)c;
+    *rows = (int)n;
+    return 0;
+}
+
+/* Recordings are read with plain open(2): the path is the user's, not
+ * part of the tree that --root points the collectors at. */
+int mf_rec_reader_open(struct mf_rec_reader *r, const char *path)
+{
+    struct stat st;
+    size_t got = 0;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)MF_REC_MAGIC_LEN || (uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+        close(fd);
+        return -1;
+    }
+    r->len = (size_t)st.st_size;
+    r->data = (unsigned char *)malloc(r->len);
+    while (r->data != NULL && got < r->len) {
+        ssize_t n = read(fd, r->data + got, r->len - got);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    close(fd);
+    if (r->data == NULL || got != r->len || memcmp(r->data, MF_REC_MAGIC, MF_REC_MAGIC_LEN) != 0) {
+        mf_rec_reader_close(r);
+        return -1;
+    }
+    r->pos = MF_REC_MAGIC_LEN;
+    if (mf_rec_get_size(r, &r->rows, &r->cols) != 0 || (r->cells = mf_rec_alloc_blank(r->rows, r->cols)) == NULL) {
+        mf_rec_reader_close(r);
+        return -1;
+    }
+    return 0;
+}
+
+int mf_rec_reader_next(struct mf_rec_reader *r, uint32_t *dt_ms)
+{
+    size_t total = (size_t)r->rows * (size_t)r->cols;
+    size_t cell = 0;
+    unsigned char fg = 0;
+    uint64_t dt;
+    uint64_t runs;
+    unsigned char tag;
+
+    *dt_ms = 0U;
+    if (r->pos >= r->len) {
+        return MF_REC_END;
+    }
+    tag = r->data[r->pos++];
+    if (tag == MF_REC_TAG_SIZE) {
+        struct mf_hidden_cell *cells;
+        int rows;
+        int cols;
+
+        if (mf_rec_get_size(r, &rows, &cols) != 0 || (cells = mf_rec_alloc_blank(rows, cols)) == NULL) {
+            return -1;
+        }
+        free(r->cells);
+        r->cells = cells;
+        r->rows = rows;
+        r->cols = cols;
+        return MF_REC_RESIZE;
+    }
+    if (tag != MF_REC_TAG_FRAME || mf_rec_get_varint(r, &dt) != 0 || mf_rec_get_varint(r, &runs) != 0) {
+        return -1;
+    }
+    *dt_ms = dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt;
+    while (runs-- > 0U) {
+        uint64_t skip;
+        uint64_t count;
+
+        if (mf_rec_get_varint(r, &skip) != 0 || mf_rec_get_varint(r, &count) != 0 || skip > total - cell ||
+            count > total - cell - (size_t)skip) {
+            return -1;
+        }
+        cell += (size_t)skip;
+        while (count-- > 0U) {
+            struct mf_hidden_cell *dst = &r->cells[cell++];
+            unsigned char b;
+
+            if (r->pos >= r->len) {
+                return -1;
+            }
+            b = r->data[r->pos++];
+            if (b == MF_REC_CELL_COLOUR) {
+                if (r->len - r->pos < 2U) {
+                    return -1;
+                }
+                fg = r->data[r->pos++];
+                b = r->data[r->pos++];
+                if (fg > MF_HIDDEN_RAMP_STEPS) {
+                    return -1;
+                }
+            }
+            dst->fg = fg;
+            if (b != MF_REC_CELL_ESCAPE) {
+                if (b < 0x20U || b > 0x7eU) {
+                    return -1;
+                }
+                dst->len = 1;
+                dst->bytes[0] = (char)b;
+                continue;
+            }
+            if (r->pos >= r->len || r->data[r->pos] > sizeof(dst->bytes) ||
+                r->len - r->pos - 1U < (size_t)r->data[r->pos]) {
+                return -1;
+            }
+            dst->len = r->data[r->pos++];
+            if (!mf_rec_glyph_ok(r->data + r->pos, dst->len)) {
+                return -1;
+            }
+            memcpy(dst->bytes, r->data + r->pos, dst->len);
+            r->pos += dst->len;
+        }
+    }
+    return MF_REC_FRAME;
+}
+
+void mf_rec_reader_close(struct mf_rec_reader *r)
+{
+    free(r->data);
+    free(r->cells);
+    r->data = NULL;
+    r->cells = NULL;
+}
+
+static void mf_put_uint(struct mf_outbuf *ob, uint64_t v)
+{
+    char buf[24];
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, buf, sizeof(buf));
+    mf_fmt_uint(&f, v);
+    mf_outbuf_put(ob, buf, f.len);
+}
+
+/* q tenths, printed as a decimal with one fractional digit. */
+static void mf_put_tenths(struct mf_outbuf *ob, uint64_t q)
+{
+    char buf[24];
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, buf, sizeof(buf));
+    mf_fmt_fixed(&f, q, 1U);
+    mf_outbuf_put(ob, buf, f.len);
+}
+
+void mf_cast_begin(struct mf_outbuf *ob, int cols, int rows)
+{
+    mf_outbuf_puts(ob, "{\"version\": 2, \"width\": ");
+    mf_put_uint(ob, (uint64_t)cols);
+    mf_outbuf_puts(ob, ", \"height\": ");
+    mf_put_uint(ob, (uint64_t)rows);
+    mf_outbuf_puts(ob, "}\n");
+}
+
+void mf_cast_event(struct mf_outbuf *ob, uint64_t t_us, const char *data, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    char buf[24];
+    struct mf_fmt f;
+    size_t start = 0;
+    size_t i;
+
+    mf_fmt_init(&f, buf, sizeof(buf));
+    mf_fmt_fixed(&f, t_us, 6U);
+    mf_outbuf_puts(ob, "[");
+    mf_outbuf_put(ob, buf, f.len);
+    mf_outbuf_puts(ob, ", \"o\", \"");
+    /* JSON strings take UTF-8 as is; only quotes, backslashes and
+     * control bytes (ESC above all) need escaping. */
+    for (i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)data[i];
+        char esc[6];
+
+        if (c >= 0x20U && c != '"' && c != '\\' && c != 0x7fU) {
+            continue;
+        }
+        mf_outbuf_put(ob, data + start, i - start);
+        start = i + 1;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            mf_outbuf_put(ob, esc, 2U);
+            continue;
+        }
+        memcpy(esc, "\\u00", 4U);
+        esc[4] = hex[c >> 4];
+        esc[5] = hex[c & 0x0fU];
+        mf_outbuf_put(ob, esc, sizeof(esc));
+    }
+    mf_outbuf_put(ob, data + start, len - start);
+    mf_outbuf_puts(ob, "\"]\n");
+}
+
+void mf_svg_begin(struct mf_outbuf *ob, int cols, int rows, uint32_t frames, uint32_t frame_ms)
+{
+    uint64_t w = (uint64_t)cols * MF_SVG_CELL_W;
+    uint64_t h = (uint64_t)rows * MF_SVG_CELL_H;
+
+    mf_outbuf_puts(ob, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    mf_put_tenths(ob, w);
+    mf_outbuf_puts(ob, "\" height=\"");
+    mf_put_tenths(ob, h);
+    mf_outbuf_puts(ob, "\" viewBox=\"0 0 ");
+    mf_put_tenths(ob, w);
+    mf_outbuf_puts(ob, " ");
+    mf_put_tenths(ob, h);
+    mf_outbuf_puts(ob, "\" xml:space=\"preserve\">\n<style>text{font:14px monospace;fill:#c0c0c0;white-space:pre}"
+                       "#f{animation:f ");
+    mf_put_uint(ob, (uint64_t)frames * frame_ms);
+    mf_outbuf_puts(ob, "ms steps(");
+    mf_put_uint(ob, frames);
+    mf_outbuf_puts(ob, ") infinite}@keyframes f{to{transform:translateY(-");
+    mf_put_tenths(ob, h * frames);
+    mf_outbuf_puts(ob, "px)}}</style>\n<clipPath id=\"v\"><rect width=\"");
+    mf_put_tenths(ob, w);
+    mf_outbuf_puts(ob, "\" height=\"");
+    mf_put_tenths(ob, h);
+    mf_outbuf_puts(ob, "\"/></clipPath>\n<rect width=\"100%\" height=\"100%\" fill=\"#000\"/>\n"
+                       "<g clip-path=\"url(#v)\"><g id=\"f\">\n");
+}
+
+void mf_svg_frame(struct mf_outbuf *ob, const struct mf_hidden_cell *cells, int rows, int cols, uint32_t index,
+                  const unsigned char (*rgb)[3])
+{
+    static const char hex[] = "0123456789abcdef";
+    int y;
+
+    mf_outbuf_puts(ob, "<g transform=\"translate(0 ");
+    mf_put_tenths(ob, (uint64_t)index * (uint64_t)rows * MF_SVG_CELL_H);
+    mf_outbuf_puts(ob, ")\">\n");
+    for (y = 0; y < rows; ++y) {
+        const struct mf_hidden_cell *row = &cells[(size_t)y * (size_t)cols];
+        unsigned char fg = 0;
+        int x;
+
+        mf_outbuf_puts(ob, "<text y=\"");
+        mf_put_tenths(ob, (uint64_t)y * MF_SVG_CELL_H + MF_SVG_BASELINE);
+        mf_outbuf_puts(ob, "\">");
+        for (x = 0; x < cols; ++x) {
+            unsigned char c = (unsigned char)row[x].bytes[0];
+
+            if (row[x].len == 0U) {
+                continue;
+            }
+            if (row[x].fg != fg) {
+                char fill[] = "<tspan fill=\"#000000\">";
+                size_t k;
+
+                if (fg != 0U) {
+                    mf_outbuf_puts(ob, "</tspan>");
+                }
+                fg = row[x].fg;
+                if (fg != 0U) {
+                    for (k = 0; k < 3U; ++k) {
+                        fill[14 + 2 * k] = hex[rgb[fg][k] >> 4];
+                        fill[15 + 2 * k] = hex[rgb[fg][k] & 0x0fU];
+                    }
+                    mf_outbuf_puts(ob, fill);
+                }
+            }
+            if (row[x].len > 1U) {
+                mf_outbuf_put(ob, row[x].bytes, row[x].len);
+            } else if (c == '<') {
+                mf_outbuf_puts(ob, "&lt;");
+            } else if (c == '>') {
+                mf_outbuf_puts(ob, "&gt;");
+            } else if (c == '&') {
+                mf_outbuf_puts(ob, "&amp;");
+            } else {
+                /* XML 1.0 has no escape for control characters. */
+                mf_outbuf_put(ob, c < 0x20U ? " " : row[x].bytes, 1U);
+            }
+        }
+        mf_outbuf_puts(ob, fg != 0U ? "</tspan></text>\n" : "</text>\n");
+    }
+    mf_outbuf_puts(ob, "</g>\n");
+}
+
+void mf_svg_end(struct mf_outbuf *ob)
+{
+    mf_outbuf_puts(ob, "</g></g>\n</svg>\n");
+}
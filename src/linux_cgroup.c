@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#define MF_CGROUP_PATH_MAX 512
+
+enum mf_cgroup_probe {
+    MF_CGROUP_UNPROBED = 0,
+    MF_CGROUP_FOUND,
+    MF_CGROUP_NONE
+};
+
+static int g_cgroup_dir_probe = MF_CGROUP_UNPROBED;
+static char g_cgroup_dir[MF_CGROUP_PATH_MAX];
+
+static int g_cgroup_limits_probe = MF_CGROUP_UNPROBED;
+static struct mf_cgroup_limits g_cgroup_limits;
+
+const char *mf_cgroup_dir(void)
+{
+    char data[4096];
+    char *cursor;
+    char *line;
+    struct mf_fmt f;
+
+    if (g_cgroup_dir_probe != MF_CGROUP_UNPROBED) {
+        return g_cgroup_dir_probe == MF_CGROUP_FOUND ? g_cgroup_dir : NULL;
+    }
+    g_cgroup_dir_probe = MF_CGROUP_NONE;
+
+    if (mf_read_file(MF_PATH_SELF_CGROUP, data, sizeof(data)) <= 0) {
+        return NULL;
+    }
+
+    cursor = data;
+    while ((line = mf_next_line(&cursor)) != NULL) {
+        if (strncmp(line, "0::", 3) != 0) {
+            continue;
+        }
+        mf_fmt_init(&f, g_cgroup_dir, sizeof(g_cgroup_dir));
+        mf_fmt_str(&f, MF_PATH_CGROUP2);
+        mf_fmt_str(&f, line + 3);
+        if (f.len == 0U || g_cgroup_dir[f.len - 1U] != '/') {
+            mf_fmt_str(&f, "/");
+        }
+        if (f.len + 1U < sizeof(g_cgroup_dir)) {
+            g_cgroup_dir_probe = MF_CGROUP_FOUND;
+            return g_cgroup_dir;
+        }
+        break;
+    }
+    return NULL;
+}
+
+/* Reads dir + name; returns the byte count or -1. */
+static long mf_cgroup_read(const char *dir, size_t dirlen, const char *name, char *buf, size_t bufsz)
+{
+    char path[MF_CGROUP_PATH_MAX + 32];
+
+    if (dirlen + strlen(name) + 1U > sizeof(path)) {
+        return -1;
+    }
+    memcpy(path, dir, dirlen);
+    mf_strlcpy(path + dirlen, name, sizeof(path) - dirlen);
+    return mf_read_file(path, buf, bufsz);
+}
+
+unsigned int mf_cpulist_count(const char *list)
+{
+    unsigned int count;
+    const char *p;
+
+    count = 0U;
+    p = list;
+    while (*p >= '0' && *p <= '9') {
+        uint64_t lo;
+        uint64_t hi;
+
+        p += mf_parse_u64(p, &lo);
+        hi = lo;
+        if (*p == '-') {
+            p++;
+            p += mf_parse_u64(p, &hi);
+        }
+        if (hi >= lo) {
+            count += (unsigned int)(hi - lo + 1U);
+        }
+        if (*p != ',') {
+            break;
+        }
+        p++;
+    }
+    return count;
+}
+
+/* Walks from the process's cgroup up to the cgroup2 root. A limit set
+ * on any ancestor (e.g. the pod level in Kubernetes) caps everything
+ * below it, so the smallest one wins. */
+static void mf_cgroup_scan(struct mf_cgroup_limits *lim)
+{
+    const char *leaf;
+    size_t rootlen;
+    size_t len;
+    char data[256];
+
+    memset(lim, 0, sizeof(*lim));
+    leaf = mf_cgroup_dir();
+    if (leaf == NULL) {
+        return;
+    }
+
+    rootlen = strlen(MF_PATH_CGROUP2 "/");
+    len = strlen(leaf);
+    for (;;) {
+        uint64_t quota;
+        uint64_t period;
+        uint64_t bytes;
+        size_t n;
+
+        if (mf_cgroup_read(leaf, len, "cpu.max", data, sizeof(data)) > 0) {
+            n = mf_parse_u64(data, &quota);
+            if (n > 0U && data[n] == ' ' && mf_parse_u64(data + n + 1U, &period) > 0U && period > 0U) {
+                uint64_t milli = (quota * 1000U + period - 1U) / period;
+                if (lim->cpu_milli == 0U || milli < lim->cpu_milli) {
+                    lim->cpu_milli = milli;
+                }
+            }
+        }
+        if (mf_cgroup_read(leaf, len, "memory.max", data, sizeof(data)) > 0) {
+            if (mf_parse_u64(data, &bytes) > 0U && (lim->mem_max == 0U || bytes < lim->mem_max)) {
+                lim->mem_max = bytes;
+            }
+        }
+        /* The effective set already folds in the ancestors; take the
+         * deepest one the cpuset controller exposes. */
+        if (lim->cpuset_count == 0U && mf_cgroup_read(leaf, len, "cpuset.cpus.effective", data, sizeof(data)) > 0) {
+            lim->cpuset_count = mf_cpulist_count(data);
+        }
+
+        if (len <= rootlen) {
+            break;
+        }
+        /* Drop the last path component, keeping the trailing slash. */
+        len--;
+        while (len > rootlen && leaf[len - 1U] != '/') {
+            len--;
+        }
+    }
+}
+
+const struct mf_cgroup_limits *mf_cgroup_limits(void)
+{
+    if (g_cgroup_limits_probe == MF_CGROUP_UNPROBED) {
+        mf_cgroup_scan(&g_cgroup_limits);
+        g_cgroup_limits_probe = MF_CGROUP_FOUND;
+    }
+    return &g_cgroup_limits;
+}
+
+int mf_cgroup_memory_current(uint64_t *bytes)
+{
+    const char *dir;
+    char data[64];
+
+    dir = mf_cgroup_dir();
+    if (dir == NULL || mf_cgroup_read(dir, strlen(dir), "memory.current", data, sizeof(data)) <= 0) {
+        return -1;
+    }
+    return mf_parse_u64(data, bytes) > 0U ? 0 : -1;
+}
+#endif
@@ -0,0 +1,408 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "fileio.h"
+#include "fmt.h"
+#include "state.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MF_CPU_STATE_NAME "cpu"
+#define MF_CPU_STATE_MAGIC 0x3243464dU /* "MFC2" */
+#define MF_CPU_MAX_SLOTS 4097U
+/* Longest "cpuN" line: the id plus ten 20-digit counters. */
+#define MF_CPU_LINE_MAX 232U
+/* A saved sample older than this says little about "now". */
+#define MF_CPU_MAX_AGE_NS 60000000000ULL
+/* Shortest window worth reporting; also the fallback sample length. */
+#define MF_CPU_MIN_AGE_NS 100000000ULL
+#define MF_CPU_SPARK_MAX 32U
+#define MF_CPU_BOOT_ID_MAX 40U
+
+struct mf_cpu_times {
+    uint64_t total;
+    uint64_t idle;
+};
+
+/* On-disk layout of the saved sample: the header followed by one
+ * mf_cpu_times per slot (slot 0 is the aggregate line, slot 1 + n is
+ * cpuN). The monotonic stamp restarts at boot, so the boot id is kept
+ * to tell a sample from an earlier boot apart. */
+struct mf_cpu_sample {
+    uint32_t magic;
+    uint32_t slots;
+    uint64_t stamp_ns;
+    char boot_id[MF_CPU_BOOT_ID_MAX];
+    struct mf_cpu_times times[];
+};
+
+static const char *const g_spark[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+
+static uint64_t mf_cpu_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void mf_cpu_sleep_ns(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    while (nanosleep(&ts, &ts) != 0) {
+    }
+}
+
+static size_t mf_cpu_sample_size(uint32_t slots)
+{
+    return offsetof(struct mf_cpu_sample, times) + (size_t)slots * sizeof(struct mf_cpu_times);
+}
+
+/* This boot's id, newline stripped; "" when the kernel has none. */
+static void mf_cpu_boot_id(char *buf, size_t bufsz)
+{
+    long n;
+
+    memset(buf, 0, bufsz);
+    n = mf_read_file(MF_PATH_BOOT_ID, buf, bufsz);
+    if (n <= 0) {
+        buf[0] = '\0';
+    } else if (buf[n - 1] == '\n') {
+        buf[n - 1] = '\0';
+    }
+}
+
+/* Fills s from the cpu lines at the top of /proc/stat. Counters are
+ * parsed by hand: strtoull dominates the profile on many-core hosts. */
+static int mf_cpu_read(struct mf_cpu_sample *s, char *text, size_t textsz)
+{
+    const char *p;
+
+    if (mf_read_file(MF_PATH_STAT, text, textsz) < 0) {
+        return -1;
+    }
+
+    memset(s->times, 0, (size_t)s->slots * sizeof(struct mf_cpu_times));
+    s->magic = MF_CPU_STATE_MAGIC;
+    s->stamp_ns = mf_cpu_now_ns();
+
+    p = text;
+    while (p[0] == 'c' && p[1] == 'p' && p[2] == 'u') {
+        const char *eol;
+        uint64_t slot;
+        uint64_t field[8];
+        unsigned int k;
+
+        eol = strchr(p, '\n');
+        if (eol == NULL) {
+            break; /* truncated line */
+        }
+
+        p += 3;
+        slot = 0U;
+        if (*p != ' ') {
+            size_t n = mf_parse_u64(p, &slot);
+            if (n == 0U) {
+                break;
+            }
+            p += n;
+            slot++;
+        }
+
+        for (k = 0; k < 8U; ++k) {
+            uint64_t v;
+
+            v = 0U;
+            while (*p == ' ') {
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                v = v * 10U + (uint64_t)(*p - '0');
+                p++;
+            }
+            field[k] = v;
+        }
+
+        if (slot < s->slots) {
+            /* user nice system idle iowait irq softirq steal; guest time
+             * is already part of user. */
+            s->times[slot].idle = field[3] + field[4];
+            s->times[slot].total = field[0] + field[1] + field[2] + field[3] + field[4] + field[5] + field[6] + field[7];
+        }
+        p = eol + 1;
+    }
+
+    return s->times[0].total > 0U ? 0 : -1;
+}
+
+static int mf_cpu_usable(const struct mf_cpu_sample *prev, long len, const struct mf_cpu_sample *cur)
+{
+    if (len != (long)mf_cpu_sample_size(cur->slots)) {
+        return 0;
+    }
+    if (prev->magic != MF_CPU_STATE_MAGIC || prev->slots != cur->slots) {
+        return 0;
+    }
+    if (cur->boot_id[0] == '\0' || strncmp(prev->boot_id, cur->boot_id, sizeof(cur->boot_id)) != 0) {
+        return 0;
+    }
+    /* A later stamp or a smaller counter still means the sample is bad. */
+    if (prev->stamp_ns > cur->stamp_ns || cur->stamp_ns - prev->stamp_ns > MF_CPU_MAX_AGE_NS) {
+        return 0;
+    }
+    return prev->times[0].total <= cur->times[0].total && prev->times[0].idle <= cur->times[0].idle;
+}
+
+/* Busy share of the interval in units of 1/scale, rounded. */
+static uint64_t mf_cpu_busy(const struct mf_cpu_times *a, const struct mf_cpu_times *b, uint64_t scale)
+{
+    uint64_t dt;
+    uint64_t di;
+
+    if (b->total < a->total || b->idle < a->idle) {
+        return 0U;
+    }
+    dt = b->total - a->total;
+    di = b->idle - a->idle;
+    if (dt == 0U || di > dt) {
+        return 0U;
+    }
+    return ((dt - di) * scale + dt / 2U) / dt;
+}
+
+static void mf_cpu_sparkline(struct mf_fmt *f, const struct mf_cpu_sample *prev, const struct mf_cpu_sample *cur)
+{
+    uint32_t online;
+    uint32_t group;
+    uint32_t in_group;
+    uint64_t acc;
+    uint32_t i;
+
+    online = 0U;
+    for (i = 1; i < cur->slots; ++i) {
+        if (cur->times[i].total > 0U) {
+            online++;
+        }
+    }
+    if (online < 2U) {
+        return;
+    }
+
+    /* Past MF_CPU_SPARK_MAX cores each glyph averages a run of
+     * neighbouring cores. */
+    group = (online + MF_CPU_SPARK_MAX - 1U) / MF_CPU_SPARK_MAX;
+    mf_fmt_str(f, " ");
+    in_group = 0U;
+    acc = 0U;
+    for (i = 1; i < cur->slots; ++i) {
+        if (cur->times[i].total == 0U) {
+            continue;
+        }
+        acc += mf_cpu_busy(&prev->times[i], &cur->times[i], 1000U);
+        if (++in_group == group) {
+            mf_fmt_str(f, g_spark[(acc / in_group * 7U + 500U) / 1000U]);
+            in_group = 0U;
+            acc = 0U;
+        }
+    }
+    if (in_group > 0U) {
+        mf_fmt_str(f, g_spark[(acc / in_group * 7U + 500U) / 1000U]);
+    }
+}
+
+static void mf_cpu_loadavg(struct mf_fmt *f)
+{
+    char data[128];
+    char *p;
+    char *end;
+    unsigned int k;
+
+    if (mf_read_file(MF_PATH_LOADAVG, data, sizeof(data)) <= 0) {
+        return;
+    }
+
+    mf_fmt_str(f, "; load");
+    p = data;
+    for (k = 0; k < 3U; ++k) {
+        while (*p == ' ') {
+            p++;
+        }
+        end = p;
+        while (*end != ' ' && *end != '\0' && *end != '\n') {
+            end++;
+        }
+        if (end == p) {
+            break;
+        }
+        *end = '\0';
+        mf_fmt_str(f, " ");
+        mf_fmt_str(f, p);
+        p = end + 1;
+    }
+}
+
+/* Average current frequency over the cpufreq policies (one per clock
+ * domain, so far fewer reads than one per CPU). */
+static void mf_cpu_freq(struct mf_fmt *f)
+{
+    DIR *dir;
+    struct dirent *ent;
+    uint64_t sum_khz;
+    uint64_t count;
+
+    dir = mf_opendir(MF_PATH_CPUFREQ);
+    if (dir == NULL) {
+        return;
+    }
+
+    sum_khz = 0U;
+    count = 0U;
+    while ((ent = readdir(dir)) != NULL) {
+        char path[320];
+        char data[32];
+        uint64_t khz;
+        struct mf_fmt pf;
+
+        if (strncmp(ent->d_name, "policy", 6) != 0) {
+            continue;
+        }
+        mf_fmt_init(&pf, path, sizeof(path));
+        mf_fmt_str(&pf, MF_PATH_CPUFREQ "/");
+        mf_fmt_str(&pf, ent->d_name);
+        mf_fmt_str(&pf, "/scaling_cur_freq");
+        if (mf_read_file(path, data, sizeof(data)) <= 0 || mf_parse_u64(data, &khz) == 0U || khz == 0U) {
+            continue;
+        }
+        sum_khz += khz;
+        count++;
+    }
+    closedir(dir);
+
+    if (count == 0U) {
+        return;
+    }
+    mf_fmt_str(f, "; ");
+    /* kHz to hundredths of a GHz. */
+    mf_fmt_fixed(f, (sum_khz / count + 5000U) / 10000U, 2U);
+    mf_fmt_str(f, " GHz");
+}
+
+/* CPUs the kernel can bring up. sysconf describes the running system,
+ * so under --root the count comes from the root's cpu/possible list
+ * ("0-1023") instead. */
+static long mf_cpu_possible(void)
+{
+    char data[256];
+    const char *p;
+    uint64_t last;
+
+    if (mf_fileio_root() == AT_FDCWD || mf_read_file(MF_PATH_SYS_SYSTEM "/cpu/possible", data, sizeof(data)) <= 0) {
+        return sysconf(_SC_NPROCESSORS_CONF);
+    }
+    p = data + strcspn(data, "\n");
+    while (p > data && (p[-1] >= '0' && p[-1] <= '9')) {
+        p--;
+    }
+    if (mf_parse_u64(p, &last) == 0U) {
+        return sysconf(_SC_NPROCESSORS_CONF);
+    }
+    return (long)last + 1;
+}
+
+int mf_collect_load(char *out, size_t outsz)
+{
+    struct mf_cpu_sample *prev;
+    struct mf_cpu_sample *cur;
+    char *text;
+    size_t sample_size;
+    size_t textsz;
+    long conf;
+    long len;
+    uint32_t slots;
+    unsigned char *block;
+    struct mf_fmt f;
+
+    conf = mf_cpu_possible();
+    if (conf < 1) {
+        conf = 1;
+    }
+    slots = (uint32_t)conf + 1U;
+    if (slots > MF_CPU_MAX_SLOTS) {
+        slots = MF_CPU_MAX_SLOTS;
+    }
+
+    /* Only the cpu lines are wanted; the interrupt counters behind them
+     * are left unread. */
+    sample_size = mf_cpu_sample_size(slots);
+    textsz = (size_t)slots * MF_CPU_LINE_MAX + 1U;
+    block = (unsigned char *)malloc(2U * sample_size + textsz);
+    if (block == NULL) {
+        return -1;
+    }
+    prev = (struct mf_cpu_sample *)(void *)block;
+    cur = (struct mf_cpu_sample *)(void *)(block + sample_size);
+    text = (char *)(block + 2U * sample_size);
+    prev->slots = slots;
+    cur->slots = slots;
+    mf_cpu_boot_id(cur->boot_id, sizeof(cur->boot_id));
+
+    if (mf_cpu_read(cur, text, textsz) != 0) {
+        free(block);
+        return -1;
+    }
+
+    len = mf_state_load(MF_CPU_STATE_NAME, prev, sample_size);
+    if (mf_cpu_usable(prev, len, cur)) {
+        uint64_t age = cur->stamp_ns - prev->stamp_ns;
+
+        if (age < MF_CPU_MIN_AGE_NS) {
+            mf_cpu_sleep_ns(MF_CPU_MIN_AGE_NS - age);
+            if (mf_cpu_read(cur, text, textsz) != 0) {
+                free(block);
+                return -1;
+            }
+        }
+    } else {
+        /* No usable history: take a short sample of our own. */
+        memcpy(prev, cur, sample_size);
+        mf_cpu_sleep_ns(MF_CPU_MIN_AGE_NS);
+        if (mf_cpu_read(cur, text, textsz) != 0) {
+            free(block);
+            return -1;
+        }
+    }
+
+    if (cur->boot_id[0] != '\0') {
+        mf_state_store(MF_CPU_STATE_NAME, cur, sample_size);
+    }
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_uint(&f, mf_cpu_busy(&prev->times[0], &cur->times[0], 100U));
+    mf_fmt_str(&f, "%");
+    mf_cpu_sparkline(&f, prev, cur);
+    mf_cpu_loadavg(&f);
+    mf_cpu_freq(&f);
+
+    free(block);
+    return 0;
+}
+#else
+int mf_collect_load(char *out, size_t outsz)
+{
+    (void)out;
+    (void)outsz;
+    return -1;
+}
+#endif
@@ -1,12 +1,13 @@
 #define _POSIX_C_SOURCE 200809L
 
-#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "linux_extras.h"
 #include "compat.h"
-#include "term.h"
+#include "fileio.h"
+#include "fmt.h"
 
 #if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
 static long mf_parse_kib_value(const char *line, const char *label)
@@ -37,20 +38,19 @@ static long mf_parse_kib_value(const char *line, const char *label)
 int mf_collect_mem(char *out, size_t outsz)
 {
 #if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
-    FILE *fp;
-    char line[256];
+    char data[8192];
+    char *cursor;
+    char *line;
     long total_kib;
     long avail_kib;
     long free_kib;
     long buffers_kib;
     long cached_kib;
-    double used_bytes;
-    double total_bytes;
-    char used_buf[64];
-    char total_buf[64];
+    uint64_t used_bytes;
+    uint64_t total_bytes;
+    struct mf_fmt f;
 
-    fp = fopen("/proc/meminfo", "r");
-    if (fp == NULL) {
+    if (mf_read_file(MF_PATH_MEMINFO, data, sizeof(data)) < 0) {
         return -1;
     }
 
@@ -60,7 +60,8 @@ int mf_collect_mem(char *out, size_t outsz)
     buffers_kib = -1;
     cached_kib = -1;
 
-    while (fgets(line, (int)sizeof(line), fp) != NULL) {
+    cursor = data;
+    while ((line = mf_next_line(&cursor)) != NULL) {
         long value;
         value = mf_parse_kib_value(line, "MemTotal:");
         if (value >= 0) {
@@ -89,8 +90,6 @@ int mf_collect_mem(char *out, size_t outsz)
         }
     }
 
-    fclose(fp);
-
     if (total_kib <= 0) {
         return -1;
     }
@@ -105,16 +104,32 @@ int mf_collect_mem(char *out, size_t outsz)
         return -1;
     }
 
-    used_bytes = ((double)total_kib - (double)avail_kib) * 1024.0;
-    if (used_bytes < 0.0) {
-        used_bytes = 0.0;
+    used_bytes = 0U;
+    if (total_kib > avail_kib) {
+        used_bytes = (uint64_t)(total_kib - avail_kib) * 1024U;
+    }
+    total_bytes = (uint64_t)total_kib * 1024U;
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_bytes(&f, used_bytes);
+    mf_fmt_str(&f, " / ");
+    mf_fmt_bytes(&f, total_bytes);
+
+    /* A memory.max below the host total is the real ceiling; show the
+     * cgroup's own usage against it. */
+    {
+        const struct mf_cgroup_limits *lim;
+        uint64_t current;
+
+        lim = mf_cgroup_limits();
+        if (lim->mem_max > 0U && lim->mem_max < total_bytes && mf_cgroup_memory_current(&current) == 0) {
+            mf_fmt_str(&f, " (cgroup ");
+            mf_fmt_bytes(&f, current);
+            mf_fmt_str(&f, " / ");
+            mf_fmt_bytes(&f, lim->mem_max);
+            mf_fmt_str(&f, ")");
+        }
     }
-    total_bytes = (double)total_kib * 1024.0;
-
-    mf_format_bytes(used_bytes, used_buf, sizeof(used_buf));
-    mf_format_bytes(total_bytes, total_buf, sizeof(total_buf));
-
-    snprintf(out, outsz, "%s / %s", used_buf, total_buf);
     return 0;
 #else
     (void)out;
@@ -126,49 +141,21 @@ int mf_collect_mem(char *out, size_t outsz)
 int mf_collect_uptime(char *out, size_t outsz)
 {
 #if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
-    FILE *fp;
     char line[128];
-    double seconds;
-    char *endptr;
-    long total_minutes;
-    long days;
-    long hours;
-    long minutes;
+    uint64_t seconds;
+    struct mf_fmt f;
 
-    fp = fopen("/proc/uptime", "r");
-    if (fp == NULL) {
+    if (mf_read_file(MF_PATH_UPTIME, line, sizeof(line)) < 0) {
         return -1;
     }
 
-    if (fgets(line, (int)sizeof(line), fp) == NULL) {
-        fclose(fp);
+    /* Only whole minutes are shown, so the fractional part is ignored. */
+    if (mf_parse_u64(line, &seconds) == 0U) {
         return -1;
     }
 
-    fclose(fp);
-
-    seconds = strtod(line, &endptr);
-    if (endptr == line || seconds < 0.0) {
-        return -1;
-    }
-
-    total_minutes = (long)(seconds / 60.0);
-    if (total_minutes < 0) {
-        total_minutes = 0;
-    }
-
-    days = total_minutes / (60 * 24);
-    total_minutes -= days * 60 * 24;
-    hours = total_minutes / 60;
-    minutes = total_minutes - hours * 60;
-
-    if (days > 0) {
-        snprintf(out, outsz, "%ldd %ldh %ldm", days, hours, minutes);
-    } else if (hours > 0) {
-        snprintf(out, outsz, "%ldh %ldm", hours, minutes);
-    } else {
-        snprintf(out, outsz, "%ldm", minutes);
-    }
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_duration(&f, seconds);
     return 0;
 #else
     (void)out;
@@ -0,0 +1,696 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+
+static unsigned int g_mounts_top = MF_MOUNTS_TOP_DEFAULT;
+static const char *g_mounts_filter = NULL;
+
+void mf_mounts_configure(unsigned int top_n, const char *filter)
+{
+    g_mounts_top = top_n;
+    g_mounts_filter = (filter != NULL && filter[0] != '\0') ? filter : NULL;
+}
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/statvfs.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MF_MOUNTS_WORKERS 8
+#define MF_MOUNTS_TIMEOUT_MS 250
+#define MF_MOUNTS_DEADLINE_MS 2000
+#define MF_MOUNTS_TOP_MAX 16
+/* Statvfs workers alive at once, across calls. A worker hung on a dead
+ * mount never returns, so this also bounds what repeated calls from
+ * --daemon, --watch or hidden mode can leave behind. */
+#define MF_MOUNTS_THREADS_MAX 32
+
+enum mf_mount_state {
+    MF_MOUNT_PENDING = 0,
+    MF_MOUNT_RUNNING,
+    MF_MOUNT_DONE,
+    MF_MOUNT_FAILED,
+    MF_MOUNT_TIMEDOUT
+};
+
+struct mf_mount {
+    const char *path;
+    const char *fstype;
+    unsigned long dev;
+    size_t order;
+    uint64_t total;
+    uint64_t used;
+    unsigned long fsid; /* statvfs f_fsid; 0 when the filesystem gives none */
+    int state;
+    double started;
+};
+
+/* Shared between the caller and the statvfs workers. Workers may outlive
+ * the caller when a mount hangs, so the pool is reference counted and
+ * freed by whoever drops the last reference. */
+struct mf_mount_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *text;
+    struct mf_mount *mounts;
+    size_t count;
+    size_t next;
+    unsigned int refs;
+    unsigned int busy;
+    int measured; /* the caller stopped waiting and may reorder mounts */
+};
+
+/* Devices whose statvfs was written off and has not returned since. Later
+ * calls report them as timed out without measuring them again; the
+ * stuck worker drops the entry if the call ever returns. Each entry
+ * holds a live worker, so MF_MOUNTS_THREADS_MAX bounds the set too. */
+static pthread_mutex_t g_mounts_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long g_mounts_hung[MF_MOUNTS_THREADS_MAX];
+static unsigned int g_mounts_hung_count;
+static unsigned int g_mounts_threads;
+
+static const char *const g_pseudo_fstypes[] = {
+    "autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs",
+    "debugfs", "devpts", "devtmpfs", "efivarfs", "fusectl", "fuse.gvfsd-fuse",
+    "fuse.lxcfs", "fuse.portal", "fuse.snapfuse", "hugetlbfs", "mqueue",
+    "nsfs", "proc", "pstore", "ramfs", "rpc_pipefs", "securityfs",
+    "selinuxfs", "squashfs", "sysfs", "tmpfs", "tracefs"
+};
+
+static double mf_mounts_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int mf_mounts_is_pseudo(const char *fstype)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(g_pseudo_fstypes) / sizeof(g_pseudo_fstypes[0]); ++i) {
+        if (strcmp(fstype, g_pseudo_fstypes[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* mountinfo escapes space, tab, newline and backslash as \ooo. */
+static void mf_mounts_unescape(char *s)
+{
+    char *r;
+    char *w;
+
+    r = s;
+    w = s;
+    while (*r != '\0') {
+        if (r[0] == '\\' && r[1] >= '0' && r[1] <= '3' && r[2] >= '0' && r[2] <= '7' && r[3] >= '0' && r[3] <= '7') {
+            *w++ = (char)(((r[1] - '0') << 6) | ((r[2] - '0') << 3) | (r[3] - '0'));
+            r += 4;
+        } else {
+            *w++ = *r++;
+        }
+    }
+    *w = '\0';
+}
+
+static char *mf_mounts_field(char **cursor)
+{
+    char *start;
+    char *p;
+
+    p = *cursor;
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p == '\0') {
+        return NULL;
+    }
+    start = p;
+    while (*p != ' ' && *p != '\0') {
+        p++;
+    }
+    if (*p == ' ') {
+        *p++ = '\0';
+    }
+    *cursor = p;
+    return start;
+}
+
+static int mf_mounts_match_filter(const char *path)
+{
+    size_t len;
+
+    if (g_mounts_filter == NULL) {
+        return 1;
+    }
+    len = strlen(g_mounts_filter);
+    if (strncmp(path, g_mounts_filter, len) != 0) {
+        return 0;
+    }
+    return path[len] == '\0' || path[len] == '/' || (len > 0 && g_mounts_filter[len - 1] == '/');
+}
+
+/* Parses one mountinfo line in place. Returns 0 for a mount worth
+ * measuring. */
+static int mf_mounts_parse_line(char *line, struct mf_mount *m)
+{
+    char *cursor;
+    char *devfield;
+    char *mountpoint;
+    char *field;
+    char *colon;
+    unsigned long major;
+    unsigned long minor;
+
+    cursor = line;
+    if (mf_mounts_field(&cursor) == NULL || mf_mounts_field(&cursor) == NULL) {
+        return -1;
+    }
+    devfield = mf_mounts_field(&cursor);
+    if (devfield == NULL || mf_mounts_field(&cursor) == NULL) {
+        return -1;
+    }
+    mountpoint = mf_mounts_field(&cursor);
+    if (mountpoint == NULL) {
+        return -1;
+    }
+
+    /* Skip mount options and the optional tagged fields up to "-". */
+    do {
+        field = mf_mounts_field(&cursor);
+    } while (field != NULL && strcmp(field, "-") != 0);
+    if (field == NULL) {
+        return -1;
+    }
+
+    m->fstype = mf_mounts_field(&cursor);
+    if (m->fstype == NULL || mf_mounts_is_pseudo(m->fstype)) {
+        return -1;
+    }
+
+    mf_mounts_unescape(mountpoint);
+    if (!mf_mounts_match_filter(mountpoint)) {
+        return -1;
+    }
+
+    major = strtoul(devfield, &colon, 10);
+    if (*colon != ':') {
+        return -1;
+    }
+    minor = strtoul(colon + 1, NULL, 10);
+
+    m->path = mountpoint;
+    m->dev = (major << 20) | minor;
+    m->state = MF_MOUNT_PENDING;
+    m->total = 0U;
+    m->used = 0U;
+    return 0;
+}
+
+static int mf_mounts_cmp_dev(const void *a, const void *b)
+{
+    const struct mf_mount *ma = (const struct mf_mount *)a;
+    const struct mf_mount *mb = (const struct mf_mount *)b;
+
+    if (ma->dev != mb->dev) {
+        return ma->dev < mb->dev ? -1 : 1;
+    }
+    return ma->order < mb->order ? -1 : (ma->order > mb->order ? 1 : 0);
+}
+
+static int mf_mounts_cmp_order(const void *a, const void *b)
+{
+    const struct mf_mount *ma = (const struct mf_mount *)a;
+    const struct mf_mount *mb = (const struct mf_mount *)b;
+
+    return ma->order < mb->order ? -1 : (ma->order > mb->order ? 1 : 0);
+}
+
+/* Orders measured mounts so that views of one filesystem that show up
+ * under different devices (bind mounts across devices) end up adjacent. */
+static int mf_mounts_cmp_fsid(const void *a, const void *b)
+{
+    const struct mf_mount *ma = (const struct mf_mount *)a;
+    const struct mf_mount *mb = (const struct mf_mount *)b;
+
+    if (ma->state != mb->state) {
+        return ma->state < mb->state ? -1 : 1;
+    }
+    if (ma->fsid != mb->fsid) {
+        return ma->fsid < mb->fsid ? -1 : 1;
+    }
+    return ma->order < mb->order ? -1 : (ma->order > mb->order ? 1 : 0);
+}
+
+/* Callers hold g_mounts_lock. */
+static int mf_mounts_hung_find(unsigned long dev)
+{
+    unsigned int i;
+
+    for (i = 0; i < g_mounts_hung_count; ++i) {
+        if (g_mounts_hung[i] == dev) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void mf_mounts_hung_add(unsigned long dev)
+{
+    pthread_mutex_lock(&g_mounts_lock);
+    if (mf_mounts_hung_find(dev) < 0 && g_mounts_hung_count < MF_MOUNTS_THREADS_MAX) {
+        g_mounts_hung[g_mounts_hung_count++] = dev;
+    }
+    pthread_mutex_unlock(&g_mounts_lock);
+}
+
+static void mf_mounts_hung_remove(unsigned long dev)
+{
+    int i;
+
+    pthread_mutex_lock(&g_mounts_lock);
+    i = mf_mounts_hung_find(dev);
+    if (i >= 0) {
+        g_mounts_hung[i] = g_mounts_hung[--g_mounts_hung_count];
+    }
+    pthread_mutex_unlock(&g_mounts_lock);
+}
+
+static int mf_mounts_hung_has(unsigned long dev)
+{
+    int found;
+
+    pthread_mutex_lock(&g_mounts_lock);
+    found = mf_mounts_hung_find(dev) >= 0;
+    pthread_mutex_unlock(&g_mounts_lock);
+    return found;
+}
+
+static void mf_mounts_release(struct mf_mount_pool *pool)
+{
+    int last;
+
+    pool->refs--;
+    last = pool->refs == 0U;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (last) {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->mounts);
+        free(pool->text);
+        free(pool);
+    }
+}
+
+/* Under --root the mount points are paths inside the root. */
+static int mf_mounts_statvfs(const char *path, struct statvfs *vfs)
+{
+    int fd;
+    int rc;
+
+    if (mf_fileio_root() == AT_FDCWD) {
+        return statvfs(path, vfs);
+    }
+    fd = mf_open_dir(path);
+    if (fd < 0) {
+        return -1;
+    }
+    rc = fstatvfs(fd, vfs);
+    close(fd);
+    return rc;
+}
+
+static void *mf_mounts_worker(void *arg)
+{
+    struct mf_mount_pool *pool = (struct mf_mount_pool *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        struct mf_mount *m;
+        struct statvfs vfs;
+        const char *path;
+        unsigned long dev;
+        int rc;
+
+        while (!pool->measured && pool->next < pool->count && pool->mounts[pool->next].state != MF_MOUNT_PENDING) {
+            pool->next++;
+        }
+        if (pool->measured || pool->next >= pool->count) {
+            break;
+        }
+
+        /* Once the caller stops waiting it sorts pool->mounts, so what
+         * is needed outside the lock is copied and m is only trusted
+         * again while it has not. The path itself lives in pool->text,
+         * which stays put. */
+        m = &pool->mounts[pool->next++];
+        m->state = MF_MOUNT_RUNNING;
+        m->started = mf_mounts_now();
+        path = m->path;
+        dev = m->dev;
+        pool->busy++;
+        pthread_mutex_unlock(&pool->lock);
+
+        rc = mf_mounts_statvfs(path, &vfs);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->busy--;
+        if (pool->measured || m->state != MF_MOUNT_RUNNING) {
+            /* Written off, but it answered after all: measure it again
+             * next time. Taken under pool->lock, as the caller does when
+             * it adds the entry. */
+            mf_mounts_hung_remove(dev);
+        } else {
+            if (rc == 0 && vfs.f_blocks > 0) {
+                uint64_t avail;
+
+                m->total = (uint64_t)vfs.f_blocks * (uint64_t)vfs.f_frsize;
+                avail = (uint64_t)vfs.f_bavail * (uint64_t)vfs.f_frsize;
+                m->used = m->total > avail ? m->total - avail : 0U;
+                m->fsid = (unsigned long)vfs.f_fsid;
+                m->state = MF_MOUNT_DONE;
+            } else {
+                m->state = MF_MOUNT_FAILED;
+            }
+        }
+        pthread_cond_signal(&pool->cond);
+    }
+
+    mf_mounts_release(pool);
+    pthread_mutex_lock(&g_mounts_lock);
+    g_mounts_threads--;
+    pthread_mutex_unlock(&g_mounts_lock);
+    return NULL;
+}
+
+static int mf_mounts_spawn(struct mf_mount_pool *pool)
+{
+    pthread_t tid;
+    pthread_attr_t attr;
+    int rc;
+
+    pthread_mutex_lock(&g_mounts_lock);
+    if (g_mounts_threads >= MF_MOUNTS_THREADS_MAX) {
+        pthread_mutex_unlock(&g_mounts_lock);
+        return -1;
+    }
+    g_mounts_threads++;
+    pthread_mutex_unlock(&g_mounts_lock);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 64U * 1024U);
+    pool->refs++;
+    rc = pthread_create(&tid, &attr, mf_mounts_worker, pool);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        pool->refs--;
+        pthread_mutex_lock(&g_mounts_lock);
+        g_mounts_threads--;
+        pthread_mutex_unlock(&g_mounts_lock);
+        return -1;
+    }
+    return 0;
+}
+
+/* Runs statvfs over every pending mount on a small worker pool. A mount
+ * that has not answered within MF_MOUNTS_TIMEOUT_MS is written off and
+ * remembered, and a replacement worker is started (within
+ * MF_MOUNTS_THREADS_MAX) so a dead NFS server costs one timeout rather
+ * than the whole run. Called with pool->lock held. */
+static void mf_mounts_measure(struct mf_mount_pool *pool)
+{
+    pthread_condattr_t cattr;
+    unsigned int workers;
+    unsigned int spawned;
+    unsigned int i;
+    double deadline;
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    workers = 0U;
+    for (i = 0; i < pool->count && workers < MF_MOUNTS_WORKERS; ++i) {
+        if (pool->mounts[i].state == MF_MOUNT_PENDING) {
+            workers++;
+        }
+    }
+    spawned = 0U;
+    for (i = 0; i < workers; ++i) {
+        if (mf_mounts_spawn(pool) == 0) {
+            spawned++;
+        }
+    }
+    if (spawned == 0U) {
+        /* Nothing left to measure, or every worker slot is held by a
+         * hung statvfs. */
+        for (i = 0; i < pool->count; ++i) {
+            if (pool->mounts[i].state == MF_MOUNT_PENDING) {
+                pool->mounts[i].state = MF_MOUNT_TIMEDOUT;
+            }
+        }
+        return;
+    }
+
+    deadline = mf_mounts_now() + MF_MOUNTS_DEADLINE_MS / 1000.0;
+    for (;;) {
+        double now;
+        double wake;
+        size_t pending;
+        size_t k;
+        unsigned int stuck;
+        struct timespec ts;
+
+        now = mf_mounts_now();
+        wake = now + MF_MOUNTS_TIMEOUT_MS / 1000.0;
+        pending = 0U;
+        stuck = 0U;
+        for (k = 0; k < pool->count; ++k) {
+            struct mf_mount *m = &pool->mounts[k];
+
+            if (m->state == MF_MOUNT_RUNNING) {
+                double expires = m->started + MF_MOUNTS_TIMEOUT_MS / 1000.0;
+                if (expires <= now || now >= deadline) {
+                    m->state = MF_MOUNT_TIMEDOUT;
+                    mf_mounts_hung_add(m->dev);
+                    stuck++;
+                    continue;
+                }
+                if (expires < wake) {
+                    wake = expires;
+                }
+                pending++;
+            } else if (m->state == MF_MOUNT_PENDING) {
+                if (now >= deadline) {
+                    m->state = MF_MOUNT_TIMEDOUT;
+                    continue;
+                }
+                pending++;
+            }
+        }
+        if (pending == 0U) {
+            break;
+        }
+
+        /* Workers hung in statvfs still count as busy; replace them so
+         * the queue keeps draining. */
+        while (stuck > 0U && mf_mounts_spawn(pool) == 0) {
+            stuck--;
+        }
+
+        if (wake > deadline) {
+            wake = deadline;
+        }
+        ts.tv_sec = (time_t)wake;
+        ts.tv_nsec = (long)((wake - (double)ts.tv_sec) * 1e9);
+        pthread_cond_timedwait(&pool->cond, &pool->lock, &ts);
+    }
+}
+
+int mf_collect_mounts(char *out, size_t outsz)
+{
+    struct mf_mount_pool *pool;
+    char *cursor;
+    char *line;
+    size_t capacity;
+    size_t kept;
+    size_t k;
+    size_t n_ok;
+    size_t n_timeout;
+    uint64_t sum_total;
+    uint64_t sum_used;
+    char top_path[MF_MOUNTS_TOP_MAX][128];
+    uint64_t top_total[MF_MOUNTS_TOP_MAX];
+    uint64_t top_used[MF_MOUNTS_TOP_MAX];
+    unsigned int top_n;
+    unsigned int top_count;
+    struct mf_fmt f;
+
+    pool = (struct mf_mount_pool *)calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        return -1;
+    }
+
+    pool->text = mf_read_file_alloc("/proc/self/mountinfo", NULL);
+    if (pool->text == NULL) {
+        free(pool);
+        return -1;
+    }
+
+    capacity = 1U;
+    for (cursor = pool->text; *cursor != '\0'; ++cursor) {
+        if (*cursor == '\n') {
+            capacity++;
+        }
+    }
+    pool->mounts = (struct mf_mount *)calloc(capacity, sizeof(struct mf_mount));
+    if (pool->mounts == NULL) {
+        free(pool->text);
+        free(pool);
+        return -1;
+    }
+
+    cursor = pool->text;
+    while ((line = mf_next_line(&cursor)) != NULL && pool->count < capacity) {
+        struct mf_mount *m = &pool->mounts[pool->count];
+        if (mf_mounts_parse_line(line, m) == 0) {
+            m->order = pool->count;
+            pool->count++;
+        }
+    }
+
+    /* Bind mounts and repeated mounts of one device: keep the first. */
+    qsort(pool->mounts, pool->count, sizeof(struct mf_mount), mf_mounts_cmp_dev);
+    kept = 0U;
+    for (k = 0; k < pool->count; ++k) {
+        if (kept > 0U && pool->mounts[kept - 1U].dev == pool->mounts[k].dev) {
+            continue;
+        }
+        pool->mounts[kept++] = pool->mounts[k];
+    }
+    pool->count = kept;
+    for (k = 0; k < pool->count; ++k) {
+        if (mf_mounts_hung_has(pool->mounts[k].dev)) {
+            pool->mounts[k].state = MF_MOUNT_TIMEDOUT;
+        }
+    }
+    /* Measure in mount order so "/" and early mounts are never starved by
+     * a run of hung ones. */
+    qsort(pool->mounts, pool->count, sizeof(struct mf_mount), mf_mounts_cmp_order);
+
+    if (pool->count == 0U) {
+        free(pool->mounts);
+        free(pool->text);
+        free(pool);
+        return -1;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->refs = 1U;
+    pthread_mutex_lock(&pool->lock);
+    mf_mounts_measure(pool);
+    pool->measured = 1;
+
+    qsort(pool->mounts, pool->count, sizeof(struct mf_mount), mf_mounts_cmp_fsid);
+
+    top_n = g_mounts_top < MF_MOUNTS_TOP_MAX ? g_mounts_top : MF_MOUNTS_TOP_MAX;
+    top_count = 0U;
+    n_ok = 0U;
+    n_timeout = 0U;
+    sum_total = 0U;
+    sum_used = 0U;
+    for (k = 0; k < pool->count; ++k) {
+        struct mf_mount *m = &pool->mounts[k];
+        unsigned int slot;
+
+        if (m->state == MF_MOUNT_TIMEDOUT) {
+            n_timeout++;
+            continue;
+        }
+        if (m->state != MF_MOUNT_DONE) {
+            continue;
+        }
+        /* One filesystem under two devices counts once; filesystems
+         * without an id are told apart by device alone. */
+        if (m->fsid != 0U && k > 0U && pool->mounts[k - 1U].state == MF_MOUNT_DONE && pool->mounts[k - 1U].fsid == m->fsid) {
+            continue;
+        }
+
+        n_ok++;
+        sum_total += m->total;
+        sum_used += m->used;
+
+        /* Insertion into the largest-first top list. */
+        if (top_n == 0U) {
+            continue;
+        }
+        slot = top_count;
+        while (slot > 0U && top_total[slot - 1U] < m->total) {
+            slot--;
+        }
+        if (slot >= top_n) {
+            continue;
+        }
+        if (top_count < top_n) {
+            top_count++;
+        }
+        memmove(&top_total[slot + 1U], &top_total[slot], (top_count - 1U - slot) * sizeof(top_total[0]));
+        memmove(&top_used[slot + 1U], &top_used[slot], (top_count - 1U - slot) * sizeof(top_used[0]));
+        memmove(&top_path[slot + 1U], &top_path[slot], (top_count - 1U - slot) * sizeof(top_path[0]));
+        top_total[slot] = m->total;
+        top_used[slot] = m->used;
+        mf_strlcpy(top_path[slot], m->path, sizeof(top_path[slot]));
+    }
+
+    mf_mounts_release(pool);
+
+    if (n_ok == 0U) {
+        return -1;
+    }
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_uint(&f, (uint64_t)n_ok);
+    mf_fmt_str(&f, n_ok == 1U ? " mount, " : " mounts, ");
+    mf_fmt_bytes(&f, sum_used);
+    mf_fmt_str(&f, " / ");
+    mf_fmt_bytes(&f, sum_total);
+    mf_fmt_str(&f, " (");
+    mf_fmt_percent(&f, sum_used, sum_total);
+    mf_fmt_str(&f, ")");
+    for (k = 0; k < top_count; ++k) {
+        mf_fmt_str(&f, k == 0U ? "; " : ", ");
+        mf_fmt_str(&f, top_path[k]);
+        mf_fmt_str(&f, " ");
+        mf_fmt_percent(&f, top_used[k], top_total[k]);
+    }
+    if (n_timeout > 0U) {
+        mf_fmt_str(&f, "; ");
+        mf_fmt_uint(&f, (uint64_t)n_timeout);
+        mf_fmt_str(&f, " timed out");
+    }
+    return 0;
+}
+#else
+int mf_collect_mounts(char *out, size_t outsz)
+{
+    (void)out;
+    (void)outsz;
+    return -1;
+}
+#endif
@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#define MF_PSI_PATH_MAX 512
+
+enum mf_psi_probe {
+    MF_PSI_UNPROBED = 0,
+    MF_PSI_AVAILABLE,
+    MF_PSI_MISSING
+};
+
+/* Directory holding cpu/memory/io pressure files, settled on the first
+ * call: the caller's cgroup v2 directory when it exposes cpu.pressure,
+ * else /proc/pressure. Kernels built without PSI (or booted psi=0) are
+ * remembered so later calls skip straight to failure. */
+static int g_psi_probe = MF_PSI_UNPROBED;
+static char g_psi_prefix[MF_PSI_PATH_MAX];
+static int g_psi_cgroup = 0;
+
+static const char *const g_psi_cgroup_names[] = { "cpu.pressure", "memory.pressure", "io.pressure" };
+static const char *const g_psi_proc_names[] = { "cpu", "memory", "io" };
+static const char *const g_psi_labels[] = { "cpu", "mem", "io" };
+
+static void mf_psi_path(char *out, size_t outsz, int cgroup, size_t which)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_str(&f, g_psi_prefix);
+    mf_fmt_str(&f, cgroup ? g_psi_cgroup_names[which] : g_psi_proc_names[which]);
+}
+
+/* Reads the first pressure file, settling g_psi_prefix on success. */
+static long mf_psi_probe(char *data, size_t datasz)
+{
+    char path[MF_PSI_PATH_MAX];
+    long n;
+
+    if (mf_cgroup_dir() != NULL) {
+        mf_strlcpy(g_psi_prefix, mf_cgroup_dir(), sizeof(g_psi_prefix));
+        g_psi_cgroup = 1;
+        mf_psi_path(path, sizeof(path), 1, 0U);
+        n = mf_read_file(path, data, datasz);
+        if (n > 0) {
+            g_psi_probe = MF_PSI_AVAILABLE;
+            return n;
+        }
+    }
+
+    g_psi_cgroup = 0;
+    mf_strlcpy(g_psi_prefix, MF_PATH_PRESSURE "/", sizeof(g_psi_prefix));
+    mf_psi_path(path, sizeof(path), 0, 0U);
+    n = mf_read_file(path, data, datasz);
+    g_psi_probe = n > 0 ? MF_PSI_AVAILABLE : MF_PSI_MISSING;
+    return n;
+}
+
+/* Copies the avg10 and avg60 values of a "some"/"full" line as
+ * "A/B"; the kernel already prints them with two decimals. */
+static int mf_psi_pair(const char *text, const char *kind, char *out, size_t outsz)
+{
+    const char *line;
+    const char *avg10;
+    const char *avg60;
+    size_t len10;
+    size_t len60;
+
+    line = text;
+    while (strncmp(line, kind, strlen(kind)) != 0) {
+        line = strchr(line, '\n');
+        if (line == NULL) {
+            return -1;
+        }
+        line++;
+    }
+
+    avg10 = strstr(line, "avg10=");
+    avg60 = strstr(line, "avg60=");
+    if (avg10 == NULL || avg60 == NULL) {
+        return -1;
+    }
+    avg10 += 6;
+    avg60 += 6;
+    len10 = strcspn(avg10, " \n");
+    len60 = strcspn(avg60, " \n");
+    if (len10 == 0U || len60 == 0U || len10 + len60 + 2U > outsz) {
+        return -1;
+    }
+
+    memcpy(out, avg10, len10);
+    out[len10] = '/';
+    memcpy(out + len10 + 1U, avg60, len60);
+    out[len10 + 1U + len60] = '\0';
+    return 0;
+}
+#endif
+
+int mf_collect_pressure(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    char data[3][256];
+    char some[3][32];
+    char full[3][32];
+    int have_some[3];
+    int have_full[3];
+    int any_full;
+    size_t i;
+    struct mf_fmt f;
+
+    if (g_psi_probe == MF_PSI_MISSING) {
+        return -1;
+    }
+    if (g_psi_probe == MF_PSI_UNPROBED) {
+        if (mf_psi_probe(data[0], sizeof(data[0])) <= 0) {
+            return -1;
+        }
+    } else {
+        char path[MF_PSI_PATH_MAX];
+
+        mf_psi_path(path, sizeof(path), g_psi_cgroup, 0U);
+        if (mf_read_file(path, data[0], sizeof(data[0])) <= 0) {
+            return -1;
+        }
+    }
+
+    for (i = 1; i < 3U; ++i) {
+        char path[MF_PSI_PATH_MAX];
+
+        mf_psi_path(path, sizeof(path), g_psi_cgroup, i);
+        if (mf_read_file(path, data[i], sizeof(data[i])) <= 0) {
+            data[i][0] = '\0';
+        }
+    }
+
+    any_full = 0;
+    for (i = 0; i < 3U; ++i) {
+        have_some[i] = mf_psi_pair(data[i], "some", some[i], sizeof(some[i])) == 0;
+        have_full[i] = mf_psi_pair(data[i], "full", full[i], sizeof(full[i])) == 0;
+        any_full |= have_full[i];
+    }
+
+    /* "some cpu A/B mem A/B io A/B; full ..." with avg10/avg60 pairs, so
+     * -q output can be ranked with sort -k. */
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_str(&f, "some");
+    for (i = 0; i < 3U; ++i) {
+        if (!have_some[i]) {
+            continue;
+        }
+        mf_fmt_str(&f, " ");
+        mf_fmt_str(&f, g_psi_labels[i]);
+        mf_fmt_str(&f, " ");
+        mf_fmt_str(&f, some[i]);
+    }
+    if (any_full) {
+        mf_fmt_str(&f, "; full");
+        for (i = 0; i < 3U; ++i) {
+            if (!have_full[i]) {
+                continue;
+            }
+            mf_fmt_str(&f, " ");
+            mf_fmt_str(&f, g_psi_labels[i]);
+            mf_fmt_str(&f, " ");
+            mf_fmt_str(&f, full[i]);
+        }
+    }
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
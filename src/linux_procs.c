@@ -0,0 +1,453 @@
+/* syscall(2) and SYS_getdents64 are not in POSIX. */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MF_PROCS_DENTS_BYTES (64U * 1024U)
+#define MF_PROCS_TOP_MAX 8U
+#define MF_PROCS_MAX_WORKERS 4U
+/* Below this many PIDs a second thread costs more than it saves. */
+#define MF_PROCS_SPLIT_MIN 4096U
+
+struct mf_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct mf_proc_top {
+    uint64_t key;
+    char comm[24];
+};
+
+/* Bounded min-heap: the root is the smallest of the N kept, so a new
+ * candidate only has to beat it. */
+struct mf_proc_heap {
+    struct mf_proc_top item[MF_PROCS_TOP_MAX];
+    unsigned int len;
+    unsigned int cap;
+};
+
+struct mf_proc_census {
+    uint64_t procs;
+    uint64_t threads;
+    uint64_t zombies;
+    struct mf_proc_heap rss;
+    struct mf_proc_heap cpu;
+};
+
+struct mf_proc_job {
+    int procfd;
+    const uint32_t *pids;
+    size_t count;
+    uint64_t uptime_ticks;
+    uint64_t page_size;
+    uint64_t hz;
+    struct mf_proc_census census;
+};
+
+static void mf_proc_heap_sift_down(struct mf_proc_heap *h, unsigned int i)
+{
+    for (;;) {
+        unsigned int l = 2U * i + 1U;
+        unsigned int r = l + 1U;
+        unsigned int m = i;
+        struct mf_proc_top tmp;
+
+        if (l < h->len && h->item[l].key < h->item[m].key) {
+            m = l;
+        }
+        if (r < h->len && h->item[r].key < h->item[m].key) {
+            m = r;
+        }
+        if (m == i) {
+            return;
+        }
+        tmp = h->item[i];
+        h->item[i] = h->item[m];
+        h->item[m] = tmp;
+        i = m;
+    }
+}
+
+static void mf_proc_heap_push(struct mf_proc_heap *h, uint64_t key, const char *comm, size_t comm_len)
+{
+    struct mf_proc_top *slot;
+    unsigned int i;
+
+    if (h->cap == 0U) {
+        return;
+    }
+    if (h->len == h->cap) {
+        if (key <= h->item[0].key) {
+            return;
+        }
+        slot = &h->item[0];
+    } else {
+        slot = &h->item[h->len++];
+    }
+
+    slot->key = key;
+    if (comm_len >= sizeof(slot->comm)) {
+        comm_len = sizeof(slot->comm) - 1U;
+    }
+    memcpy(slot->comm, comm, comm_len);
+    slot->comm[comm_len] = '\0';
+
+    if (slot == &h->item[0]) {
+        mf_proc_heap_sift_down(h, 0U);
+        return;
+    }
+    /* Sift the new leaf up. */
+    i = h->len - 1U;
+    while (i > 0U) {
+        unsigned int parent = (i - 1U) / 2U;
+        struct mf_proc_top tmp;
+
+        if (h->item[parent].key <= h->item[i].key) {
+            break;
+        }
+        tmp = h->item[parent];
+        h->item[parent] = h->item[i];
+        h->item[i] = tmp;
+        i = parent;
+    }
+}
+
+/* Skips n space-separated fields. */
+static const char *mf_proc_skip(const char *p, unsigned int n)
+{
+    while (n-- > 0U) {
+        while (*p != ' ' && *p != '\0') {
+            p++;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+    }
+    return p;
+}
+
+static const char *mf_proc_u64(const char *p, uint64_t *v)
+{
+    uint64_t x = 0U;
+
+    while (*p >= '0' && *p <= '9') {
+        x = x * 10U + (uint64_t)(*p - '0');
+        p++;
+    }
+    *v = x;
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+/* Reads /proc/<pid>/stat with one openat and one read, and folds the
+ * fields the census needs: state (3), utime/stime (14, 15), num_threads
+ * (20), starttime (22) and rss (24). */
+static void mf_proc_visit(struct mf_proc_job *job, uint32_t pid)
+{
+    char path[24];
+    char buf[1024];
+    const char *open_paren;
+    const char *close_paren;
+    const char *p;
+    uint64_t utime;
+    uint64_t stime;
+    uint64_t threads;
+    uint64_t start;
+    uint64_t rss;
+    ssize_t n;
+    int fd;
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, path, sizeof(path));
+    mf_fmt_uint(&f, pid);
+    mf_fmt_str(&f, "/stat");
+
+    fd = openat(job->procfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return; /* exited since the directory scan */
+    }
+    n = read(fd, buf, sizeof(buf) - 1U);
+    close(fd);
+    if (n <= 0) {
+        return;
+    }
+    buf[n] = '\0';
+
+    /* comm may itself contain spaces and parentheses; it ends at the
+     * last ')'. */
+    open_paren = strchr(buf, '(');
+    close_paren = strrchr(buf, ')');
+    if (open_paren == NULL || close_paren == NULL || close_paren < open_paren || close_paren[1] != ' ') {
+        return;
+    }
+
+    p = close_paren + 2;
+    job->census.procs++;
+    if (*p == 'Z') {
+        job->census.zombies++;
+    }
+    p = mf_proc_skip(p, 11U);
+    p = mf_proc_u64(p, &utime);
+    p = mf_proc_u64(p, &stime);
+    p = mf_proc_skip(p, 4U);
+    p = mf_proc_u64(p, &threads);
+    p = mf_proc_skip(p, 1U);
+    p = mf_proc_u64(p, &start);
+    p = mf_proc_skip(p, 1U);
+    mf_proc_u64(p, &rss);
+
+    job->census.threads += threads;
+    mf_proc_heap_push(&job->census.rss, rss * job->page_size, open_paren + 1, (size_t)(close_paren - open_paren - 1));
+    /* Lifetime CPU share in 1/1000 of a CPU; anything younger than a
+     * second (this process included) has too short a lifetime to rank. */
+    if (job->uptime_ticks > start + job->hz) {
+        uint64_t share = (utime + stime) * 1000U / (job->uptime_ticks - start);
+        mf_proc_heap_push(&job->census.cpu, share, open_paren + 1, (size_t)(close_paren - open_paren - 1));
+    }
+}
+
+static void *mf_proc_worker(void *arg)
+{
+    struct mf_proc_job *job = (struct mf_proc_job *)arg;
+    size_t i;
+
+    for (i = 0; i < job->count; ++i) {
+        mf_proc_visit(job, job->pids[i]);
+    }
+    return NULL;
+}
+
+/* Collects every numeric entry of /proc with large getdents64 batches;
+ * d_type lets non-directories be skipped without a stat. */
+static uint32_t *mf_proc_list(int procfd, size_t *count_out)
+{
+    char *dents;
+    uint32_t *pids;
+    size_t count;
+    size_t cap;
+
+    dents = (char *)malloc(MF_PROCS_DENTS_BYTES);
+    cap = 1024U;
+    pids = (uint32_t *)malloc(cap * sizeof(uint32_t));
+    if (dents == NULL || pids == NULL) {
+        free(dents);
+        free(pids);
+        return NULL;
+    }
+
+    count = 0U;
+    for (;;) {
+        long n;
+        long off;
+
+        n = syscall(SYS_getdents64, procfd, dents, MF_PROCS_DENTS_BYTES);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (off = 0; off < n;) {
+            const struct mf_dirent64 *d = (const struct mf_dirent64 *)(const void *)(dents + off);
+            const char *s = d->d_name;
+            uint32_t pid = 0U;
+
+            off += d->d_reclen;
+            if (d->d_type != DT_DIR || *s < '1' || *s > '9') {
+                continue;
+            }
+            while (*s >= '0' && *s <= '9') {
+                pid = pid * 10U + (uint32_t)(*s - '0');
+                s++;
+            }
+            if (count == cap) {
+                uint32_t *grown = (uint32_t *)realloc(pids, cap * 2U * sizeof(uint32_t));
+                if (grown == NULL) {
+                    break;
+                }
+                pids = grown;
+                cap *= 2U;
+            }
+            pids[count++] = pid;
+        }
+    }
+
+    free(dents);
+    *count_out = count;
+    return pids;
+}
+
+static void mf_proc_merge(struct mf_proc_census *into, const struct mf_proc_census *from)
+{
+    unsigned int i;
+
+    into->procs += from->procs;
+    into->threads += from->threads;
+    into->zombies += from->zombies;
+    for (i = 0; i < from->rss.len; ++i) {
+        mf_proc_heap_push(&into->rss, from->rss.item[i].key, from->rss.item[i].comm, strlen(from->rss.item[i].comm));
+    }
+    for (i = 0; i < from->cpu.len; ++i) {
+        mf_proc_heap_push(&into->cpu, from->cpu.item[i].key, from->cpu.item[i].comm, strlen(from->cpu.item[i].comm));
+    }
+}
+
+/* Largest first; the heap array itself is only partially ordered. */
+static void mf_proc_heap_sort(struct mf_proc_heap *h)
+{
+    unsigned int i;
+    unsigned int j;
+
+    for (i = 1; i < h->len; ++i) {
+        struct mf_proc_top v = h->item[i];
+
+        j = i;
+        while (j > 0U && h->item[j - 1U].key < v.key) {
+            h->item[j] = h->item[j - 1U];
+            j--;
+        }
+        h->item[j] = v;
+    }
+}
+#endif
+
+int mf_collect_procs(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    struct mf_proc_job jobs[MF_PROCS_MAX_WORKERS];
+    pthread_t tids[MF_PROCS_MAX_WORKERS];
+    int started[MF_PROCS_MAX_WORKERS];
+    struct mf_proc_census total;
+    uint32_t *pids;
+    size_t count;
+    size_t workers;
+    size_t chunk;
+    size_t i;
+    long cpus;
+    long hz;
+    long page;
+    char data[128];
+    uint64_t uptime_s;
+    uint64_t uptime_cs;
+    size_t used;
+    uint64_t top;
+    int procfd;
+    struct mf_fmt f;
+
+    procfd = mf_open_dir(MF_PATH_PROC);
+    if (procfd < 0) {
+        return -1;
+    }
+    pids = mf_proc_list(procfd, &count);
+    if (pids == NULL || count == 0U) {
+        free(pids);
+        close(procfd);
+        return -1;
+    }
+
+    hz = sysconf(_SC_CLK_TCK);
+    page = sysconf(_SC_PAGESIZE);
+    if (hz <= 0) {
+        hz = 100;
+    }
+    uptime_s = 0U;
+    uptime_cs = 0U;
+    if (mf_read_file(MF_PATH_UPTIME, data, sizeof(data)) > 0) {
+        used = mf_parse_u64(data, &uptime_s);
+        if (data[used] == '.') {
+            mf_parse_u64(data + used + 1U, &uptime_cs);
+        }
+    }
+    top = CFG_PROCS_TOP < MF_PROCS_TOP_MAX ? CFG_PROCS_TOP : MF_PROCS_TOP_MAX;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = 1U;
+    if (count >= MF_PROCS_SPLIT_MIN && cpus > 1) {
+        workers = (size_t)cpus < MF_PROCS_MAX_WORKERS ? (size_t)cpus : MF_PROCS_MAX_WORKERS;
+    }
+    chunk = (count + workers - 1U) / workers;
+
+    for (i = 0; i < workers; ++i) {
+        size_t first = i * chunk;
+
+        memset(&jobs[i], 0, sizeof(jobs[i]));
+        jobs[i].procfd = procfd;
+        jobs[i].pids = pids + first;
+        jobs[i].count = first < count ? (count - first < chunk ? count - first : chunk) : 0U;
+        jobs[i].uptime_ticks = uptime_s * (uint64_t)hz + uptime_cs * (uint64_t)hz / 100U;
+        jobs[i].hz = (uint64_t)hz;
+        jobs[i].page_size = page > 0 ? (uint64_t)page : 4096U;
+        jobs[i].census.rss.cap = (unsigned int)top;
+        jobs[i].census.cpu.cap = (unsigned int)top;
+        /* The calling thread takes the first chunk itself. */
+        started[i] = i > 0U && pthread_create(&tids[i], NULL, mf_proc_worker, &jobs[i]) == 0;
+    }
+    mf_proc_worker(&jobs[0]);
+
+    memset(&total, 0, sizeof(total));
+    total.rss.cap = (unsigned int)top;
+    total.cpu.cap = (unsigned int)top;
+    for (i = 0; i < workers; ++i) {
+        if (i > 0U) {
+            if (started[i]) {
+                pthread_join(tids[i], NULL);
+            } else {
+                mf_proc_worker(&jobs[i]);
+            }
+        }
+        mf_proc_merge(&total, &jobs[i].census);
+    }
+    free(pids);
+    close(procfd);
+
+    mf_proc_heap_sort(&total.rss);
+    mf_proc_heap_sort(&total.cpu);
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_uint(&f, total.procs);
+    mf_fmt_str(&f, " (");
+    mf_fmt_uint(&f, total.threads);
+    mf_fmt_str(&f, " threads, ");
+    mf_fmt_uint(&f, total.zombies);
+    mf_fmt_str(&f, total.zombies == 1U ? " zombie)" : " zombies)");
+    for (i = 0; i < total.rss.len; ++i) {
+        mf_fmt_str(&f, i == 0U ? "; rss " : ", ");
+        mf_fmt_str(&f, total.rss.item[i].comm);
+        mf_fmt_str(&f, " ");
+        mf_fmt_bytes(&f, total.rss.item[i].key);
+    }
+    for (i = 0; i < total.cpu.len; ++i) {
+        mf_fmt_str(&f, i == 0U ? "; cpu " : ", ");
+        mf_fmt_str(&f, total.cpu.item[i].comm);
+        mf_fmt_str(&f, " ");
+        mf_fmt_percent(&f, total.cpu.item[i].key, 1000U);
+    }
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
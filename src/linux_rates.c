@@ -0,0 +1,434 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+#include "state.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <dirent.h>
+#include <time.h>
+
+#define MF_RATE_MAGIC 0x3152464dU /* "MFR1" */
+#define MF_RATE_MAX_DEVICES 64U
+#define MF_RATE_NAME_MAX 24U
+#define MF_RATE_SHOWN 3U
+/* Windows shorter than this are too coarse to report as a rate. */
+#define MF_RATE_MIN_AGE_NS 50000000ULL
+/* Beyond this the "rate" would be a long-run average; show totals. */
+#define MF_RATE_MAX_AGE_NS 3600000000000ULL
+
+/* Counters of one device. Net: rx bytes, tx bytes. Block: reads
+ * completed, sectors read, writes completed, sectors written. */
+struct mf_rate_entry {
+    char name[MF_RATE_NAME_MAX];
+    uint64_t v[4];
+};
+
+/* Saved through the state module; only the used entries are written. */
+struct mf_rate_sample {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t stamp_ns;
+    struct mf_rate_entry e[MF_RATE_MAX_DEVICES];
+};
+
+/* Interface name prefixes that never carry host traffic of their own:
+ * loopback, container/VM plumbing and tunnels layered on real links. */
+static const char *const g_net_virtual[] = {
+    "lo", "veth", "docker", "br-", "virbr", "vnet", "tap", "tun", "cali",
+    "flannel", "cni", "kube-", "ifb", "dummy", "lxc", "vxlan", "genev", "nlmon"
+};
+
+/* Block devices that are views of other devices or of memory. */
+static const char *const g_block_virtual[] = { "loop", "ram", "zram", "dm-", "md", "sr", "nbd" };
+
+static uint64_t mf_rate_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int mf_rate_has_prefix(const char *name, const char *const *prefixes, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const char *mf_rate_skip_u64(const char *p, uint64_t *v)
+{
+    uint64_t x;
+
+    while (*p == ' ') {
+        p++;
+    }
+    x = 0U;
+    while (*p >= '0' && *p <= '9') {
+        x = x * 10U + (uint64_t)(*p - '0');
+        p++;
+    }
+    *v = x;
+    return p;
+}
+
+static size_t mf_rate_sample_size(uint32_t count)
+{
+    return offsetof(struct mf_rate_sample, e) + (size_t)count * sizeof(struct mf_rate_entry);
+}
+
+/* Loads the previous sample for name and saves cur in its place.
+ * Returns the previous sample's age in ns, or 0 when there is none
+ * worth comparing against. */
+static uint64_t mf_rate_swap(const char *name, struct mf_rate_sample *prev, const struct mf_rate_sample *cur)
+{
+    long len;
+    uint64_t age;
+
+    len = mf_state_load(name, prev, sizeof(*prev));
+    age = 0U;
+    if (len >= (long)mf_rate_sample_size(0U) && prev->magic == MF_RATE_MAGIC && prev->count <= MF_RATE_MAX_DEVICES &&
+        len == (long)mf_rate_sample_size(prev->count) && prev->stamp_ns <= cur->stamp_ns) {
+        age = cur->stamp_ns - prev->stamp_ns;
+        if (age > MF_RATE_MAX_AGE_NS) {
+            age = 0U;
+        }
+    }
+    if (age != 0U && age < MF_RATE_MIN_AGE_NS) {
+        /* Keep the older baseline so the next run gets a real window. */
+        return 0U;
+    }
+    mf_state_store(name, cur, mf_rate_sample_size(cur->count));
+    return age;
+}
+
+static const struct mf_rate_entry *mf_rate_find(const struct mf_rate_sample *s, const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < s->count; ++i) {
+        if (strcmp(s->e[i].name, name) == 0) {
+            return &s->e[i];
+        }
+    }
+    return NULL;
+}
+
+/* Per-second rate of a counter delta; 0 when the counter went back
+ * (device re-created, counter reset). */
+static uint64_t mf_rate_per_sec(uint64_t before, uint64_t after, uint64_t age_ns)
+{
+    uint64_t ms;
+
+    if (after < before) {
+        return 0U;
+    }
+    ms = age_ns / 1000000U;
+    if (ms == 0U) {
+        ms = 1U;
+    }
+    return (after - before) * 1000U / ms;
+}
+
+struct mf_rate_row {
+    const char *name;
+    uint64_t r[4];
+    uint64_t weight;
+};
+
+/* Fills rows with the MF_RATE_SHOWN busiest devices, ranked by the sum
+ * of the weighted counters: per-second rates, or totals when age is 0. */
+static size_t mf_rate_rows(const struct mf_rate_sample *prev, const struct mf_rate_sample *cur, uint64_t age,
+                           const unsigned int *weighted, size_t nweighted, struct mf_rate_row *rows)
+{
+    uint32_t i;
+    size_t n;
+    size_t k;
+
+    n = 0U;
+    for (i = 0; i < cur->count; ++i) {
+        const struct mf_rate_entry *before;
+        struct mf_rate_row row;
+        size_t slot;
+
+        before = age != 0U ? mf_rate_find(prev, cur->e[i].name) : NULL;
+        row.name = cur->e[i].name;
+        row.weight = 0U;
+        for (k = 0; k < 4U; ++k) {
+            row.r[k] = before != NULL ? mf_rate_per_sec(before->v[k], cur->e[i].v[k], age) : cur->e[i].v[k];
+        }
+        if (age != 0U && before == NULL) {
+            continue; /* appeared since the last sample */
+        }
+        for (k = 0; k < nweighted; ++k) {
+            row.weight += row.r[weighted[k]];
+        }
+
+        if (n == MF_RATE_SHOWN && rows[n - 1U].weight >= row.weight) {
+            continue;
+        }
+        slot = n < MF_RATE_SHOWN ? n : MF_RATE_SHOWN - 1U;
+        while (slot > 0U && rows[slot - 1U].weight < row.weight) {
+            rows[slot] = rows[slot - 1U];
+            slot--;
+        }
+        rows[slot] = row;
+        if (n < MF_RATE_SHOWN) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void mf_rate_bytes(struct mf_fmt *f, uint64_t bytes, int per_sec)
+{
+    mf_fmt_bytes(f, bytes);
+    if (per_sec) {
+        mf_fmt_str(f, "/s");
+    }
+}
+#endif
+
+int mf_collect_net(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    struct mf_rate_sample *samples;
+    struct mf_rate_sample *cur;
+    struct mf_rate_row rows[MF_RATE_SHOWN];
+    static const unsigned int weighted[] = { 0U, 1U };
+    char *text;
+    char *cursor;
+    char *line;
+    uint64_t age;
+    size_t n;
+    size_t i;
+    struct mf_fmt f;
+
+    /* Hosts with hundreds of veth pairs make this file tens of KiB. */
+    text = mf_read_file_alloc(MF_PATH_NET_DEV, NULL);
+    if (text == NULL) {
+        return -1;
+    }
+    samples = (struct mf_rate_sample *)malloc(2U * sizeof(struct mf_rate_sample));
+    if (samples == NULL) {
+        free(text);
+        return -1;
+    }
+    cur = &samples[1];
+    cur->magic = MF_RATE_MAGIC;
+    cur->count = 0U;
+    cur->stamp_ns = mf_rate_now_ns();
+
+    cursor = text;
+    while ((line = mf_next_line(&cursor)) != NULL && cur->count < MF_RATE_MAX_DEVICES) {
+        char *colon;
+        char *name;
+        const char *p;
+        uint64_t skip;
+        unsigned int k;
+
+        colon = strchr(line, ':');
+        if (colon == NULL) {
+            continue; /* the two header lines */
+        }
+        *colon = '\0';
+        name = line;
+        while (*name == ' ') {
+            name++;
+        }
+        /* Rejected by name before any counter is parsed. */
+        if (mf_rate_has_prefix(name, g_net_virtual, sizeof(g_net_virtual) / sizeof(g_net_virtual[0]))) {
+            continue;
+        }
+
+        /* rx bytes is field 1, tx bytes field 9. */
+        p = mf_rate_skip_u64(colon + 1, &cur->e[cur->count].v[0]);
+        for (k = 0; k < 7U; ++k) {
+            p = mf_rate_skip_u64(p, &skip);
+        }
+        mf_rate_skip_u64(p, &cur->e[cur->count].v[1]);
+        cur->e[cur->count].v[2] = 0U;
+        cur->e[cur->count].v[3] = 0U;
+        mf_strlcpy(cur->e[cur->count].name, name, MF_RATE_NAME_MAX);
+        cur->count++;
+    }
+    free(text);
+
+    if (cur->count == 0U) {
+        free(samples);
+        return -1;
+    }
+
+    age = mf_rate_swap(MF_NET_STATE_NAME, &samples[0], cur);
+    n = mf_rate_rows(&samples[0], cur, age, weighted, 2U, rows);
+
+    mf_fmt_init(&f, out, outsz);
+    for (i = 0; i < n; ++i) {
+        mf_fmt_str(&f, i == 0U ? "" : ", ");
+        mf_fmt_str(&f, rows[i].name);
+        mf_fmt_str(&f, " rx ");
+        mf_rate_bytes(&f, rows[i].r[0], age != 0U);
+        mf_fmt_str(&f, " tx ");
+        mf_rate_bytes(&f, rows[i].r[1], age != 0U);
+    }
+    if (age == 0U) {
+        mf_fmt_str(&f, " (totals)");
+    }
+    free(samples);
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
+
+int mf_collect_diskio(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    struct mf_rate_sample *samples;
+    struct mf_rate_sample *cur;
+    struct mf_rate_row rows[MF_RATE_SHOWN];
+    static const unsigned int weighted[] = { 1U, 3U };
+    char disks[MF_RATE_MAX_DEVICES][MF_RATE_NAME_MAX];
+    size_t ndisks;
+    DIR *dir;
+    struct dirent *ent;
+    char *text;
+    char *cursor;
+    char *line;
+    uint64_t age;
+    size_t n;
+    size_t i;
+    struct mf_fmt f;
+
+    /* /sys/block lists whole disks only, which keeps partitions from
+     * being counted twice. */
+    dir = mf_opendir(MF_PATH_SYS_BLOCK);
+    if (dir == NULL) {
+        return -1;
+    }
+    ndisks = 0U;
+    while ((ent = readdir(dir)) != NULL && ndisks < MF_RATE_MAX_DEVICES) {
+        if (ent->d_name[0] == '.' ||
+            mf_rate_has_prefix(ent->d_name, g_block_virtual, sizeof(g_block_virtual) / sizeof(g_block_virtual[0]))) {
+            continue;
+        }
+        mf_strlcpy(disks[ndisks++], ent->d_name, MF_RATE_NAME_MAX);
+    }
+    closedir(dir);
+    if (ndisks == 0U) {
+        return -1;
+    }
+
+    text = mf_read_file_alloc(MF_PATH_DISKSTATS, NULL);
+    if (text == NULL) {
+        return -1;
+    }
+    samples = (struct mf_rate_sample *)malloc(2U * sizeof(struct mf_rate_sample));
+    if (samples == NULL) {
+        free(text);
+        return -1;
+    }
+    cur = &samples[1];
+    cur->magic = MF_RATE_MAGIC;
+    cur->count = 0U;
+    cur->stamp_ns = mf_rate_now_ns();
+
+    cursor = text;
+    while ((line = mf_next_line(&cursor)) != NULL && cur->count < MF_RATE_MAX_DEVICES) {
+        struct mf_rate_entry *e;
+        const char *p;
+        const char *name;
+        size_t name_len;
+        uint64_t skip;
+        size_t d;
+
+        /* "major minor name reads merged sectors ms writes merged sectors" */
+        p = mf_rate_skip_u64(line, &skip);
+        p = mf_rate_skip_u64(p, &skip);
+        while (*p == ' ') {
+            p++;
+        }
+        name = p;
+        while (*p != ' ' && *p != '\0') {
+            p++;
+        }
+        name_len = (size_t)(p - name);
+
+        for (d = 0; d < ndisks; ++d) {
+            if (strncmp(disks[d], name, name_len) == 0 && disks[d][name_len] == '\0') {
+                break;
+            }
+        }
+        if (d == ndisks || name_len >= MF_RATE_NAME_MAX) {
+            continue;
+        }
+
+        e = &cur->e[cur->count];
+        memcpy(e->name, name, name_len);
+        e->name[name_len] = '\0';
+        p = mf_rate_skip_u64(p, &e->v[0]);
+        p = mf_rate_skip_u64(p, &skip);
+        p = mf_rate_skip_u64(p, &e->v[1]);
+        p = mf_rate_skip_u64(p, &skip);
+        p = mf_rate_skip_u64(p, &e->v[2]);
+        p = mf_rate_skip_u64(p, &skip);
+        mf_rate_skip_u64(p, &e->v[3]);
+        cur->count++;
+    }
+    free(text);
+
+    if (cur->count == 0U) {
+        free(samples);
+        return -1;
+    }
+
+    age = mf_rate_swap(MF_DISKIO_STATE_NAME, &samples[0], cur);
+    n = mf_rate_rows(&samples[0], cur, age, weighted, 2U, rows);
+
+    mf_fmt_init(&f, out, outsz);
+    for (i = 0; i < n; ++i) {
+        mf_fmt_str(&f, i == 0U ? "" : ", ");
+        mf_fmt_str(&f, rows[i].name);
+        if (age != 0U) {
+            mf_fmt_str(&f, " r ");
+            mf_fmt_uint(&f, rows[i].r[0]);
+            mf_fmt_str(&f, "/s ");
+            mf_rate_bytes(&f, rows[i].r[1] * 512U, 1);
+            mf_fmt_str(&f, " w ");
+            mf_fmt_uint(&f, rows[i].r[2]);
+            mf_fmt_str(&f, "/s ");
+            mf_rate_bytes(&f, rows[i].r[3] * 512U, 1);
+        } else {
+            /* Sectors in diskstats are always 512 bytes. */
+            mf_fmt_str(&f, " read ");
+            mf_rate_bytes(&f, rows[i].r[1] * 512U, 0);
+            mf_fmt_str(&f, " written ");
+            mf_rate_bytes(&f, rows[i].r[3] * 512U, 0);
+        }
+    }
+    if (age == 0U) {
+        mf_fmt_str(&f, " (totals)");
+    }
+    free(samples);
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
@@ -0,0 +1,313 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "compat.h"
+#include "fileio.h"
+#include "fmt.h"
+#include "state.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <dirent.h>
+
+#define MF_SENSOR_MAGIC 0x3153464dU /* "MFS1" */
+#define MF_SENSOR_MAX 16U
+#define MF_SENSOR_PATH_MAX 80U
+#define MF_SENSOR_LABEL_MAX 16U
+#define MF_SENSOR_BOOT_ID_MAX 40U
+
+enum mf_sensor_kind {
+    MF_SENSOR_TEMP = 0,
+    MF_SENSOR_FAN = 1
+};
+
+struct mf_sensor {
+    uint32_t kind;
+    char label[MF_SENSOR_LABEL_MAX];
+    char path[MF_SENSOR_PATH_MAX];
+};
+
+/* The resolved sensor files, saved through the state module so later
+ * runs skip the sysfs walk. hwmonN numbering is assigned at probe time,
+ * so the list is only valid for the boot it was found in. An empty list
+ * is cached too: hosts without sensors should not rescan every run. */
+struct mf_sensor_cache {
+    uint32_t magic;
+    uint32_t count;
+    char boot_id[MF_SENSOR_BOOT_ID_MAX];
+    struct mf_sensor s[MF_SENSOR_MAX];
+};
+
+/* Thermal zone types that track the CPU package; used only when no
+ * hwmon chip reports one. */
+static const char *const g_zone_cpu[] = { "x86_pkg_temp", "cpu", "soc", "pkg" };
+
+static size_t mf_sensor_cache_size(uint32_t count)
+{
+    return offsetof(struct mf_sensor_cache, s) + (size_t)count * sizeof(struct mf_sensor);
+}
+
+/* Reads a one-line sysfs attribute and strips the newline. */
+static int mf_sensor_read_line(const char *path, char *buf, size_t bufsz)
+{
+    long n;
+
+    n = mf_read_file(path, buf, bufsz);
+    if (n <= 0) {
+        return -1;
+    }
+    if (buf[n - 1] == '\n') {
+        buf[n - 1] = '\0';
+    }
+    return 0;
+}
+
+static void mf_sensor_path(char *dst, const char *dir, const char *name, const char *leaf)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, dst, MF_SENSOR_PATH_MAX);
+    mf_fmt_str(&f, dir);
+    mf_fmt_str(&f, "/");
+    mf_fmt_str(&f, name);
+    if (leaf != NULL) {
+        mf_fmt_str(&f, "/");
+        mf_fmt_str(&f, leaf);
+    }
+}
+
+static void mf_sensor_add(struct mf_sensor_cache *c, uint32_t kind, const char *label, const char *path)
+{
+    struct mf_sensor *s;
+
+    if (c->count >= MF_SENSOR_MAX || strlen(path) >= MF_SENSOR_PATH_MAX - 1U) {
+        return;
+    }
+    s = &c->s[c->count++];
+    s->kind = kind;
+    mf_strlcpy(s->label, label, sizeof(s->label));
+    mf_strlcpy(s->path, path, sizeof(s->path));
+}
+
+/* Picks the package temperatures and every fan of one hwmon chip.
+ * coretemp reports one "Package id N" per socket next to per-core
+ * inputs; k10temp reports the control temperature as "Tctl". */
+static void mf_sensor_scan_chip(struct mf_sensor_cache *c, const char *chip_dir)
+{
+    char path[MF_SENSOR_PATH_MAX];
+    char chip[32];
+    char label[32];
+    char short_label[MF_SENSOR_LABEL_MAX];
+    struct dirent *ent;
+    DIR *dir;
+
+    mf_sensor_path(path, chip_dir, "name", NULL);
+    if (mf_sensor_read_line(path, chip, sizeof(chip)) != 0) {
+        return;
+    }
+    dir = mf_opendir(chip_dir);
+    if (dir == NULL) {
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        const char *name = ent->d_name;
+        const char *suffix = strstr(name, "_input");
+        size_t stem;
+
+        if (suffix == NULL || suffix[6] != '\0') {
+            continue;
+        }
+        stem = (size_t)(suffix - name);
+        if (stem >= sizeof(label) - 6U) {
+            continue;
+        }
+        /* tempN_label / fanN_label sit next to the input. */
+        memcpy(label, name, stem);
+        mf_strlcpy(label + stem, "_label", sizeof(label) - stem);
+        mf_sensor_path(path, chip_dir, label, NULL);
+        if (mf_sensor_read_line(path, label, sizeof(label)) != 0) {
+            memcpy(label, name, stem);
+            label[stem] = '\0';
+        }
+        mf_sensor_path(path, chip_dir, name, NULL);
+
+        if (strncmp(name, "fan", 3) == 0) {
+            mf_sensor_add(c, MF_SENSOR_FAN, label, path);
+        } else if (strncmp(name, "temp", 4) == 0) {
+            if (strncmp(label, "Package id ", 11) == 0) {
+                struct mf_fmt f;
+
+                mf_fmt_init(&f, short_label, sizeof(short_label));
+                mf_fmt_str(&f, "pkg");
+                mf_fmt_str(&f, label + 11);
+                mf_sensor_add(c, MF_SENSOR_TEMP, short_label, path);
+            } else if (strcmp(label, "Tctl") == 0) {
+                mf_sensor_add(c, MF_SENSOR_TEMP, label, path);
+            } else if (strcmp(chip, "cpu_thermal") == 0 || strcmp(chip, "cpu-thermal") == 0) {
+                mf_sensor_add(c, MF_SENSOR_TEMP, "cpu", path);
+            }
+        }
+    }
+    closedir(dir);
+}
+
+static int mf_sensor_cmp(const void *a, const void *b)
+{
+    const struct mf_sensor *x = (const struct mf_sensor *)a;
+    const struct mf_sensor *y = (const struct mf_sensor *)b;
+
+    if (x->kind != y->kind) {
+        return x->kind < y->kind ? -1 : 1;
+    }
+    return strcmp(x->label, y->label);
+}
+
+static void mf_sensor_scan(struct mf_sensor_cache *c)
+{
+    char path[MF_SENSOR_PATH_MAX];
+    char type[32];
+    struct dirent *ent;
+    uint32_t i;
+    int have_temp;
+    DIR *dir;
+
+    c->count = 0U;
+    dir = mf_opendir(MF_PATH_HWMON);
+    if (dir != NULL) {
+        while ((ent = readdir(dir)) != NULL) {
+            if (strncmp(ent->d_name, "hwmon", 5) != 0) {
+                continue;
+            }
+            mf_sensor_path(path, MF_PATH_HWMON, ent->d_name, NULL);
+            mf_sensor_scan_chip(c, path);
+        }
+        closedir(dir);
+    }
+
+    have_temp = 0;
+    for (i = 0; i < c->count; ++i) {
+        have_temp |= c->s[i].kind == MF_SENSOR_TEMP;
+    }
+    dir = have_temp ? NULL : mf_opendir(MF_PATH_THERMAL);
+    if (dir != NULL) {
+        while ((ent = readdir(dir)) != NULL) {
+            size_t k;
+
+            if (strncmp(ent->d_name, "thermal_zone", 12) != 0) {
+                continue;
+            }
+            mf_sensor_path(path, MF_PATH_THERMAL, ent->d_name, "type");
+            if (mf_sensor_read_line(path, type, sizeof(type)) != 0) {
+                continue;
+            }
+            for (k = 0; k < sizeof(g_zone_cpu) / sizeof(g_zone_cpu[0]); ++k) {
+                if (strstr(type, g_zone_cpu[k]) != NULL) {
+                    mf_sensor_path(path, MF_PATH_THERMAL, ent->d_name, "temp");
+                    mf_sensor_add(c, MF_SENSOR_TEMP, type, path);
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+    }
+
+    qsort(c->s, c->count, sizeof(c->s[0]), mf_sensor_cmp);
+}
+
+/* Reads every cached sensor into values; -1 as soon as one is gone. */
+static int mf_sensor_read_all(const struct mf_sensor_cache *c, int64_t *values)
+{
+    char buf[32];
+    uint32_t i;
+
+    for (i = 0; i < c->count; ++i) {
+        const char *p = buf;
+        uint64_t v;
+
+        if (mf_read_file(c->s[i].path, buf, sizeof(buf)) <= 0) {
+            return -1;
+        }
+        if (*p == '-') {
+            p++;
+        }
+        if (mf_parse_u64(p, &v) == 0U) {
+            return -1;
+        }
+        values[i] = p == buf ? (int64_t)v : -(int64_t)v;
+    }
+    return 0;
+}
+#endif
+
+int mf_collect_sensors(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    struct mf_sensor_cache cache;
+    int64_t values[MF_SENSOR_MAX];
+    char boot_id[MF_SENSOR_BOOT_ID_MAX];
+    long len;
+    uint32_t i;
+    uint32_t fans;
+    int fresh;
+    struct mf_fmt f;
+
+    if (mf_sensor_read_line(MF_PATH_BOOT_ID, boot_id, sizeof(boot_id)) != 0) {
+        boot_id[0] = '\0';
+    }
+
+    fresh = 0;
+    len = mf_state_load(MF_SENSORS_STATE_NAME, &cache, sizeof(cache));
+    if (len < (long)mf_sensor_cache_size(0U) || cache.magic != MF_SENSOR_MAGIC || cache.count > MF_SENSOR_MAX ||
+        len != (long)mf_sensor_cache_size(cache.count) || boot_id[0] == '\0' ||
+        strncmp(cache.boot_id, boot_id, sizeof(cache.boot_id)) != 0 || mf_sensor_read_all(&cache, values) != 0) {
+        memset(&cache, 0, sizeof(cache));
+        cache.magic = MF_SENSOR_MAGIC;
+        mf_strlcpy(cache.boot_id, boot_id, sizeof(cache.boot_id));
+        mf_sensor_scan(&cache);
+        fresh = 1;
+        if (mf_sensor_read_all(&cache, values) != 0) {
+            /* A sensor vanished mid-scan; do not cache a bad list. */
+            return -1;
+        }
+    }
+    if (fresh && boot_id[0] != '\0') {
+        mf_state_store(MF_SENSORS_STATE_NAME, &cache, mf_sensor_cache_size(cache.count));
+    }
+    if (cache.count == 0U) {
+        return -1;
+    }
+
+    mf_fmt_init(&f, out, outsz);
+    fans = 0U;
+    for (i = 0; i < cache.count; ++i) {
+        if (cache.s[i].kind == MF_SENSOR_FAN) {
+            mf_fmt_str(&f, i == 0U ? "" : (fans == 0U ? "; " : ", "));
+            mf_fmt_str(&f, cache.s[i].label);
+            mf_fmt_str(&f, " ");
+            mf_fmt_uint(&f, (uint64_t)values[i]);
+            mf_fmt_str(&f, " RPM");
+            fans++;
+            continue;
+        }
+        mf_fmt_str(&f, i == 0U ? "" : ", ");
+        mf_fmt_str(&f, cache.s[i].label);
+        mf_fmt_str(&f, " ");
+        if (values[i] < 0) {
+            mf_fmt_str(&f, "-");
+            values[i] = -values[i];
+        }
+        /* sysfs temperatures are in millidegrees Celsius. */
+        mf_fmt_uint(&f, (uint64_t)values[i] / 1000U);
+        mf_fmt_str(&f, "\xc2\xb0" "C");
+    }
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
@@ -0,0 +1,389 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+
+#include "linux_extras.h"
+#include "fileio.h"
+#include "fmt.h"
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MF_TOPO_MAX_CPUS 8192U
+#define MF_TOPO_WORDS (MF_TOPO_MAX_CPUS / 64U)
+#define MF_TOPO_MAX_INDEX 8U
+#define MF_TOPO_MAX_KINDS 12U
+#define MF_TOPO_MAX_NODES_SHOWN 4U
+
+struct mf_topo_cpuset {
+    uint64_t bits[MF_TOPO_WORDS];
+};
+
+/* One distinct cache: level, type and size, plus how many instances
+ * (sets of CPUs sharing it) were seen. */
+struct mf_topo_cache {
+    unsigned int level;
+    char type;
+    uint64_t kib;
+    unsigned int instances;
+};
+
+static int mf_topo_test(const struct mf_topo_cpuset *set, unsigned int cpu)
+{
+    return (set->bits[cpu / 64U] >> (cpu % 64U)) & 1U;
+}
+
+/* Parses a CPU list such as "0-63,128-191" into set (ORing). Returns the
+ * number of CPUs named. */
+static unsigned int mf_topo_parse_list(const char *list, struct mf_topo_cpuset *set)
+{
+    const char *p;
+    unsigned int count;
+
+    count = 0U;
+    p = list;
+    while (*p >= '0' && *p <= '9') {
+        uint64_t lo;
+        uint64_t hi;
+        uint64_t c;
+
+        p += mf_parse_u64(p, &lo);
+        hi = lo;
+        if (*p == '-') {
+            p++;
+            p += mf_parse_u64(p, &hi);
+        }
+        if (hi >= MF_TOPO_MAX_CPUS) {
+            hi = MF_TOPO_MAX_CPUS - 1U;
+        }
+        for (c = lo; c <= hi; ++c) {
+            set->bits[c / 64U] |= (uint64_t)1U << (c % 64U);
+            count++;
+        }
+        if (*p != ',') {
+            break;
+        }
+        p++;
+    }
+    return count;
+}
+
+/* sysfs attributes come from a single show() call, so one read(2) returns
+ * the whole value; skipping the read that would only report EOF halves
+ * the syscalls of a cache walk. */
+static long mf_topo_read(int dirfd, const char *path, char *buf, size_t bufsz)
+{
+    int fd;
+    ssize_t n;
+
+    fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    do {
+        n = read(fd, buf, bufsz - 1U);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return (long)n;
+}
+
+static int mf_topo_open_dir(int dirfd, const char *name)
+{
+    return openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/* "nodeN" without snprintf. */
+static void mf_topo_name(char *out, size_t outsz, const char *prefix, unsigned int n)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_str(&f, prefix);
+    mf_fmt_uint(&f, n);
+}
+
+/* "cpuN/cache/indexI/<leaf>", opened relative to the cpu directory fd so
+ * each read is a single openat with no intermediate directory fds. */
+static void mf_topo_index_path(char *out, size_t outsz, unsigned int cpu, unsigned int index, const char *leaf)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_str(&f, "cpu");
+    mf_fmt_uint(&f, cpu);
+    mf_fmt_str(&f, "/cache/index");
+    mf_fmt_uint(&f, index);
+    mf_fmt_str(&f, "/");
+    mf_fmt_str(&f, leaf);
+}
+
+static void mf_topo_strip(char *s)
+{
+    size_t len = strlen(s);
+
+    while (len > 0U && (s[len - 1U] == '\n' || s[len - 1U] == ' ')) {
+        s[--len] = '\0';
+    }
+}
+
+/* "48K" style, as sysfs prints cache sizes, scaled to M where exact. */
+static void mf_topo_fmt_kib(struct mf_fmt *f, uint64_t kib)
+{
+    if (kib >= 1024U && kib % 1024U == 0U) {
+        mf_fmt_uint(f, kib / 1024U);
+        mf_fmt_str(f, "M");
+    } else {
+        mf_fmt_uint(f, kib);
+        mf_fmt_str(f, "K");
+    }
+}
+
+static void mf_topo_nodes(struct mf_fmt *f, int sysfd)
+{
+    struct mf_topo_cpuset online;
+    char data[256];
+    unsigned int count;
+    unsigned int shown;
+    unsigned int node;
+    int nodefd;
+
+    nodefd = mf_topo_open_dir(sysfd, "node");
+    if (nodefd < 0) {
+        return;
+    }
+    memset(&online, 0, sizeof(online));
+    if (mf_topo_read(nodefd, "online", data, sizeof(data)) <= 0) {
+        close(nodefd);
+        return;
+    }
+    count = mf_topo_parse_list(data, &online);
+    if (count == 0U) {
+        close(nodefd);
+        return;
+    }
+
+    mf_fmt_uint(f, count);
+    mf_fmt_str(f, count == 1U ? " node" : " nodes");
+    shown = 0U;
+    for (node = 0; node < MF_TOPO_MAX_CPUS && shown < count; ++node) {
+        char name[32];
+        int fd;
+        uint64_t kib;
+        const char *p;
+
+        if (!mf_topo_test(&online, node)) {
+            continue;
+        }
+        if (shown == MF_TOPO_MAX_NODES_SHOWN) {
+            mf_fmt_str(f, "; ...");
+            break;
+        }
+        mf_fmt_str(f, shown == 0U ? " (" : "; ");
+        shown++;
+
+        mf_topo_name(name, sizeof(name), "node", node);
+        fd = mf_topo_open_dir(nodefd, name);
+        if (fd < 0) {
+            continue;
+        }
+        mf_fmt_uint(f, node);
+        mf_fmt_str(f, ": ");
+        if (mf_topo_read(fd, "cpulist", data, sizeof(data)) > 0) {
+            mf_topo_strip(data);
+            mf_fmt_str(f, data[0] != '\0' ? data : "no cpus");
+        }
+        /* The first meminfo line is "Node N MemTotal:   X kB". */
+        if (mf_topo_read(fd, "meminfo", data, sizeof(data)) > 0) {
+            p = strstr(data, "MemTotal:");
+            if (p != NULL) {
+                p += 9;
+                while (*p == ' ') {
+                    p++;
+                }
+                if (mf_parse_u64(p, &kib) > 0U) {
+                    mf_fmt_str(f, ", ");
+                    mf_fmt_bytes(f, kib * 1024U);
+                }
+            }
+        }
+        close(fd);
+    }
+    if (shown > 0U) {
+        mf_fmt_str(f, ")");
+    }
+    close(nodefd);
+}
+
+static void mf_topo_smt(struct mf_fmt *f, int cpufd)
+{
+    char data[16];
+
+    if (mf_topo_read(cpufd, "smt/active", data, sizeof(data)) <= 0) {
+        return;
+    }
+    mf_fmt_str(f, data[0] == '1' ? "; SMT on" : "; SMT off");
+}
+
+static void mf_topo_record(struct mf_topo_cache *kinds, unsigned int *nkinds, unsigned int level, char type, uint64_t kib)
+{
+    unsigned int k;
+
+    for (k = 0; k < *nkinds; ++k) {
+        if (kinds[k].level == level && kinds[k].type == type && kinds[k].kib == kib) {
+            kinds[k].instances++;
+            return;
+        }
+    }
+    if (*nkinds < MF_TOPO_MAX_KINDS) {
+        kinds[*nkinds].level = level;
+        kinds[*nkinds].type = type;
+        kinds[*nkinds].kib = kib;
+        kinds[*nkinds].instances = 1U;
+        (*nkinds)++;
+    }
+}
+
+/* Visits each cache instance once. Per index a bitmap records the CPUs
+ * already covered by some instance's shared_cpu_list, so only the first
+ * CPU of each sharing set is read; level and type are read once per
+ * index since the index layout is the same on every CPU. */
+static void mf_topo_caches(struct mf_fmt *f, int cpufd)
+{
+    struct mf_topo_cpuset covered[MF_TOPO_MAX_INDEX]; /* 8 KiB, fine on any thread's stack */
+    struct mf_topo_cpuset online;
+    struct mf_topo_cache kinds[MF_TOPO_MAX_KINDS];
+    unsigned int level[MF_TOPO_MAX_INDEX];
+    char type[MF_TOPO_MAX_INDEX];
+    unsigned int nindex;
+    unsigned int nkinds;
+    unsigned int cpu;
+    unsigned int i;
+    unsigned int k;
+    char data[256];
+
+    memset(&online, 0, sizeof(online));
+    if (mf_topo_read(cpufd, "online", data, sizeof(data)) <= 0 || mf_topo_parse_list(data, &online) == 0U) {
+        return;
+    }
+    memset(covered, 0, sizeof(covered));
+
+    nindex = 0U;
+    nkinds = 0U;
+    for (cpu = 0; cpu < MF_TOPO_MAX_CPUS; ++cpu) {
+        char path[64];
+        int pending;
+
+        if ((cpu % 64U) == 0U && online.bits[cpu / 64U] == 0U) {
+            cpu += 63U;
+            continue;
+        }
+        if (!mf_topo_test(&online, cpu)) {
+            continue;
+        }
+
+        pending = nindex == 0U;
+        for (i = 0; i < nindex; ++i) {
+            if (!mf_topo_test(&covered[i], cpu)) {
+                pending = 1;
+                break;
+            }
+        }
+        if (!pending) {
+            continue;
+        }
+
+        if (nindex == 0U) {
+            /* Index layout (level and type) from the first CPU. */
+            for (i = 0; i < MF_TOPO_MAX_INDEX; ++i) {
+                mf_topo_index_path(path, sizeof(path), cpu, i, "level");
+                if (mf_topo_read(cpufd, path, data, sizeof(data)) <= 0) {
+                    break;
+                }
+                level[i] = (unsigned int)(data[0] - '0');
+                type[i] = 'u';
+                mf_topo_index_path(path, sizeof(path), cpu, i, "type");
+                if (mf_topo_read(cpufd, path, data, sizeof(data)) > 0) {
+                    type[i] = data[0] == 'D' ? 'd' : (data[0] == 'I' ? 'i' : 'u');
+                }
+            }
+            nindex = i;
+            if (nindex == 0U) {
+                break;
+            }
+        }
+
+        for (i = 0; i < nindex; ++i) {
+            uint64_t kib;
+
+            if (mf_topo_test(&covered[i], cpu)) {
+                continue;
+            }
+            mf_topo_index_path(path, sizeof(path), cpu, i, "shared_cpu_list");
+            if (mf_topo_read(cpufd, path, data, sizeof(data)) <= 0 ||
+                mf_topo_parse_list(data, &covered[i]) == 0U) {
+                covered[i].bits[cpu / 64U] |= (uint64_t)1U << (cpu % 64U);
+            }
+            mf_topo_index_path(path, sizeof(path), cpu, i, "size");
+            if (mf_topo_read(cpufd, path, data, sizeof(data)) > 0 && mf_parse_u64(data, &kib) > 0U) {
+                mf_topo_record(kinds, &nkinds, level[i], type[i], kib);
+            }
+        }
+    }
+
+    for (k = 0; k < nkinds; ++k) {
+        mf_fmt_str(f, k == 0U ? "; " : ", ");
+        mf_fmt_str(f, "L");
+        mf_fmt_uint(f, kinds[k].level);
+        if (kinds[k].type != 'u') {
+            char t[2];
+
+            t[0] = kinds[k].type;
+            t[1] = '\0';
+            mf_fmt_str(f, t);
+        }
+        mf_fmt_str(f, " ");
+        mf_topo_fmt_kib(f, kinds[k].kib);
+        mf_fmt_str(f, " x");
+        mf_fmt_uint(f, kinds[k].instances);
+    }
+}
+#endif
+
+int mf_collect_topology(char *out, size_t outsz)
+{
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+    struct mf_fmt f;
+    int sysfd;
+    int cpufd;
+
+    sysfd = mf_open_dir(MF_PATH_SYS_SYSTEM);
+    if (sysfd < 0) {
+        return -1;
+    }
+    cpufd = mf_topo_open_dir(sysfd, "cpu");
+
+    mf_fmt_init(&f, out, outsz);
+    mf_topo_nodes(&f, sysfd);
+    if (f.len == 0U) {
+        mf_fmt_str(&f, "no NUMA");
+    }
+    if (cpufd >= 0) {
+        mf_topo_smt(&f, cpufd);
+        mf_topo_caches(&f, cpufd);
+        close(cpufd);
+    }
+    close(sysfd);
+    return 0;
+#else
+    (void)out;
+    (void)outsz;
+    return -1;
+#endif
+}
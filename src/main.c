@@ -1,8 +1,10 @@
 #define _POSIX_C_SOURCE 200809L
 
-#include <stdio.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "config.h"
 #include "cli.h"
@@ -12,24 +14,61 @@
 #include "logo.h"
 #include "term.h"
 #include "hidden.h"
+#include "outbuf.h"
+#include "fileio.h"
+#include "state.h"
+#include "fleet.h"
+#include "termcaps.h"
+#include "userconf.h"
+#if !defined(MINIFETCH_TINY)
+#include <signal.h>
+
+#include "snapshot.h"
+#endif
 
 #define MF_ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
 
+/* Stack arena for the static table; large enough that a normal run
+ * reaches stdout in a single write(2). */
+#define MF_RENDER_ARENA 16384
+
 struct mf_field {
+    const char *name; /* as a config file names it */
     const char *label;
     int (*collector)(char *out, size_t outsz);
     int enabled_default;
+    const char *file; /* read by the collector; batched up front */
+    unsigned int refresh; /* seconds between collections under --daemon */
+    unsigned int flags;   /* MF_FIELD_* */
 };
 
+/* Also shown, whatever the defaults and config say, when one of the
+ * field's own options (--mounts, --mount-filter) was given. */
+#define MF_FIELD_OPT_IN 0x01U
+
+#if defined(__linux__) && defined(MINIFETCH_LINUX_EXT)
+#define MF_FILE_LINUX(path) path
+#else
+#define MF_FILE_LINUX(path) NULL
+#endif
+
 static const struct mf_field g_fields[] = {
-    { "OS:",     mf_collect_os,     CFG_SHOW_OS },
-    { "Kernel:", mf_collect_kernel, CFG_SHOW_KERNEL },
-    { "Host:",   mf_collect_host,   CFG_SHOW_HOST },
-    { "CPU:",    mf_collect_cpu,    CFG_SHOW_CPU },
-    { "Shell:",  mf_collect_shell,  CFG_SHOW_SHELL },
-    { "Disk:",   mf_collect_disk,   CFG_SHOW_DISK },
-    { "Memory:", mf_collect_mem,    CFG_SHOW_MEM },
-    { "Uptime:", mf_collect_uptime, CFG_SHOW_UPTIME }
+    { "os", "OS:",     mf_collect_os,     CFG_SHOW_OS,     MF_FILE_LINUX(MF_PATH_OS_RELEASE), 60, 0 },
+    { "kernel", "Kernel:", mf_collect_kernel, CFG_SHOW_KERNEL, NULL, 60, 0 },
+    { "host", "Host:",   mf_collect_host,   CFG_SHOW_HOST,   MF_PATH_HOSTNAME, 60, 0 },
+    { "cpu", "CPU:",    mf_collect_cpu,    CFG_SHOW_CPU,    NULL, 60, 0 },
+    { "load", "Load:",   mf_collect_load,   CFG_SHOW_LOAD,   NULL, 2, 0 },
+    { "topology", "Topology:", mf_collect_topology, CFG_SHOW_TOPOLOGY, NULL, 60, 0 },
+    { "shell", "Shell:",  mf_collect_shell,  CFG_SHOW_SHELL,  NULL, 60, 0 },
+    { "disk", "Disk:",   mf_collect_disk,   CFG_SHOW_DISK,   NULL, 10, 0 },
+    { "diskio", "Disk I/O:", mf_collect_diskio, CFG_SHOW_DISKIO, NULL, 2, 0 },
+    { "net", "Net:",    mf_collect_net,    CFG_SHOW_NET,    NULL, 2, 0 },
+    { "memory", "Memory:", mf_collect_mem,    CFG_SHOW_MEM,    MF_FILE_LINUX(MF_PATH_MEMINFO), 2, 0 },
+    { "uptime", "Uptime:", mf_collect_uptime, CFG_SHOW_UPTIME, MF_FILE_LINUX(MF_PATH_UPTIME), 1, 0 },
+    { "sensors", "Sensors:", mf_collect_sensors, CFG_SHOW_SENSORS, NULL, 2, 0 },
+    { "procs", "Procs:",  mf_collect_procs,  CFG_SHOW_PROCS,  NULL, 5, 0 },
+    { "pressure", "Pressure:", mf_collect_pressure, CFG_SHOW_PRESSURE, NULL, 2, 0 },
+    { "mounts", "Mounts:", mf_collect_mounts, CFG_SHOW_MOUNTS, NULL, 30, MF_FIELD_OPT_IN }
 };
 
 struct mf_render_line {
@@ -37,21 +76,464 @@ struct mf_render_line {
     char value[256];
 };
 
+struct mf_palette {
+    struct mf_span label;
+    struct mf_span value;
+    struct mf_span reset;
+};
+
+static struct mf_palette g_palette_colour = {
+    MF_SPAN_LIT(CFG_LABEL_COLOR),
+    MF_SPAN_LIT(CFG_VALUE_COLOR),
+    MF_SPAN_LIT(CFG_RESET_COLOR)
+};
+
+static const struct mf_palette g_palette_plain = {
+    MF_SPAN_LIT(""),
+    MF_SPAN_LIT(""),
+    MF_SPAN_LIT("")
+};
+
+/* The field table as this run uses it: display order, the fields shown
+ * without -a, labels and the label column. A config file (userconf.h)
+ * may change any of them; otherwise they are the compiled-in ones. */
+static unsigned char g_order[MF_ARRAY_LEN(g_fields)];
+static unsigned char g_shown[MF_ARRAY_LEN(g_fields)];
+static const char *g_labels[MF_ARRAY_LEN(g_fields)];
+static size_t g_label_width = CFG_LABEL_WIDTH;
+
+/* Applies the config file, if any, to the field table, the palette and
+ * the hidden-mode defaults in opts. Fields it leaves out still show
+ * with -a, after the ones it lists. */
+static void mf_load_userconf(struct mf_options *opts)
+{
+    const char *names[MF_ARRAY_LEN(g_fields)];
+    const struct mf_userconf *conf;
+    size_t n;
+    size_t i;
+
+    for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
+        names[i] = g_fields[i].name;
+    }
+    conf = mf_userconf_load(names, MF_ARRAY_LEN(g_fields));
+
+    n = 0U;
+    if (conf != NULL && (conf->has & MF_USERCONF_HAS_FIELDS) != 0U) {
+        for (i = 0; i < conf->field_count; ++i) {
+            g_order[n++] = conf->field[i];
+            g_shown[conf->field[i]] = 1U;
+        }
+    }
+    for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
+        if (conf == NULL || (conf->has & MF_USERCONF_HAS_FIELDS) == 0U) {
+            g_shown[i] = (unsigned char)(g_fields[i].enabled_default != 0);
+            g_order[n++] = (unsigned char)i;
+        } else if (!g_shown[i]) {
+            g_order[n++] = (unsigned char)i;
+        }
+        g_labels[i] = conf != NULL && conf->label[i][0] != '\0' ? conf->label[i] : g_fields[i].label;
+    }
+    if (conf == NULL) {
+        return;
+    }
+
+    if ((conf->has & MF_USERCONF_HAS_WIDTH) != 0U) {
+        g_label_width = conf->label_width;
+    }
+    if ((conf->has & MF_USERCONF_HAS_LABEL_COLOUR) != 0U) {
+        g_palette_colour.label.ptr = conf->label_colour;
+        g_palette_colour.label.len = strlen(conf->label_colour);
+    }
+    if ((conf->has & MF_USERCONF_HAS_VALUE_COLOUR) != 0U) {
+        g_palette_colour.value.ptr = conf->value_colour;
+        g_palette_colour.value.len = strlen(conf->value_colour);
+    }
+    if ((conf->has & MF_USERCONF_HAS_SEED) != 0U) {
+        opts->seed = conf->seed;
+    }
+    if ((conf->has & MF_USERCONF_HAS_GRADIENT) != 0U) {
+        opts->gradient = (int)conf->gradient;
+    }
+    if ((conf->has & MF_USERCONF_HAS_ENGINE) != 0U) {
+        opts->engine = conf->engine;
+    }
+    if ((conf->has & MF_USERCONF_HAS_REFRESH) != 0U) {
+        opts->refresh = conf->refresh;
+    }
+}
+
+static size_t mf_label_pad(size_t label_len)
+{
+    if (label_len >= g_label_width) {
+        return 0U;
+    }
+    return g_label_width - label_len;
+}
+
+static void mf_emit_field(struct mf_outbuf *ob, const struct mf_render_line *line, const struct mf_palette *pal, int quiet)
+{
+    size_t label_len;
+
+    if (quiet) {
+        mf_outbuf_puts(ob, line->value);
+        return;
+    }
+
+    label_len = strlen(line->label);
+    mf_outbuf_span(ob, &pal->label);
+    mf_outbuf_put(ob, line->label, label_len);
+    mf_outbuf_fill(ob, ' ', mf_label_pad(label_len));
+    mf_outbuf_span(ob, &pal->reset);
+    mf_outbuf_fill(ob, ' ', 1U);
+    mf_outbuf_span(ob, &pal->value);
+    mf_outbuf_puts(ob, line->value);
+    mf_outbuf_span(ob, &pal->reset);
+}
+
+#if !defined(MINIFETCH_TINY)
+/* Bounded append used to build the rows handed to hidden mode. */
+static void mf_row_append(char *dst, size_t *len, const char *src, size_t n)
+{
+    size_t room;
+
+    room = MF_FORMATTED_LINE_MAX - 1U - *len;
+    if (n > room) {
+        n = room;
+    }
+    memcpy(dst + *len, src, n);
+    *len += n;
+    dst[*len] = '\0';
+}
+
+static void mf_format_row(char *dst, const struct mf_render_line *line, const struct mf_palette *pal, int quiet)
+{
+    size_t len;
+    size_t label_len;
+    size_t pad;
+
+    len = 0U;
+    dst[0] = '\0';
+
+    if (quiet) {
+        mf_row_append(dst, &len, line->value, strlen(line->value));
+        return;
+    }
+
+    label_len = strlen(line->label);
+    mf_row_append(dst, &len, pal->label.ptr, pal->label.len);
+    mf_row_append(dst, &len, line->label, label_len);
+    for (pad = mf_label_pad(label_len); pad > 0U; --pad) {
+        mf_row_append(dst, &len, " ", 1U);
+    }
+    mf_row_append(dst, &len, pal->reset.ptr, pal->reset.len);
+    mf_row_append(dst, &len, " ", 1U);
+    mf_row_append(dst, &len, pal->value.ptr, pal->value.len);
+    mf_row_append(dst, &len, line->value, strlen(line->value));
+    mf_row_append(dst, &len, pal->reset.ptr, pal->reset.len);
+}
+
+static void mf_format_hidden_rows(char formatted[][MF_FORMATTED_LINE_MAX], size_t widths[], const struct mf_render_line *lines,
+                                  size_t line_count, const struct mf_palette *pal, int quiet)
+{
+    size_t i;
+
+    for (i = 0; i < line_count; ++i) {
+        mf_format_row(formatted[i], &lines[i], pal, quiet);
+        widths[i] = mf_utf8_display_width(lines[i].value);
+        if (!quiet) {
+            widths[i] += g_label_width + 1U;
+        }
+    }
+}
+#endif
+
+static void mf_render_table(const struct mf_render_line *lines, size_t line_count, const struct mf_palette *pal, int quiet,
+                            const struct mf_span *prefix, const struct mf_span *suffix)
+{
+    char arena[MF_RENDER_ARENA];
+    struct mf_outbuf ob;
+    size_t rows;
+    size_t column_gap;
+    size_t i;
+
+    mf_outbuf_init(&ob, arena, sizeof(arena), STDOUT_FILENO);
+    if (prefix != NULL) {
+        mf_outbuf_span(&ob, prefix);
+    }
+
+    rows = line_count;
+    if (g_logo_line_count > rows) {
+        rows = g_logo_line_count;
+    }
+
+    column_gap = 0U;
+    if (line_count > 0 && g_logo_line_count > 0) {
+        column_gap = 2U;
+    }
+
+    for (i = 0; i < rows; ++i) {
+        size_t pad_spaces;
+
+        if (i < g_logo_line_count) {
+            const char *logo_line = g_logo_lines[i];
+            size_t logo_len = mf_utf8_display_width(logo_line);
+            mf_outbuf_puts(&ob, logo_line);
+            if (g_logo_width > logo_len) {
+                pad_spaces = g_logo_width - logo_len;
+            } else {
+                pad_spaces = 0U;
+            }
+        } else {
+            pad_spaces = g_logo_width;
+        }
+
+        if (i < line_count) {
+            mf_outbuf_fill(&ob, ' ', pad_spaces + column_gap);
+            mf_emit_field(&ob, &lines[i], pal, quiet);
+        } else {
+            mf_outbuf_fill(&ob, ' ', pad_spaces);
+        }
+
+        mf_outbuf_fill(&ob, '\n', 1U);
+    }
+    if (suffix != NULL) {
+        mf_outbuf_span(&ob, suffix);
+    }
+
+    mf_outbuf_flush(&ob);
+}
+
+static int mf_field_enabled(size_t i, const struct mf_options *opts)
+{
+    if ((g_fields[i].flags & MF_FIELD_OPT_IN) != 0U && opts->mounts_requested) {
+        return 1;
+    }
+    return g_shown[i] || opts->show_all;
+}
+
+/* Runs every enabled collector; returns the number of lines filled. */
+static size_t mf_collect_lines(struct mf_render_line *lines, const struct mf_options *opts)
+{
+    const char *files[MF_ARRAY_LEN(g_fields)];
+    size_t file_count;
+    size_t line_count;
+    size_t k;
+    size_t i;
+
+#if !defined(MINIFETCH_TINY)
+    if (opts->from_shm) {
+        struct mf_snapshot snap;
+
+        /* Without a live daemon, fall through and collect as usual. */
+        if (mf_snapshot_copy(&snap, (uint32_t)MF_ARRAY_LEN(g_fields)) == 0) {
+            line_count = 0;
+            for (k = 0; k < MF_ARRAY_LEN(g_fields); ++k) {
+                i = g_order[k];
+                if (!mf_field_enabled(i, opts) || !snap.line[i].ok) {
+                    continue;
+                }
+                memcpy(lines[line_count].value, snap.line[i].value, sizeof(lines[line_count].value));
+                lines[line_count].value[sizeof(lines[line_count].value) - 1U] = '\0';
+                lines[line_count].label = g_labels[i];
+                line_count++;
+            }
+            return line_count;
+        }
+    }
+#endif
+
+    file_count = 0;
+    for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
+        if (g_fields[i].file == NULL) {
+            continue;
+        }
+        if (!g_shown[i] && !opts->show_all) {
+            continue;
+        }
+        files[file_count++] = g_fields[i].file;
+    }
+    mf_prefetch_files(files, file_count);
+
+    line_count = 0;
+    for (k = 0; k < MF_ARRAY_LEN(g_fields); ++k) {
+        int rc;
+
+        i = g_order[k];
+        if (!mf_field_enabled(i, opts)) {
+            continue;
+        }
+
+        rc = g_fields[i].collector(lines[line_count].value, sizeof(lines[line_count].value));
+        if (rc != 0) {
+            continue;
+        }
+
+        lines[line_count].label = g_labels[i];
+        line_count++;
+    }
+
+    return line_count;
+}
+
+/* --watch: redraw the table every interval until interrupted. Collector
+ * state (rates, CPU deltas) stays in memory between refreshes. A
+ * terminal with synchronized output shows each redraw whole instead of
+ * flashing the cleared screen first. */
+static int mf_run_watch(struct mf_render_line *lines, const struct mf_options *opts, const struct mf_palette *pal, int tty, int sync)
+{
+    static const struct mf_span clear = MF_SPAN_LIT("\x1b[H\x1b[2J");
+    static const struct mf_span sync_clear = MF_SPAN_LIT("\x1b[?2026h\x1b[H\x1b[2J");
+    static const struct mf_span sync_end = MF_SPAN_LIT("\x1b[?2026l");
+    struct timespec ts;
+    size_t line_count;
+
+    mf_state_use_memory();
+    ts.tv_sec = (time_t)opts->watch_interval;
+    ts.tv_nsec = 0;
+    for (;;) {
+        line_count = mf_collect_lines(lines, opts);
+        if (tty && sync) {
+            mf_render_table(lines, line_count, pal, opts->quiet, &sync_clear, &sync_end);
+        } else {
+            mf_render_table(lines, line_count, pal, opts->quiet, tty ? &clear : NULL, NULL);
+        }
+        while (nanosleep(&ts, NULL) != 0) {
+        }
+    }
+    return 0;
+}
+
+#if !defined(MINIFETCH_TINY)
+static volatile sig_atomic_t g_daemon_running = 1;
+
+static void mf_daemon_on_signal(int sig)
+{
+    (void)sig;
+    g_daemon_running = 0;
+}
+
+/* --daemon: run every collector on its own refresh interval and publish
+ * the results to shared memory for --from-shm clients. Values are
+ * collected first so the seqlock write is a short copy. Opt-in fields
+ * are only collected when the daemon's own options or config ask for
+ * them, since clients take those settings from the daemon. */
+static int mf_run_daemon(const struct mf_options *opts)
+{
+    static const char busy[] = "minifetch: cannot publish snapshot (already running?)\n";
+    static struct mf_snapshot_line fresh[MF_ARRAY_LEN(g_fields)];
+    int updated[MF_ARRAY_LEN(g_fields)];
+    time_t due[MF_ARRAY_LEN(g_fields)];
+    struct mf_snapshot *snap;
+    struct sigaction sa;
+    struct timespec now;
+    struct timespec tick;
+    size_t i;
+
+    snap = mf_snapshot_publish((uint32_t)MF_ARRAY_LEN(g_fields));
+    if (snap == NULL) {
+        mf_write_all(STDERR_FILENO, busy, sizeof(busy) - 1U);
+        return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = mf_daemon_on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    mf_state_use_memory();
+    memset(due, 0, sizeof(due));
+    tick.tv_sec = 1;
+    tick.tv_nsec = 0;
+    while (g_daemon_running) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
+            updated[i] = now.tv_sec >= due[i];
+            if ((g_fields[i].flags & MF_FIELD_OPT_IN) != 0U && !opts->mounts_requested && !g_shown[i]) {
+                updated[i] = 0;
+            }
+            if (!updated[i]) {
+                continue;
+            }
+            fresh[i].ok = g_fields[i].collector(fresh[i].value, sizeof(fresh[i].value)) == 0;
+            due[i] = now.tv_sec + (time_t)g_fields[i].refresh;
+        }
+
+        mf_snapshot_write_begin(snap);
+        for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
+            if (updated[i]) {
+                snap->line[i] = fresh[i];
+            }
+        }
+        mf_snapshot_write_end(snap);
+
+        nanosleep(&tick, NULL);
+    }
+
+    mf_snapshot_unpublish(snap);
+    return 0;
+}
+
+/* Hidden mode's panel between re-collections: every field keeps its last
+ * value and is re-run on its --daemon refresh interval, so OS, CPU and
+ * the like are not re-read every few seconds. */
+struct mf_hidden_source {
+    const struct mf_options *opts;
+    struct mf_render_line line[MF_ARRAY_LEN(g_fields)];
+    int ok[MF_ARRAY_LEN(g_fields)];
+    time_t due[MF_ARRAY_LEN(g_fields)];
+};
+
+/* mf_hidden_collect_fn; runs on hidden mode's collector thread, which
+ * is the only caller of the collectors once hidden mode has started. */
+static size_t mf_hidden_recollect(char formatted[][MF_FORMATTED_LINE_MAX], size_t widths[], void *ctx)
+{
+    struct mf_hidden_source *src = (struct mf_hidden_source *)ctx;
+    struct mf_render_line lines[MF_ARRAY_LEN(g_fields)];
+    struct timespec now;
+    size_t line_count;
+    size_t k;
+    size_t i;
+
+    if (src->opts->from_shm) {
+        /* The daemon already keeps the fields on their intervals. */
+        line_count = mf_collect_lines(lines, src->opts);
+    } else {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        line_count = 0;
+        for (k = 0; k < MF_ARRAY_LEN(g_fields); ++k) {
+            i = g_order[k];
+            if (!mf_field_enabled(i, src->opts)) {
+                continue;
+            }
+            if (now.tv_sec >= src->due[i]) {
+                src->ok[i] = g_fields[i].collector(src->line[i].value, sizeof(src->line[i].value)) == 0;
+                src->line[i].label = g_labels[i];
+                src->due[i] = now.tv_sec + (time_t)g_fields[i].refresh;
+            }
+            if (src->ok[i]) {
+                lines[line_count++] = src->line[i];
+            }
+        }
+    }
+    /* Hidden mode never colours the panel. */
+    mf_format_hidden_rows(formatted, widths, lines, line_count, &g_palette_plain, src->opts->quiet);
+    return line_count;
+}
+#endif
+
 int main(int argc, char **argv)
 {
     struct mf_options opts;
     struct mf_render_line lines[MF_ARRAY_LEN(g_fields)];
-    char formatted[MF_ARRAY_LEN(g_fields)][MF_FORMATTED_LINE_MAX];
-    size_t visible_widths[MF_ARRAY_LEN(g_fields)];
     size_t line_count;
     int parse_result;
     int want_colour;
     int stdout_is_tty;
-    const char *label_colour;
-    const char *value_colour;
-    const char *reset_colour;
-    size_t i;
+    unsigned int caps_flags;
+    const struct mf_palette *palette;
 
+    mf_cli_defaults(&opts);
+    mf_load_userconf(&opts);
     parse_result = mf_cli_parse(argc, argv, &opts);
     if (parse_result != 0) {
         mf_cli_print_usage(argv[0]);
@@ -68,114 +550,180 @@ int main(int argc, char **argv)
     if (opts.no_colour) {
         want_colour = 0;
     }
-    if (opts.hidden) {
+    if (opts.hidden || opts.export_path != NULL) {
         want_colour = 0;
     }
 
-    label_colour = want_colour ? CFG_LABEL_COLOR : "";
-    value_colour = want_colour ? CFG_VALUE_COLOR : "";
-    reset_colour = want_colour ? CFG_RESET_COLOR : "";
+    palette = want_colour ? &g_palette_colour : &g_palette_plain;
 
-    line_count = 0;
-    for (i = 0; i < MF_ARRAY_LEN(g_fields); ++i) {
-        int enabled;
-        int rc;
+    /* Only the modes that redraw ask the terminal what it supports; a
+     * one-shot table is plain text either way. Asked before --root, which
+     * keeps state files in memory: the answer describes the terminal,
+     * not the system. */
+    caps_flags = 0U;
+#if defined(MINIFETCH_TINY)
+    if (opts.termcaps) {
+        mf_cli_print_usage(argv[0]);
+        return 1;
+    }
+#else
+    if (opts.termcaps || (stdout_is_tty && (opts.watch_interval > 0U || opts.replay != NULL ||
+                                            (opts.hidden && opts.sink_count == 0U && opts.export_path == NULL)))) {
+        struct mf_termcaps caps;
+        int source = mf_termcaps_detect(&caps);
 
-        enabled = g_fields[i].enabled_default;
-        if (!enabled && !opts.show_all) {
-            continue;
+        if (opts.termcaps) {
+            mf_termcaps_print(&caps, source);
+            return 0;
         }
+        caps_flags = caps.flags;
+    }
+#endif
 
-        rc = g_fields[i].collector(lines[line_count].value, sizeof(lines[line_count].value));
-        if (rc != 0) {
-            continue;
-        }
+    mf_mounts_configure(opts.mounts_top, opts.mount_filter);
 
-        lines[line_count].label = g_fields[i].label;
+    if (opts.roots_under != NULL) {
+        if (mf_run_fleet(opts.roots_under) != 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
+        }
+        return 0;
+    }
+    /* MINIFETCH_SYSROOT points the collectors at a synthetic /proc and
+     * /sys tree (tools/gen_fixture.sh) without changing the command. */
+    if (opts.root == NULL) {
+        opts.root = getenv("MINIFETCH_SYSROOT");
+    }
+    if (opts.root != NULL && opts.root[0] != '\0') {
+        int rootfd = open(opts.root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
 
-        if (opts.quiet) {
-            mf_strlcpy(formatted[line_count], lines[line_count].value, MF_FORMATTED_LINE_MAX);
-            visible_widths[line_count] = mf_utf8_display_width(lines[line_count].value);
-        } else {
-            snprintf(formatted[line_count], MF_FORMATTED_LINE_MAX,
-                     "%s%-*s%s %s%s%s",
-                     label_colour,
-                     CFG_LABEL_WIDTH,
-                     lines[line_count].label,
-                     reset_colour,
-                     value_colour,
-                     lines[line_count].value,
-                     reset_colour);
-            visible_widths[line_count] = CFG_LABEL_WIDTH + 1U + mf_utf8_display_width(lines[line_count].value);
+        if (rootfd < 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
         }
+        mf_fileio_set_root(rootfd);
+        /* Saved samples and sensor paths describe the running system;
+         * mixing them with the root's counters would invent rates. */
+        mf_state_use_memory();
+    }
 
-        line_count++;
+    if (opts.daemon) {
+#if defined(MINIFETCH_TINY)
+        /* The tiny build ships without the daemon. */
+        mf_cli_print_usage(argv[0]);
+        return 1;
+#else
+        return mf_run_daemon(&opts);
+#endif
     }
 
-    if (line_count == 0 && g_logo_line_count == 0U) {
+#if defined(MINIFETCH_TINY)
+    /* Recordings, exports and engines belong to hidden mode, which tiny
+     * lacks. */
+    if (opts.replay != NULL || opts.export_path != NULL || (opts.engine != NULL && strcmp(opts.engine, "list") == 0)) {
+        mf_cli_print_usage(argv[0]);
+        return 1;
+    }
+#else
+    /* -c keeps hidden mode monochrome too. A terminal that answered but
+     * keeps no 24-bit colours gets the nearest 256-colour ramp. */
+    if (opts.no_colour) {
+        opts.gradient = MF_HIDDEN_GRADIENT_MONO;
+    } else if (opts.gradient == MF_HIDDEN_GRADIENT_TRUECOLOR &&
+               (caps_flags & (MF_TERMCAP_ANSWERED | MF_TERMCAP_TRUECOLOR)) == MF_TERMCAP_ANSWERED) {
+        opts.gradient = MF_HIDDEN_GRADIENT_256;
+    }
+    mf_hidden_configure(opts.seed, opts.gradient, opts.record);
+    mf_hidden_set_termcaps(caps_flags);
+    if (opts.engine != NULL && strcmp(opts.engine, "list") == 0) {
+        mf_hidden_list_engines();
         return 0;
     }
-
-    if (opts.hidden) {
-        if (!stdout_is_tty) {
-            opts.hidden = 0;
+    if (opts.engine != NULL && mf_hidden_set_engine(opts.engine) != 0) {
+        mf_cli_print_usage(argv[0]);
+        return 1;
+    }
+    if (opts.replay != NULL) {
+        /* The recording carries the panel it was made with; nothing is
+         * collected. */
+        if (mf_run_hidden_replay(opts.replay) != 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
         }
+        return 0;
     }
+#endif
 
-    if (opts.hidden) {
-        mf_run_hidden_mode(formatted, visible_widths, line_count, opts.quiet);
+    if (opts.watch_interval > 0U) {
+        return mf_run_watch(lines, &opts, palette, stdout_is_tty, (caps_flags & MF_TERMCAP_SYNC) != 0U);
+    }
+
+    line_count = mf_collect_lines(lines, &opts);
+
+    if (line_count == 0 && g_logo_line_count == 0U) {
         return 0;
     }
 
-    {
-        size_t rows;
-        size_t column_gap;
+#if defined(MINIFETCH_TINY)
+    /* The tiny build ships without hidden mode; fall back to the table. */
+    opts.hidden = 0;
+#endif
 
-        rows = line_count;
-        if (g_logo_line_count > rows) {
-            rows = g_logo_line_count;
-        }
+#if !defined(MINIFETCH_TINY)
+    if (opts.sink_count > 0U || (opts.hidden && stdout_is_tty)) {
+        static struct mf_hidden_source source;
 
-        column_gap = 0U;
-        if (line_count > 0 && g_logo_line_count > 0) {
-            column_gap = 2U;
-        }
+        /* Rates (Net, Disk I/O) are taken between refreshes, as under
+         * --watch. */
+        mf_state_use_memory();
+        source.opts = &opts;
+        mf_hidden_set_refresh(mf_hidden_recollect, &source, MF_ARRAY_LEN(g_fields), opts.refresh);
+    }
+    if (opts.export_path != NULL) {
+        char formatted[MF_ARRAY_LEN(g_fields)][MF_FORMATTED_LINE_MAX];
+        size_t visible_widths[MF_ARRAY_LEN(g_fields)];
 
-        for (i = 0; i < rows; ++i) {
-            size_t pad_spaces;
-            size_t n;
+        mf_format_hidden_rows(formatted, visible_widths, lines, line_count, palette, opts.quiet);
+        if (mf_run_hidden_export(formatted, visible_widths, line_count, opts.export_path, opts.export_frames,
+                                 opts.export_frame_ms, (int)opts.export_rows, (int)opts.export_cols) != 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
+        }
+        return 0;
+    }
+    if (opts.sink_count > 0U) {
+        char formatted[MF_ARRAY_LEN(g_fields)][MF_FORMATTED_LINE_MAX];
+        size_t visible_widths[MF_ARRAY_LEN(g_fields)];
 
-            if (i < g_logo_line_count) {
-                const char *logo_line = g_logo_lines[i];
-                size_t logo_len = mf_utf8_display_width(logo_line);
-                fputs(logo_line, stdout);
-                if (g_logo_width > logo_len) {
-                    pad_spaces = g_logo_width - logo_len;
-                } else {
-                    pad_spaces = 0U;
-                }
-            } else {
-                pad_spaces = g_logo_width;
-            }
+        mf_format_hidden_rows(formatted, visible_widths, lines, line_count, palette, opts.quiet);
+        if (mf_run_hidden_broadcast(formatted, visible_widths, line_count, opts.sinks, opts.sink_count) != 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
+        }
+        return 0;
+    }
+#endif
 
-            n = pad_spaces;
-            while (n > 0U) {
-                fputc(' ', stdout);
-                n--;
-            }
+    if (opts.hidden) {
+        if (!stdout_is_tty) {
+            opts.hidden = 0;
+        }
+    }
 
-            if (i < line_count) {
-                n = column_gap;
-                while (n > 0U) {
-                    fputc(' ', stdout);
-                    n--;
-                }
-                fputs(formatted[i], stdout);
-            }
+#if !defined(MINIFETCH_TINY)
+    if (opts.hidden) {
+        char formatted[MF_ARRAY_LEN(g_fields)][MF_FORMATTED_LINE_MAX];
+        size_t visible_widths[MF_ARRAY_LEN(g_fields)];
 
-            fputc('\n', stdout);
+        mf_format_hidden_rows(formatted, visible_widths, lines, line_count, palette, opts.quiet);
+        if (mf_run_hidden_mode(formatted, visible_widths, line_count, opts.quiet) != 0) {
+            mf_cli_print_usage(argv[0]);
+            return 1;
         }
+        return 0;
     }
+#endif
 
+    mf_render_table(lines, line_count, palette, opts.quiet, NULL, NULL);
     return 0;
 }
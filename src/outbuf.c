@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "outbuf.h"
+
+int mf_write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0U) {
+        ssize_t n;
+
+        n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+void mf_outbuf_init(struct mf_outbuf *ob, char *storage, size_t cap, int fd)
+{
+    ob->data = storage;
+    ob->len = 0U;
+    ob->cap = cap;
+    ob->fd = fd;
+    ob->error = 0;
+}
+
+int mf_outbuf_flush(struct mf_outbuf *ob)
+{
+    if (ob->len > 0U) {
+        if (mf_write_all(ob->fd, ob->data, ob->len) != 0) {
+            ob->error = 1;
+        }
+        ob->len = 0U;
+    }
+    return ob->error ? -1 : 0;
+}
+
+void mf_outbuf_put(struct mf_outbuf *ob, const char *s, size_t n)
+{
+    while (n > 0U) {
+        size_t room;
+        size_t chunk;
+
+        room = ob->cap - ob->len;
+        if (room == 0U) {
+            mf_outbuf_flush(ob);
+            room = ob->cap;
+        }
+        chunk = n < room ? n : room;
+        memcpy(ob->data + ob->len, s, chunk);
+        ob->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+void mf_outbuf_puts(struct mf_outbuf *ob, const char *s)
+{
+    mf_outbuf_put(ob, s, strlen(s));
+}
+
+void mf_outbuf_span(struct mf_outbuf *ob, const struct mf_span *span)
+{
+    mf_outbuf_put(ob, span->ptr, span->len);
+}
+
+void mf_outbuf_fill(struct mf_outbuf *ob, char c, size_t n)
+{
+    while (n > 0U) {
+        size_t room;
+        size_t chunk;
+
+        room = ob->cap - ob->len;
+        if (room == 0U) {
+            mf_outbuf_flush(ob);
+            room = ob->cap;
+        }
+        chunk = n < room ? n : room;
+        memset(ob->data + ob->len, c, chunk);
+        ob->len += chunk;
+        n -= chunk;
+    }
+}
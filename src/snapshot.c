@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "fmt.h"
+
+#define MF_SNAPSHOT_MAGIC 0x3148464dU /* "MFH1" */
+/* Bumped whenever struct mf_snapshot changes shape. */
+#define MF_SNAPSHOT_LAYOUT 1U
+#define MF_SNAPSHOT_NAME_MAX 64
+/* A reader that keeps landing on a write gives up rather than spin. */
+#define MF_SNAPSHOT_READ_TRIES 64
+
+static int g_snapshot_fd = -1;
+static char g_snapshot_name[MF_SNAPSHOT_NAME_MAX];
+
+static uint64_t mf_snapshot_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int mf_snapshot_name(char *out, size_t outsz)
+{
+    const char *env;
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    env = getenv("MINIFETCH_SHM");
+    if (env != NULL && env[0] == '/') {
+        mf_fmt_str(&f, env);
+    } else {
+        mf_fmt_str(&f, "/minifetch-");
+        mf_fmt_uint(&f, (uint64_t)geteuid());
+    }
+    return f.len + 1U < outsz ? 0 : -1;
+}
+
+/* Same trust rule as the state files: ours and writable only by us. */
+static int mf_snapshot_trusted(int fd, int need_size)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        return 0;
+    }
+    return !need_size || (uint64_t)st.st_size == (uint64_t)sizeof(struct mf_snapshot);
+}
+
+struct mf_snapshot *mf_snapshot_publish(uint32_t count)
+{
+    struct mf_snapshot *snap;
+    struct flock lock;
+    void *map;
+    int fd;
+
+    if (count > MF_SNAPSHOT_LINES || mf_snapshot_name(g_snapshot_name, sizeof(g_snapshot_name)) != 0) {
+        return NULL;
+    }
+    fd = shm_open(g_snapshot_name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (!mf_snapshot_trusted(fd, 0) || fcntl(fd, F_SETLK, &lock) != 0 ||
+        ftruncate(fd, (off_t)sizeof(struct mf_snapshot)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, sizeof(struct mf_snapshot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    g_snapshot_fd = fd;
+
+    /* Odd while the header is reset, whatever a daemon that died
+     * mid-write left behind. The stamp stays 0 until the first full
+     * publish, so clients keep collecting for themselves until then. */
+    snap = (struct mf_snapshot *)map;
+    __atomic_store_n(&snap->seq, __atomic_load_n(&snap->seq, __ATOMIC_RELAXED) | 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(snap->line, 0, sizeof(snap->line));
+    snap->magic = MF_SNAPSHOT_MAGIC;
+    snap->layout = MF_SNAPSHOT_LAYOUT;
+    snap->count = count;
+    snap->stamp_ns = 0U;
+    __atomic_store_n(&snap->seq, snap->seq + 1U, __ATOMIC_RELEASE);
+    return snap;
+}
+
+void mf_snapshot_write_begin(struct mf_snapshot *snap)
+{
+    __atomic_store_n(&snap->seq, snap->seq + 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void mf_snapshot_write_end(struct mf_snapshot *snap)
+{
+    snap->stamp_ns = mf_snapshot_now_ns();
+    __atomic_store_n(&snap->seq, snap->seq + 1U, __ATOMIC_RELEASE);
+}
+
+void mf_snapshot_unpublish(struct mf_snapshot *snap)
+{
+    munmap(snap, sizeof(*snap));
+    shm_unlink(g_snapshot_name);
+    close(g_snapshot_fd);
+    g_snapshot_fd = -1;
+}
+
+int mf_snapshot_copy(struct mf_snapshot *out, uint32_t count)
+{
+    char name[MF_SNAPSHOT_NAME_MAX];
+    const struct mf_snapshot *snap;
+    void *map;
+    uint64_t now;
+    int tries;
+    int fd;
+    int rc;
+
+    if (mf_snapshot_name(name, sizeof(name)) != 0) {
+        return -1;
+    }
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!mf_snapshot_trusted(fd, 1)) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, sizeof(struct mf_snapshot), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    snap = (const struct mf_snapshot *)map;
+
+    rc = -1;
+    for (tries = 0; tries < MF_SNAPSHOT_READ_TRIES; ++tries) {
+        uint32_t before;
+        uint32_t after;
+
+        before = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+        if ((before & 1U) != 0U) {
+            /* Let a preempted writer finish (matters on one CPU). */
+            sched_yield();
+            continue;
+        }
+        memcpy(out, snap, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&snap->seq, __ATOMIC_RELAXED);
+        if (before == after) {
+            rc = 0;
+            break;
+        }
+    }
+    munmap(map, sizeof(struct mf_snapshot));
+
+    now = mf_snapshot_now_ns();
+    if (rc != 0 || out->magic != MF_SNAPSHOT_MAGIC || out->layout != MF_SNAPSHOT_LAYOUT || out->count != count ||
+        out->stamp_ns == 0U || out->stamp_ns > now || now - out->stamp_ns > MF_SNAPSHOT_MAX_AGE_NS) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "state.h"
+#include "fmt.h"
+#include "outbuf.h"
+
+#define MF_STATE_PATH_MAX 512
+#define MF_STATE_MEM_SLOTS 8
+
+struct mf_state_mem {
+    const char *name;
+    void *data;
+    size_t len;
+};
+
+static int g_state_in_memory = 0;
+static struct mf_state_mem g_state_mem[MF_STATE_MEM_SLOTS];
+
+void mf_state_use_memory(void)
+{
+    g_state_in_memory = 1;
+}
+
+static struct mf_state_mem *mf_state_mem_slot(const char *name, int create)
+{
+    size_t i;
+
+    for (i = 0; i < MF_STATE_MEM_SLOTS; ++i) {
+        if (g_state_mem[i].name != NULL && strcmp(g_state_mem[i].name, name) == 0) {
+            return &g_state_mem[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    for (i = 0; i < MF_STATE_MEM_SLOTS; ++i) {
+        if (g_state_mem[i].name == NULL) {
+            g_state_mem[i].name = name;
+            return &g_state_mem[i];
+        }
+    }
+    return NULL;
+}
+
+static int mf_state_path(const char *name, char *out, size_t outsz)
+{
+    const char *dir;
+    struct mf_fmt f;
+
+    dir = getenv("MINIFETCH_STATE_DIR");
+    if (dir == NULL || dir[0] != '/') {
+        dir = getenv("XDG_RUNTIME_DIR");
+    }
+    if (dir == NULL || dir[0] != '/') {
+        dir = "/tmp";
+    }
+
+    mf_fmt_init(&f, out, outsz);
+    mf_fmt_str(&f, dir);
+    mf_fmt_str(&f, "/minifetch-");
+    mf_fmt_uint(&f, (uint64_t)geteuid());
+    mf_fmt_str(&f, "-");
+    mf_fmt_str(&f, name);
+    /* A truncated path could name someone else's file. */
+    return f.len + 1U < outsz ? 0 : -1;
+}
+
+long mf_state_load(const char *name, void *buf, size_t cap)
+{
+    char path[MF_STATE_PATH_MAX];
+    struct stat st;
+    size_t used;
+    int fd;
+
+    if (g_state_in_memory) {
+        struct mf_state_mem *slot = mf_state_mem_slot(name, 0);
+
+        if (slot == NULL || slot->len > cap) {
+            return -1;
+        }
+        memcpy(buf, slot->data, slot->len);
+        return (long)slot->len;
+    }
+
+    if (mf_state_path(name, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) != 0 || st.st_size < 0 || (uint64_t)st.st_size > (uint64_t)cap) {
+        close(fd);
+        return -1;
+    }
+
+    used = 0U;
+    while (used < (size_t)st.st_size) {
+        ssize_t n;
+
+        n = read(fd, (char *)buf + used, (size_t)st.st_size - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    close(fd);
+    return used == (size_t)st.st_size ? (long)used : -1;
+}
+
+int mf_state_store(const char *name, const void *buf, size_t len)
+{
+    char path[MF_STATE_PATH_MAX];
+    char tmp[MF_STATE_PATH_MAX];
+    struct mf_fmt f;
+    int fd;
+    int rc;
+
+    if (g_state_in_memory) {
+        struct mf_state_mem *slot = mf_state_mem_slot(name, 1);
+        void *data;
+
+        if (slot == NULL) {
+            return -1;
+        }
+        if (slot->len != len) {
+            data = realloc(slot->data, len);
+            if (data == NULL) {
+                return -1;
+            }
+            slot->data = data;
+            slot->len = len;
+        }
+        memcpy(slot->data, buf, len);
+        return 0;
+    }
+
+    if (mf_state_path(name, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    mf_fmt_init(&f, tmp, sizeof(tmp));
+    mf_fmt_str(&f, path);
+    mf_fmt_str(&f, ".");
+    mf_fmt_uint(&f, (uint64_t)getpid());
+    if (f.len + 1U >= sizeof(tmp)) {
+        return -1;
+    }
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    rc = mf_write_all(fd, (const char *)buf, len);
+    if (close(fd) != 0) {
+        rc = -1;
+    }
+    if (rc == 0 && rename(tmp, path) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        unlink(tmp);
+    }
+    return rc;
+}
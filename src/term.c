@@ -1,72 +1,236 @@
-#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MF_TERM_AVX2 1
+#define MF_TERM_SSE2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MF_TERM_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MF_TERM_NEON 1
+#endif
+
 #include "term.h"
+#include "wcwidth_table.h"
+
+#if defined(__GNUC__)
+#define MF_NOINLINE __attribute__((noinline))
+#else
+#define MF_NOINLINE
+#endif
 
-#define MF_ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+/* ASCII prefix mf_utf8_display_width measures byte by byte; a multiple
+ * of four. */
+#define MF_WIDTH_SCALAR_MAX 64U
 
 int mf_is_tty(void)
 {
     return isatty(STDOUT_FILENO) == 1;
 }
 
-void mf_format_bytes(double bytes, char *out, size_t outsz)
+static unsigned int mf_codepoint_width(unsigned long cp)
 {
-    static const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB", "PiB" };
-    int unit_index;
-    double value;
+    unsigned int block;
+    unsigned int bits;
 
-    if (out == NULL || outsz == 0) {
-        return;
+    if (cp >= 0x110000UL) {
+        return 1U;
     }
 
-    if (bytes < 0.0) {
-        bytes = 0.0;
-    }
+    block = g_wcwidth_stage1[cp >> 8];
+    bits = g_wcwidth_stage2[block][(cp & 0xFFUL) >> 2];
+    return (bits >> ((unsigned int)(cp & 3UL) * 2U)) & 3U;
+}
 
-    value = bytes;
-    unit_index = 0;
+/* Decodes one UTF-8 sequence from p (at most avail bytes). Malformed or
+ * truncated sequences consume a single byte and count as one column so a
+ * stray byte never swallows the rest of the line. */
+static size_t mf_utf8_decode(const unsigned char *p, size_t avail, unsigned int *width)
+{
+    unsigned long cp;
+    size_t len;
+    size_t i;
 
-    while (value >= 1024.0 && unit_index < (int)(MF_ARRAY_LEN(units) - 1)) {
-        value /= 1024.0;
-        unit_index++;
+    if (p[0] < 0x80U) {
+        *width = 1U;
+        return 1U;
     }
 
-    if (value >= 100.0) {
-        snprintf(out, outsz, "%.0f %s", value, units[unit_index]);
-    } else if (value >= 10.0) {
-        snprintf(out, outsz, "%.1f %s", value, units[unit_index]);
+    if ((p[0] & 0xE0U) == 0xC0U) {
+        len = 2U;
+        cp = p[0] & 0x1FUL;
+    } else if ((p[0] & 0xF0U) == 0xE0U) {
+        len = 3U;
+        cp = p[0] & 0x0FUL;
+    } else if ((p[0] & 0xF8U) == 0xF0U) {
+        len = 4U;
+        cp = p[0] & 0x07UL;
     } else {
-        snprintf(out, outsz, "%.2f %s", value, units[unit_index]);
+        *width = 1U;
+        return 1U;
+    }
+
+    if (len > avail) {
+        *width = 1U;
+        return 1U;
     }
+
+    for (i = 1U; i < len; ++i) {
+        if ((p[i] & 0xC0U) != 0x80U) {
+            *width = 1U;
+            return 1U;
+        }
+        cp = (cp << 6) | (p[i] & 0x3FUL);
+    }
+
+    *width = mf_codepoint_width(cp);
+    return len;
 }
 
-size_t mf_utf8_display_width(const char *s)
+/* Returns nonzero when the 16 bytes at p are all ASCII. Loads stay within
+ * the caller's bounds, so no alignment games are needed. */
+static int mf_ascii_block16(const unsigned char *p)
+{
+#if defined(MF_TERM_SSE2)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)p)) == 0;
+#elif defined(MF_TERM_NEON)
+    return vmaxvq_u8(vld1q_u8(p)) < 0x80U;
+#else
+    uint64_t a;
+    uint64_t b;
+
+    memcpy(&a, p, sizeof(a));
+    memcpy(&b, p + 8, sizeof(b));
+    return ((a | b) & UINT64_C(0x8080808080808080)) == 0U;
+#endif
+}
+
+size_t mf_utf8_display_width_n(const char *s, size_t len)
 {
     const unsigned char *p;
+    const unsigned char *end;
+    const unsigned char *scalar_end;
     size_t width;
 
     if (s == NULL) {
         return 0U;
     }
 
-    width = 0U;
     p = (const unsigned char *)s;
+    end = p + len;
+    width = 0U;
 
-    while (*p != '\0') {
-        width++;
-        if ((*p & 0x80U) == 0U) {
-            p++;
-        } else if ((*p & 0xE0U) == 0xC0U && p[1] != '\0') {
-            p += 2;
-        } else if ((*p & 0xF0U) == 0xE0U && p[1] != '\0' && p[2] != '\0') {
-            p += 3;
-        } else if ((*p & 0xF8U) == 0xF0U && p[1] != '\0' && p[2] != '\0' && p[3] != '\0') {
-            p += 4;
+    while (p < end) {
+        unsigned int w;
+
+        if ((size_t)(end - p) >= 16U) {
+#if defined(MF_TERM_AVX2)
+            if ((size_t)(end - p) >= 32U &&
+                _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(const void *)p)) == 0) {
+                width += 32U;
+                p += 32;
+                continue;
+            }
+#endif
+            if (mf_ascii_block16(p)) {
+                width += 16U;
+                p += 16;
+                continue;
+            }
+            /* Decode the mixed block one glyph at a time before trying
+             * the vector path again. */
+            scalar_end = p + 16;
         } else {
-            p++;
+            scalar_end = end;
+        }
+
+        while (p < scalar_end) {
+            if (*p < 0x80U) {
+                width++;
+                p++;
+                continue;
+            }
+            p += mf_utf8_decode(p, (size_t)(end - p), &w);
+            width += w;
         }
     }
 
     return width;
 }
+
+/* Width of s, whose first n bytes are known to be ASCII. Kept out of
+ * line so the short-string path below needs no stack frame. */
+MF_NOINLINE static size_t mf_utf8_display_width_rest(const char *s, size_t n)
+{
+    return n + mf_utf8_display_width_n(s + n, strlen(s + n));
+}
+
+/* Labels and values are mostly short ASCII, which a plain byte loop
+ * finishes before strlen would have. Past MF_WIDTH_SCALAR_MAX bytes, or
+ * at the first non-ASCII byte, the rest is measured and handed to the
+ * bounded vector scan, whose loads then stay inside the string. */
+size_t mf_utf8_display_width(const char *s)
+{
+    const unsigned char *p;
+    size_t n;
+
+    if (s == NULL) {
+        return 0U;
+    }
+
+    /* One compare per byte, NUL and non-ASCII both wrapping to >= 0x7f,
+     * and the bound checked once per four bytes. */
+    p = (const unsigned char *)s;
+    for (n = 0U; n < MF_WIDTH_SCALAR_MAX; n += 4U) {
+        if ((unsigned char)(p[n] - 1U) >= 0x7fU) {
+            break;
+        }
+        if ((unsigned char)(p[n + 1U] - 1U) >= 0x7fU) {
+            n += 1U;
+            break;
+        }
+        if ((unsigned char)(p[n + 2U] - 1U) >= 0x7fU) {
+            n += 2U;
+            break;
+        }
+        if ((unsigned char)(p[n + 3U] - 1U) >= 0x7fU) {
+            n += 3U;
+            break;
+        }
+    }
+    if (n < MF_WIDTH_SCALAR_MAX && p[n] == '\0') {
+        return n;
+    }
+    return mf_utf8_display_width_rest(s, n);
+}
+
+size_t mf_utf8_next(const char *s, unsigned int *width)
+{
+    const unsigned char *p;
+    size_t avail;
+    unsigned int w;
+    size_t len;
+
+    if (s == NULL || s[0] == '\0') {
+        if (width != NULL) {
+            *width = 0U;
+        }
+        return 0U;
+    }
+
+    p = (const unsigned char *)s;
+    avail = 1U;
+    while (avail < 4U && p[avail] != '\0') {
+        avail++;
+    }
+
+    len = mf_utf8_decode(p, avail, &w);
+    if (width != NULL) {
+        *width = w;
+    }
+    return len;
+}
@@ -0,0 +1,428 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "termcaps.h"
+#include "fmt.h"
+#include "outbuf.h"
+#include "state.h"
+
+#define MF_TERMCAPS_STATE_NAME "termcaps"
+#define MF_TERMCAPS_MAGIC 0x3154464dU /* "MFT1" */
+/* Terminals remembered at once; the one unused the longest goes first. */
+#define MF_TERMCAPS_SLOTS 8U
+#define MF_TERMCAPS_KEY_MAX 160U
+#define MF_TERMCAPS_REPLY_MAX 1024U
+
+/* Everything is sent in one write and answered in order, so the DA1
+ * reply, which every VT100 descendant gives, closes the batch.
+ *   - two cursor reports around "x" and a REP of it: the column moves
+ *     by 2 only where REP works; DECSC/DECRC and EL put the line back;
+ *   - DECRQSS of the SGR after setting a 24-bit colour: only terminals
+ *     that keep such colours echo them;
+ *   - DECRQM for modes 2026 and 1004, XTVERSION, DA2, DA1. */
+static const char g_termcaps_query[] = "\x1b" "7\x1b[6nx\x1b[b\x1b[6n\x1b" "8\x1b[K"
+                                       "\x1b[38;2;1;2;3m\x1bP$qm\x1b\\\x1b[m"
+                                       "\x1b[?2026$p\x1b[?1004$p\x1b[>0q\x1b[>c\x1b[c";
+
+/* On-disk layout of the cache: a header and MF_TERMCAPS_SLOTS entries.
+ * An empty key marks a free slot. */
+struct mf_termcaps_entry {
+    char key[MF_TERMCAPS_KEY_MAX];
+    char version[MF_TERMCAPS_VERSION_MAX];
+    uint32_t flags;
+    uint32_t used; /* cache clock when last probed */
+};
+
+struct mf_termcaps_cache {
+    uint32_t magic;
+    uint32_t clock;
+    struct mf_termcaps_entry slot[MF_TERMCAPS_SLOTS];
+};
+
+/* What the replies in a buffer add up to. */
+struct mf_termcaps_reply {
+    unsigned int flags;
+    int cpr_cols[2];
+    unsigned int cpr_count;
+    int done; /* the DA1 reply was seen */
+};
+
+/* Whether the environment names the terminal program, not just the
+ * terminal type that many programs share. */
+static int mf_termcaps_env_specific(void)
+{
+    const char *program = getenv("TERM_PROGRAM");
+    const char *vte = getenv("VTE_VERSION");
+
+    return (program != NULL && program[0] != '\0') || (vte != NULL && vte[0] != '\0');
+}
+
+/* Builds the cache key from the environment. Where it does not name
+ * the terminal program (ssh, a console), the tty and its session stand
+ * in: one login session stays in one terminal, and a new session is
+ * probed afresh. Returns -1 when there is no key to be had or it does
+ * not fit, so two terminals can never share a truncated key. */
+static int mf_termcaps_key(char *out, size_t outsz, int specific)
+{
+    static const char *const vars[] = { "TERM", "TERM_PROGRAM", "TERM_PROGRAM_VERSION", "VTE_VERSION" };
+    struct mf_fmt f;
+    size_t i;
+
+    mf_fmt_init(&f, out, outsz);
+    for (i = 0; i < sizeof(vars) / sizeof(vars[0]); ++i) {
+        const char *value = getenv(vars[i]);
+
+        if (i > 0U) {
+            mf_fmt_str(&f, "\x1f");
+        }
+        if (value != NULL) {
+            mf_fmt_str(&f, value);
+        }
+    }
+    if (!specific) {
+        const char *tty = ttyname(STDIN_FILENO);
+        pid_t sid = tcgetsid(STDIN_FILENO);
+
+        if (tty == NULL || sid < 0) {
+            return -1;
+        }
+        mf_fmt_str(&f, "\x1f");
+        mf_fmt_str(&f, tty);
+        mf_fmt_str(&f, "\x1f");
+        mf_fmt_uint(&f, (uint64_t)sid);
+    }
+    return f.len + 1U < outsz ? 0 : -1;
+}
+
+static void mf_termcaps_copy(char *dst, size_t dstsz, const char *src, size_t len)
+{
+    if (len >= dstsz) {
+        len = dstsz - 1U;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+/* Reads "Pn;Pn..." into v (up to max values). Returns the count. */
+static unsigned int mf_termcaps_params(const char *p, size_t len, int v[], unsigned int max)
+{
+    unsigned int n = 0U;
+    size_t i;
+
+    if (len == 0U || max == 0U) {
+        return 0U;
+    }
+    v[0] = 0;
+    for (i = 0; i < len; ++i) {
+        if (p[i] >= '0' && p[i] <= '9') {
+            if (v[n] < 100000) {
+                v[n] = v[n] * 10 + (p[i] - '0');
+            }
+        } else if (p[i] == ';') {
+            if (++n == max) {
+                return n;
+            }
+            v[n] = 0;
+        }
+    }
+    return n + 1U;
+}
+
+static int mf_termcaps_contains(const char *p, size_t len, const char *needle)
+{
+    size_t n = strlen(needle);
+    size_t i;
+
+    for (i = 0; i + n <= len; ++i) {
+        if (memcmp(p + i, needle, n) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Picks the replies out of buf. Complete sequences only; anything else,
+ * keys typed meanwhile included, is skipped. */
+static void mf_termcaps_parse(const char *buf, size_t len, struct mf_termcaps_reply *reply, struct mf_termcaps *caps)
+{
+    size_t i = 0U;
+
+    memset(reply, 0, sizeof(*reply));
+    while (i + 1U < len) {
+        if (buf[i] != '\x1b') {
+            ++i;
+            continue;
+        }
+        if (buf[i + 1U] == '[') {
+            size_t start = i + 2U;
+            size_t end = start;
+            char lead = '\0';
+            int v[4];
+            unsigned int n;
+
+            while (end < len && !(buf[end] >= 0x40 && buf[end] <= 0x7e)) {
+                ++end;
+            }
+            if (end >= len) {
+                return;
+            }
+            if (buf[start] == '?' || buf[start] == '>') {
+                lead = buf[start++];
+            }
+            n = mf_termcaps_params(buf + start, end - start, v, 4U);
+            if (buf[end] == 'R' && lead == '\0' && n == 2U && reply->cpr_count < 2U) {
+                reply->cpr_cols[reply->cpr_count++] = v[1];
+            } else if (buf[end] == 'y' && lead == '?' && n == 2U && (v[1] == 1 || v[1] == 2)) {
+                /* 1 and 2: set and reset; 0 and 4: unknown or fixed off. */
+                if (v[0] == 2026) {
+                    reply->flags |= MF_TERMCAP_SYNC;
+                } else if (v[0] == 1004) {
+                    reply->flags |= MF_TERMCAP_FOCUS;
+                }
+            } else if (buf[end] == 'c' && lead == '>' && caps->version[0] == '\0') {
+                caps->version[0] = '>';
+                mf_termcaps_copy(caps->version + 1, sizeof(caps->version) - 1U, buf + start, end - start);
+            } else if (buf[end] == 'c' && lead == '?') {
+                reply->flags |= MF_TERMCAP_ANSWERED;
+                reply->done = 1;
+            }
+            i = end + 1U;
+        } else if (buf[i + 1U] == 'P') {
+            size_t start = i + 2U;
+            size_t end = start;
+
+            while (end + 1U < len && !(buf[end] == '\x1b' && buf[end + 1U] == '\\')) {
+                ++end;
+            }
+            if (end + 1U >= len) {
+                return;
+            }
+            if (end - start > 2U && buf[start] == '>' && buf[start + 1U] == '|') {
+                mf_termcaps_copy(caps->version, sizeof(caps->version), buf + start + 2U, end - start - 2U);
+            } else if (end - start > 3U && memcmp(buf + start, "1$r", 3) == 0 &&
+                       (mf_termcaps_contains(buf + start, end - start, "2;1;2;3") ||
+                        mf_termcaps_contains(buf + start, end - start, ":1:2:3"))) {
+                reply->flags |= MF_TERMCAP_TRUECOLOR;
+            }
+            i = end + 2U;
+        } else {
+            ++i;
+        }
+    }
+}
+
+static long mf_termcaps_ms_left(const struct timespec *deadline)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(deadline->tv_sec - now.tv_sec) * 1000L + (deadline->tv_nsec - now.tv_nsec) / 1000000L;
+}
+
+/* Sends query and collects the replies for at most
+ * MF_TERMCAPS_TIMEOUT_MS. Returns 0 once DA1 has answered. */
+static int mf_termcaps_ask(const char *query, size_t querylen, struct mf_termcaps_reply *reply, struct mf_termcaps *caps)
+{
+    char buf[MF_TERMCAPS_REPLY_MAX];
+    struct termios orig;
+    struct termios raw;
+    struct timespec deadline;
+    size_t len = 0U;
+
+    if (tcgetattr(STDIN_FILENO, &orig) != 0) {
+        return -1;
+    }
+    raw = orig;
+    raw.c_lflag &= (unsigned int)~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) {
+        return -1;
+    }
+
+    memset(reply, 0, sizeof(*reply));
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += (long)MF_TERMCAPS_TIMEOUT_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    if (mf_write_all(STDOUT_FILENO, query, querylen) == 0) {
+        while (!reply->done && len + 1U < sizeof(buf)) {
+            struct pollfd pfd;
+            long left = mf_termcaps_ms_left(&deadline);
+            ssize_t n;
+            int rc;
+
+            if (left <= 0) {
+                break;
+            }
+            pfd.fd = STDIN_FILENO;
+            pfd.events = POLLIN;
+            rc = poll(&pfd, 1, (int)left);
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rc <= 0) {
+                break;
+            }
+            n = read(STDIN_FILENO, buf + len, sizeof(buf) - 1U - len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            len += (size_t)n;
+            mf_termcaps_parse(buf, len, reply, caps);
+        }
+    }
+    /* Replies that arrive after the deadline would otherwise reach the
+     * shell, or hidden mode's key reader, as typed input. */
+    tcflush(STDIN_FILENO, TCIFLUSH);
+    tcsetattr(STDIN_FILENO, TCSANOW, &orig);
+    return reply->done ? 0 : -1;
+}
+
+/* Asks for everything. Returns 0 once DA1 has answered. */
+static int mf_termcaps_probe(struct mf_termcaps *caps)
+{
+    struct mf_termcaps_reply reply;
+    int rc;
+
+    memset(caps, 0, sizeof(*caps));
+    rc = mf_termcaps_ask(g_termcaps_query, sizeof(g_termcaps_query) - 1U, &reply, caps);
+    caps->flags = reply.flags;
+    if (reply.cpr_count == 2U && reply.cpr_cols[1] - reply.cpr_cols[0] == 2) {
+        caps->flags |= MF_TERMCAP_REP;
+    }
+    return rc;
+}
+
+/* Remembers caps under key, in the slot of the same key, a free one or
+ * else the one probed longest ago. */
+static void mf_termcaps_remember(struct mf_termcaps_cache *cache, long len, const char *key, const struct mf_termcaps *caps)
+{
+    struct mf_termcaps_entry *victim;
+    size_t i;
+
+    if (len != (long)sizeof(*cache) || cache->magic != MF_TERMCAPS_MAGIC) {
+        memset(cache, 0, sizeof(*cache));
+        cache->magic = MF_TERMCAPS_MAGIC;
+    }
+    victim = &cache->slot[0];
+    for (i = 0; i < MF_TERMCAPS_SLOTS; ++i) {
+        struct mf_termcaps_entry *e = &cache->slot[i];
+
+        if (e->key[0] == '\0' || strcmp(e->key, key) == 0) {
+            victim = e;
+            break;
+        }
+        if (e->used < victim->used) {
+            victim = e;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    mf_termcaps_copy(victim->key, sizeof(victim->key), key, strlen(key));
+    mf_termcaps_copy(victim->version, sizeof(victim->version), caps->version, strlen(caps->version));
+    victim->flags = caps->flags;
+    victim->used = ++cache->clock;
+    mf_state_store(MF_TERMCAPS_STATE_NAME, cache, sizeof(*cache));
+}
+
+int mf_termcaps_detect(struct mf_termcaps *caps)
+{
+    struct mf_termcaps_cache cache;
+    struct mf_termcaps stored;
+    char key[MF_TERMCAPS_KEY_MAX];
+    const char *term = getenv("TERM");
+    const char *colorterm = getenv("COLORTERM");
+    int specific;
+    int keyed;
+    long len;
+    int source;
+    size_t i;
+
+    memset(caps, 0, sizeof(*caps));
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) || (term != NULL && strcmp(term, "dumb") == 0)) {
+        return MF_TERMCAPS_NONE;
+    }
+
+    specific = mf_termcaps_env_specific();
+    keyed = mf_termcaps_key(key, sizeof(key), specific) == 0;
+    len = keyed ? mf_state_load(MF_TERMCAPS_STATE_NAME, &cache, sizeof(cache)) : -1;
+    source = MF_TERMCAPS_NONE;
+    if (len == (long)sizeof(cache) && cache.magic == MF_TERMCAPS_MAGIC) {
+        for (i = 0; i < MF_TERMCAPS_SLOTS; ++i) {
+            if (cache.slot[i].key[0] != '\0' && strncmp(cache.slot[i].key, key, sizeof(cache.slot[i].key)) == 0) {
+                caps->flags = cache.slot[i].flags;
+                mf_termcaps_copy(caps->version, sizeof(caps->version), cache.slot[i].version,
+                                 strnlen(cache.slot[i].version, sizeof(cache.slot[i].version)));
+                source = MF_TERMCAPS_CACHED;
+                break;
+            }
+        }
+    }
+    if (source == MF_TERMCAPS_NONE) {
+        int answered = mf_termcaps_probe(caps) == 0;
+
+        if (answered) {
+            source = MF_TERMCAPS_PROBED;
+        }
+        /* A terminal that did not answer in time is asked again next
+         * run, as the link may just have been slow, except within one
+         * session, where the next run would only wait again. */
+        if (keyed && (answered || !specific)) {
+            stored = *caps;
+            if (!answered) {
+                memset(&stored, 0, sizeof(stored));
+            }
+            /* Sent to a terminal without it, REP garbles the screen, so
+             * it is only remembered for a terminal that said who it is. */
+            if (!specific && stored.version[0] == '\0') {
+                stored.flags &= ~MF_TERMCAP_REP;
+            }
+            mf_termcaps_remember(&cache, len, key, &stored);
+        }
+    }
+
+    /* Terminals that keep 24-bit colours without echoing them say so
+     * here (and it may differ between shells in one terminal). */
+    if (colorterm != NULL && (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0)) {
+        caps->flags |= MF_TERMCAP_TRUECOLOR;
+    }
+    return source;
+}
+
+void mf_termcaps_print(const struct mf_termcaps *caps, int source)
+{
+    static const struct {
+        unsigned int flag;
+        const char *name;
+    } names[] = {
+        { MF_TERMCAP_SYNC, "sync" },
+        { MF_TERMCAP_FOCUS, "focus" },
+        { MF_TERMCAP_REP, "rep" },
+        { MF_TERMCAP_TRUECOLOR, "truecolor" },
+    };
+    char storage[256];
+    struct mf_outbuf ob;
+    size_t i;
+
+    mf_outbuf_init(&ob, storage, sizeof(storage), STDOUT_FILENO);
+    mf_outbuf_puts(&ob, "terminal: ");
+    mf_outbuf_puts(&ob, caps->version[0] != '\0' ? caps->version : "unknown");
+    mf_outbuf_puts(&ob, source == MF_TERMCAPS_CACHED ? " (cached)\n" : source == MF_TERMCAPS_PROBED ? " (probed)\n" : " (no answer)\n");
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        mf_outbuf_puts(&ob, names[i].name);
+        mf_outbuf_puts(&ob, (caps->flags & names[i].flag) != 0U ? ": yes\n" : ": no\n");
+    }
+    mf_outbuf_flush(&ob);
+}
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+
+#include "uring.h"
+
+#if defined(__linux__) && defined(MINIFETCH_IO_URING) && MINIFETCH_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+/* Headers older than 5.17 cannot name IORING_FEAT_CQE_SKIP, which the
+ * setup below relies on; such builds take the plain-syscall fallback. */
+#if defined(__linux__) && defined(MINIFETCH_IO_URING) && MINIFETCH_IO_URING && defined(IORING_FEAT_CQE_SKIP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MF_URING_MAX_FILES 32
+
+/* user_data layout: request index << 2 | operation. */
+#define MF_URING_OP_OPEN  0U
+#define MF_URING_OP_READ  1U
+#define MF_URING_OP_CLOSE 2U
+
+struct mf_uring {
+    int fd;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static void mf_uring_teardown(struct mf_uring *ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if (ring->cq_ptr != NULL && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    if (ring->sq_ptr != NULL && ring->sq_ptr != MAP_FAILED) {
+        munmap(ring->sq_ptr, ring->sq_len);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+}
+
+static int mf_uring_setup(struct mf_uring *ring, unsigned int entries)
+{
+    struct io_uring_params p;
+    char *sq;
+    char *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    /* Direct open/close into fixed slots arrived in 5.15; CQE_SKIP (5.17)
+     * is the closest feature bit that proves the kernel has them. Older
+     * kernels would ignore file_index and close fd 0 instead. */
+    if ((p.features & IORING_FEAT_CQE_SKIP) == 0U) {
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U && ring->cq_len > ring->sq_len) {
+        ring->sq_len = ring->cq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        mf_uring_teardown(ring);
+        return -1;
+    }
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            mf_uring_teardown(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        mf_uring_teardown(ring);
+        return -1;
+    }
+
+    sq = (char *)ring->sq_ptr;
+    cq = (char *)ring->cq_ptr;
+    ring->sq_tail = (unsigned int *)(void *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned int *)(void *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(void *)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned int *)(void *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned int *)(void *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned int *)(void *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(void *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static struct io_uring_sqe *mf_uring_push(struct mf_uring *ring, unsigned int *tail)
+{
+    unsigned int index;
+    struct io_uring_sqe *sqe;
+
+    index = *tail & *ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    (*tail)++;
+    return sqe;
+}
+
+int mf_uring_read_batch(struct mf_uring_req *reqs, size_t count)
+{
+    struct mf_uring ring;
+    int slots[MF_URING_MAX_FILES];
+    unsigned int tail;
+    unsigned int expected;
+    unsigned int seen;
+    size_t i;
+
+    if (count == 0U || count > MF_URING_MAX_FILES) {
+        return -1;
+    }
+
+    if (mf_uring_setup(&ring, (unsigned int)(count * 3U)) != 0) {
+        return -1;
+    }
+
+    /* Sparse fixed-file table: each open installs its descriptor straight
+     * into slot i, so the linked read and close can name it before the
+     * open has completed. */
+    for (i = 0; i < count; ++i) {
+        slots[i] = -1;
+    }
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_FILES, slots, (unsigned int)count) < 0) {
+        mf_uring_teardown(&ring);
+        return -1;
+    }
+
+    tail = *ring.sq_tail;
+    for (i = 0; i < count; ++i) {
+        struct io_uring_sqe *sqe;
+
+        reqs[i].result = -ECANCELED;
+
+        sqe = mf_uring_push(&ring, &tail);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long)reqs[i].path;
+        /* O_CLOEXEC is rejected for direct descriptors; they never reach
+         * the process fd table anyway. */
+        sqe->open_flags = O_RDONLY;
+        sqe->file_index = (unsigned int)i + 1U;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = ((unsigned long long)i << 2) | MF_URING_OP_OPEN;
+
+        /* Hard link: procfs reads are nearly always short, which would
+         * otherwise cancel the close and leak the slot. */
+        sqe = mf_uring_push(&ring, &tail);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = (int)i;
+        sqe->addr = (unsigned long)reqs[i].buf;
+        sqe->len = (unsigned int)(reqs[i].cap - 1U);
+        sqe->off = 0;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        sqe->user_data = ((unsigned long long)i << 2) | MF_URING_OP_READ;
+
+        sqe = mf_uring_push(&ring, &tail);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = (unsigned int)i + 1U;
+        sqe->user_data = ((unsigned long long)i << 2) | MF_URING_OP_CLOSE;
+    }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    expected = (unsigned int)(count * 3U);
+    if (syscall(__NR_io_uring_enter, ring.fd, expected, expected, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+        mf_uring_teardown(&ring);
+        return -1;
+    }
+
+    seen = 0U;
+    while (seen < expected) {
+        unsigned int head;
+        unsigned int cq_tail;
+
+        head = *ring.cq_head;
+        cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        if (head == cq_tail) {
+            if (syscall(__NR_io_uring_enter, ring.fd, 0, expected - seen, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+                break;
+            }
+            continue;
+        }
+        while (head != cq_tail) {
+            const struct io_uring_cqe *cqe;
+            size_t idx;
+            unsigned int op;
+
+            cqe = &ring.cqes[head & *ring.cq_mask];
+            idx = (size_t)(cqe->user_data >> 2);
+            op = (unsigned int)(cqe->user_data & 3U);
+            if (idx < count) {
+                if (op == MF_URING_OP_OPEN && cqe->res < 0) {
+                    reqs[idx].result = cqe->res;
+                } else if (op == MF_URING_OP_READ && reqs[idx].result == -ECANCELED) {
+                    reqs[idx].result = cqe->res;
+                }
+            }
+            head++;
+            seen++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    for (i = 0; i < count; ++i) {
+        if (reqs[i].result >= 0) {
+            reqs[i].buf[reqs[i].result] = '\0';
+        }
+    }
+
+    mf_uring_teardown(&ring);
+    return 0;
+}
+#else
+int mf_uring_read_batch(struct mf_uring_req *reqs, size_t count)
+{
+    (void)reqs;
+    (void)count;
+    errno = ENOSYS;
+    return -1;
+}
+#endif
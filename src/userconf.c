@@ -0,0 +1,474 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "userconf.h"
+#include "fmt.h"
+#include "hidden.h"
+#include "outbuf.h"
+
+#define MF_USERCONF_MAGIC 0x3147464dU /* "MFG1" */
+#define MF_USERCONF_PATH_MAX 512
+#define MF_USERCONF_TEXT_MAX 16384U
+/* Longest SGR parameter list: "\x1b[" + 24 + "m" fits the escape. */
+#define MF_USERCONF_SGR_PARAMS_MAX 24U
+
+/* FILE.bin: the compiled config behind a header that ties it to the file
+ * it came from (by stat) and to this build's layout and field table. */
+struct mf_userconf_blob {
+    uint32_t magic;
+    uint32_t layout;
+    uint64_t src_dev;
+    uint64_t src_ino;
+    uint64_t src_size;
+    uint64_t src_mtime_s;
+    uint64_t src_mtime_ns;
+    struct mf_userconf conf;
+};
+
+static struct mf_userconf_blob g_userconf_compiled;
+
+/* Where the config file would be; -1 when no location can be named. */
+static int mf_userconf_path(char *out, size_t outsz)
+{
+    const char *env;
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    env = getenv("MINIFETCH_CONFIG");
+    if (env != NULL && env[0] != '\0') {
+        mf_fmt_str(&f, env);
+    } else if ((env = getenv("XDG_CONFIG_HOME")) != NULL && env[0] == '/') {
+        mf_fmt_str(&f, env);
+        mf_fmt_str(&f, "/minifetch/config");
+    } else if ((env = getenv("HOME")) != NULL && env[0] == '/') {
+        mf_fmt_str(&f, env);
+        mf_fmt_str(&f, "/.config/minifetch/config");
+    } else {
+        return -1;
+    }
+    /* Room for the ".bin" of the cache as well. */
+    return f.len + 5U < outsz ? 0 : -1;
+}
+
+/* FNV-1a over the blob size and the field names: a cache written by a
+ * build with another layout or field table is never mapped. */
+static uint32_t mf_userconf_layout(const char *const names[], size_t count)
+{
+    uint32_t h = 2166136261U ^ (uint32_t)sizeof(struct mf_userconf_blob);
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        const char *p;
+
+        for (p = names[i]; *p != '\0'; ++p) {
+            h = (h ^ (unsigned char)*p) * 16777619U;
+        }
+        h = (h ^ 0xffU) * 16777619U;
+    }
+    return h;
+}
+
+static void mf_userconf_stamp(struct mf_userconf_blob *blob, const struct stat *st, uint32_t layout)
+{
+    blob->magic = MF_USERCONF_MAGIC;
+    blob->layout = layout;
+    blob->src_dev = (uint64_t)st->st_dev;
+    blob->src_ino = (uint64_t)st->st_ino;
+    blob->src_size = (uint64_t)st->st_size;
+    blob->src_mtime_s = (uint64_t)st->st_mtim.tv_sec;
+    blob->src_mtime_ns = (uint64_t)st->st_mtim.tv_nsec;
+}
+
+static int mf_userconf_terminated(const char *s, size_t cap)
+{
+    return memchr(s, '\0', cap) != NULL;
+}
+
+/* The checks a mapped cache needs before anything indexes with it. */
+static int mf_userconf_sane(const struct mf_userconf *conf, size_t count)
+{
+    size_t i;
+
+    if (conf->field_count > MF_USERCONF_FIELDS_MAX || conf->field_count > count || conf->label_width >= MF_USERCONF_LABEL_MAX ||
+        conf->gradient > (uint32_t)MF_HIDDEN_GRADIENT_TRUECOLOR) {
+        return 0;
+    }
+    for (i = 0; i < conf->field_count; ++i) {
+        if (conf->field[i] >= count) {
+            return 0;
+        }
+    }
+    for (i = 0; i < MF_USERCONF_FIELDS_MAX; ++i) {
+        if (!mf_userconf_terminated(conf->label[i], sizeof(conf->label[i]))) {
+            return 0;
+        }
+    }
+    return mf_userconf_terminated(conf->label_colour, sizeof(conf->label_colour)) &&
+           mf_userconf_terminated(conf->value_colour, sizeof(conf->value_colour)) &&
+           mf_userconf_terminated(conf->engine, sizeof(conf->engine));
+}
+
+/* Maps FILE.bin if it was compiled from the file st describes. Trusted
+ * like a state file: owned by the caller and writable by no one else. */
+static const struct mf_userconf *mf_userconf_map(const char *bin, const struct stat *st, uint32_t layout, size_t count)
+{
+    struct mf_userconf_blob want;
+    const struct mf_userconf_blob *blob;
+    struct stat bst;
+    void *map;
+    int fd;
+
+    fd = open(bin, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &bst) != 0 || !S_ISREG(bst.st_mode) || bst.st_uid != geteuid() || (bst.st_mode & (S_IWGRP | S_IWOTH)) != 0 ||
+        bst.st_size != (off_t)sizeof(struct mf_userconf_blob)) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, sizeof(struct mf_userconf_blob), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    blob = (const struct mf_userconf_blob *)map;
+    mf_userconf_stamp(&want, st, layout);
+    if (blob->magic != want.magic || blob->layout != want.layout || blob->src_dev != want.src_dev || blob->src_ino != want.src_ino ||
+        blob->src_size != want.src_size || blob->src_mtime_s != want.src_mtime_s || blob->src_mtime_ns != want.src_mtime_ns ||
+        !mf_userconf_sane(&blob->conf, count)) {
+        munmap(map, sizeof(struct mf_userconf_blob));
+        return NULL;
+    }
+    return &blob->conf;
+}
+
+static void mf_userconf_report(const char *path, unsigned int line, const char *what, const char *detail)
+{
+    char msg[MF_USERCONF_PATH_MAX + 128];
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, msg, sizeof(msg));
+    mf_fmt_str(&f, "minifetch: ");
+    mf_fmt_str(&f, path);
+    if (line > 0U) {
+        mf_fmt_str(&f, ":");
+        mf_fmt_uint(&f, line);
+    }
+    mf_fmt_str(&f, ": ");
+    mf_fmt_str(&f, what);
+    if (detail != NULL) {
+        mf_fmt_str(&f, " '");
+        mf_fmt_str(&f, detail);
+        mf_fmt_str(&f, "'");
+    }
+    mf_fmt_str(&f, "; using the built-in defaults\n");
+    mf_write_all(STDERR_FILENO, msg, f.len);
+}
+
+static int mf_userconf_field(const char *name, const char *const names[], size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        if (strcmp(names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int mf_userconf_number(const char *value, uint64_t max, uint32_t *out)
+{
+    uint64_t number;
+
+    if (value[0] == '\0' || value[mf_parse_u64(value, &number)] != '\0' || number > max) {
+        return -1;
+    }
+    *out = (uint32_t)number;
+    return 0;
+}
+
+/* Builds the escape for an SGR parameter list; "none" leaves it empty. */
+static int mf_userconf_colour(const char *value, char out[MF_USERCONF_SGR_MAX])
+{
+    size_t len = strlen(value);
+    struct mf_fmt f;
+
+    if (strcmp(value, "none") == 0) {
+        out[0] = '\0';
+        return 0;
+    }
+    if (len == 0U || len > MF_USERCONF_SGR_PARAMS_MAX || strspn(value, "0123456789;:") != len) {
+        return -1;
+    }
+    mf_fmt_init(&f, out, MF_USERCONF_SGR_MAX);
+    mf_fmt_str(&f, "\x1b[");
+    mf_fmt_str(&f, value);
+    mf_fmt_str(&f, "m");
+    return 0;
+}
+
+/* "fields = a b c": names separated by blanks or commas, each once. */
+static const char *mf_userconf_fields(char *value, const char *const names[], size_t count, struct mf_userconf *conf)
+{
+    unsigned char seen[MF_USERCONF_FIELDS_MAX];
+    char *p = value;
+
+    memset(seen, 0, sizeof(seen));
+    conf->field_count = 0U;
+    for (;;) {
+        char *name;
+        int idx;
+
+        p += strspn(p, " \t,");
+        if (*p == '\0') {
+            return NULL;
+        }
+        name = p;
+        p += strcspn(p, " \t,");
+        if (*p != '\0') {
+            *p++ = '\0';
+        }
+        idx = mf_userconf_field(name, names, count);
+        if (idx < 0 || seen[idx]) {
+            return name;
+        }
+        seen[idx] = 1U;
+        conf->field[conf->field_count++] = (uint8_t)idx;
+    }
+}
+
+static char *mf_userconf_trim(char *s)
+{
+    size_t len;
+
+    s += strspn(s, " \t");
+    len = strlen(s);
+    while (len > 0U && (s[len - 1U] == ' ' || s[len - 1U] == '\t' || s[len - 1U] == '\r')) {
+        s[--len] = '\0';
+    }
+    return s;
+}
+
+/* Applies one "key = value" line. Returns NULL or what is wrong with it;
+ * *detail then names the offending part. */
+static const char *mf_userconf_line(char *key, char *value, const char *const names[], size_t count, struct mf_userconf *conf,
+                                    const char **detail)
+{
+    *detail = NULL;
+    if (strcmp(key, "fields") == 0) {
+        *detail = mf_userconf_fields(value, names, count, conf);
+        conf->has |= MF_USERCONF_HAS_FIELDS;
+        return *detail != NULL ? "unknown or repeated field" : NULL;
+    }
+    if (strncmp(key, "label.", 6) == 0) {
+        int idx = mf_userconf_field(key + 6, names, count);
+        size_t len = strlen(value);
+        size_t i;
+
+        if (idx < 0) {
+            *detail = key + 6;
+            return "unknown field";
+        }
+        if (len == 0U || len >= MF_USERCONF_LABEL_MAX) {
+            return "labels take 1 to 31 characters";
+        }
+        for (i = 0; i < len; ++i) {
+            if (value[i] < 0x20 || value[i] > 0x7e) {
+                return "labels are printable ASCII";
+            }
+        }
+        memcpy(conf->label[idx], value, len + 1U);
+        return NULL;
+    }
+    if (strcmp(key, "label_width") == 0) {
+        conf->has |= MF_USERCONF_HAS_WIDTH;
+        return mf_userconf_number(value, MF_USERCONF_LABEL_MAX - 1U, &conf->label_width) != 0 ? "label_width takes 0 to 31" : NULL;
+    }
+    if (strcmp(key, "colour.label") == 0 || strcmp(key, "colour.value") == 0) {
+        int label = key[7] == 'l';
+
+        conf->has |= label ? MF_USERCONF_HAS_LABEL_COLOUR : MF_USERCONF_HAS_VALUE_COLOUR;
+        *detail = value;
+        return mf_userconf_colour(value, label ? conf->label_colour : conf->value_colour) != 0 ? "not an SGR parameter list"
+                                                                                               : NULL;
+    }
+    if (strcmp(key, "hidden.seed") == 0) {
+        conf->has |= MF_USERCONF_HAS_SEED;
+        return mf_userconf_number(value, UINT32_MAX, &conf->seed) != 0 ? "hidden.seed takes 0 to 4294967295" : NULL;
+    }
+    if (strcmp(key, "hidden.refresh") == 0) {
+        conf->has |= MF_USERCONF_HAS_REFRESH;
+        return mf_userconf_number(value, 86400U, &conf->refresh) != 0 ? "hidden.refresh takes 0 to 86400" : NULL;
+    }
+    if (strcmp(key, "hidden.gradient") == 0) {
+        conf->has |= MF_USERCONF_HAS_GRADIENT;
+        if (strcmp(value, "mono") == 0) {
+            conf->gradient = MF_HIDDEN_GRADIENT_MONO;
+        } else if (strcmp(value, "256") == 0) {
+            conf->gradient = MF_HIDDEN_GRADIENT_256;
+        } else if (strcmp(value, "truecolor") == 0) {
+            conf->gradient = MF_HIDDEN_GRADIENT_TRUECOLOR;
+        } else {
+            *detail = value;
+            return "hidden.gradient is mono, 256 or truecolor";
+        }
+        return NULL;
+    }
+    if (strcmp(key, "hidden.engine") == 0) {
+        /* The names --engine accepts, bar "list". */
+        if (strcmp(value, "value") != 0 && strcmp(value, "simplex") != 0 && strcmp(value, "plasma") != 0 &&
+            strcmp(value, "auto") != 0) {
+            *detail = value;
+            return "hidden.engine is value, simplex, plasma or auto";
+        }
+        conf->has |= MF_USERCONF_HAS_ENGINE;
+        memcpy(conf->engine, value, strlen(value) + 1U);
+        return NULL;
+    }
+    *detail = key;
+    return "unknown key";
+}
+
+/* Validates text (NUL-terminated, modified in place) into conf. */
+static int mf_userconf_compile(const char *path, char *text, const char *const names[], size_t count, struct mf_userconf *conf)
+{
+    unsigned int line = 0U;
+    char *p = text;
+
+    memset(conf, 0, sizeof(*conf));
+    while (*p != '\0') {
+        char *next = p + strcspn(p, "\n");
+        const char *what;
+        const char *detail;
+        char *eq;
+        char *key;
+
+        if (*next == '\n') {
+            *next++ = '\0';
+        }
+        ++line;
+        key = mf_userconf_trim(p);
+        p = next;
+        if (key[0] == '\0' || key[0] == '#') {
+            continue;
+        }
+        eq = strchr(key, '=');
+        if (eq == NULL) {
+            mf_userconf_report(path, line, "expected key = value", NULL);
+            return -1;
+        }
+        *eq = '\0';
+        what = mf_userconf_line(mf_userconf_trim(key), mf_userconf_trim(eq + 1), names, count, conf, &detail);
+        if (what != NULL) {
+            mf_userconf_report(path, line, what, detail);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int mf_userconf_read(const char *path, char *text, size_t cap)
+{
+    size_t used = 0U;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    while (used + 1U < cap) {
+        ssize_t n = read(fd, text + used, cap - 1U - used);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    close(fd);
+    text[used] = '\0';
+    /* A file that filled the buffer is too large to be taken whole. */
+    return used + 1U < cap && memchr(text, '\0', used) == NULL ? 0 : -1;
+}
+
+/* Writes FILE.bin next to the config, atomically. A directory the
+ * caller cannot write just means compiling on every run. */
+static void mf_userconf_save(const char *bin, const struct mf_userconf_blob *blob)
+{
+    char tmp[MF_USERCONF_PATH_MAX + 24];
+    struct mf_fmt f;
+    int fd;
+    int rc;
+
+    mf_fmt_init(&f, tmp, sizeof(tmp));
+    mf_fmt_str(&f, bin);
+    mf_fmt_str(&f, ".");
+    mf_fmt_uint(&f, (uint64_t)getpid());
+    if (f.len + 1U >= sizeof(tmp)) {
+        return;
+    }
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    rc = mf_write_all(fd, (const char *)blob, sizeof(*blob));
+    if (close(fd) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 || rename(tmp, bin) != 0) {
+        unlink(tmp);
+    }
+}
+
+const struct mf_userconf *mf_userconf_load(const char *const names[], size_t count)
+{
+    static char text[MF_USERCONF_TEXT_MAX];
+    char path[MF_USERCONF_PATH_MAX];
+    char bin[MF_USERCONF_PATH_MAX];
+    const struct mf_userconf *mapped;
+    struct stat st;
+    uint32_t layout;
+    struct mf_fmt f;
+
+    if (count > MF_USERCONF_FIELDS_MAX || mf_userconf_path(path, sizeof(path)) != 0 || stat(path, &st) != 0) {
+        return NULL;
+    }
+
+    mf_fmt_init(&f, bin, sizeof(bin));
+    mf_fmt_str(&f, path);
+    mf_fmt_str(&f, ".bin");
+    layout = mf_userconf_layout(names, count);
+    mapped = mf_userconf_map(bin, &st, layout, count);
+    if (mapped != NULL) {
+        return mapped;
+    }
+
+    if (mf_userconf_read(path, text, sizeof(text)) != 0) {
+        mf_userconf_report(path, 0U, "cannot be read, holds NUL bytes or is over 16 KiB", NULL);
+        return NULL;
+    }
+    if (mf_userconf_compile(path, text, names, count, &g_userconf_compiled.conf) != 0) {
+        return NULL;
+    }
+    mf_userconf_stamp(&g_userconf_compiled, &st, layout);
+    mf_userconf_save(bin, &g_userconf_compiled);
+    return &g_userconf_compiled.conf;
+}
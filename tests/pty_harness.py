@@ -0,0 +1,139 @@
+"""Pseudo-terminal helpers shared by the python checks in smoke.sh.
+
+Waits are bounded by generous deadlines and end as soon as the output
+they wait for shows up, so a loaded machine makes the checks slower but
+not flaky.
+"""
+import fcntl, os, re, select, signal, struct, subprocess, sys, termios, time
+
+# Long enough for a loaded CI machine; a passing check never waits it out.
+TIMEOUT = 15.0
+
+
+def fail(msg):
+    sys.exit("error: " + msg)
+
+
+def set_size(fd, rows, cols):
+    fcntl.ioctl(fd, termios.TIOCSWINSZ, struct.pack("HHHH", rows, cols, 0, 0))
+
+
+def display(rows, cols):
+    """A pty for --sink: returns its (master, slave) descriptors."""
+    master, slave = os.openpty()
+    set_size(slave, rows, cols)
+    return master, slave
+
+
+def controlling_tty():
+    """Makes the child's stdin its controlling terminal, as a login does."""
+    os.setsid()
+    fcntl.ioctl(0, termios.TIOCSCTTY, 0)
+
+
+class Term:
+    """A program running on a pty of its own, output collected in .got.
+    With session=True it runs in a session of its own with the pty as its
+    controlling terminal."""
+
+    def __init__(self, args, rows=24, cols=80, env=None, session=False):
+        self.master, slave = os.openpty()
+        set_size(slave, rows, cols)
+        self.proc = subprocess.Popen(args, stdin=slave, stdout=slave, stderr=slave, env=env,
+                                     preexec_fn=controlling_tty if session else None)
+        os.close(slave)
+        self.got = b""
+        self.answers = []
+        self.asked = 0
+
+    def answer(self, *replies):
+        """Queues one reply per terminal query (a DA1, CSI c, closes each)."""
+        self.answers += replies
+
+    def read(self, wait):
+        """Collects output for at most wait seconds; False once it ends."""
+        ready, _, _ = select.select([self.master], [], [], wait)
+        if self.master not in ready:
+            return True
+        try:
+            data = os.read(self.master, 1 << 20)
+        except OSError:
+            return False
+        if not data:
+            return False
+        self.got += data
+        if self.answers and self.got.count(b"\x1b[c") > self.asked:
+            os.write(self.master, self.answers.pop(0))
+            self.asked += 1
+        return True
+
+    def until(self, done, timeout=TIMEOUT):
+        """Reads until done(output) holds; returns whether it did."""
+        deadline = time.time() + timeout
+        while not done(self.got):
+            if time.time() > deadline or not self.read(0.02):
+                return done(self.got)
+        return True
+
+    def pump(self, seconds):
+        """Reads for a fixed time, for output that should keep flowing."""
+        deadline = time.time() + seconds
+        while time.time() < deadline and self.read(0.01):
+            pass
+
+    def send(self, data):
+        os.write(self.master, data)
+
+    def resize(self, rows, cols):
+        set_size(self.master, rows, cols)
+        self.proc.send_signal(signal.SIGWINCH)
+
+    def finish(self, quit=None, timeout=TIMEOUT):
+        """Stops the program (with the quit key, else SIGTERM unless quit
+        is False) and returns its exit status once the output is drained."""
+        if quit:
+            self.send(quit)
+        elif quit is None:
+            self.proc.send_signal(signal.SIGTERM)
+        deadline = time.time() + timeout
+        while self.proc.poll() is None:
+            if time.time() > deadline:
+                self.proc.kill()
+                self.proc.wait()
+                fail("%s did not finish" % " ".join(self.proc.args))
+            self.read(0.02)
+        while self.read(0):
+            pass
+        os.close(self.master)
+        return self.proc.returncode
+
+
+def run(args, rows=24, cols=80, env=None, replies=(), session=False):
+    """Runs a program that exits by itself; returns (status, output)."""
+    term = Term(args, rows, cols, env, session)
+    term.answer(*replies)
+    status = term.finish(quit=False)
+    return status, term.got
+
+
+def screen(data):
+    """Replays cursor moves, clears and text onto a screen and returns its
+    rows, as far as anything was drawn."""
+    cells = {}
+    row = col = 0
+    for m in re.finditer(rb"\x1b\[(\d+);(\d+)H|\x1b\[2J|\x1b\[[0-9;?]*[A-Za-z]|([\x00-\x7f]|[\xc0-\xff][\x80-\xbf]*)", data):
+        if m.group(1):
+            row, col = int(m.group(1)), int(m.group(2))
+        elif m.group(0) == b"\x1b[2J":
+            cells = {}
+        elif m.group(3) and m.group(3) >= b" ":
+            cells[(row, col)] = m.group(3).decode("utf-8", "replace")
+            col += 1
+    rows = max([r for r, _ in cells] + [0])
+    cols = max([c for _, c in cells] + [0])
+    return ["".join(cells.get((r, c), " ") for c in range(1, cols + 1)) for r in range(1, rows + 1)]
+
+
+def moves(data):
+    """Every cursor move in data, as (row, col)."""
+    return [(int(r), int(c)) for r, c in re.findall(rb"\x1b\[(\d+);(\d+)H", data)]
@@ -4,13 +4,43 @@ set -eu
 ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
 BIN="${MINIFETCH_BIN:-${ROOT_DIR}/minifetch}"
 LINUX_BIN="${MINIFETCH_LINUX_BIN:-${ROOT_DIR}/minifetch-linux}"
+TINY_BIN="${MINIFETCH_TINY_BIN:-${ROOT_DIR}/minifetch-tiny}"
 ANSI_ESC="$(printf '\033')"
 
+# Keep the collectors' saved samples out of the caller's runtime dir
+MINIFETCH_STATE_DIR="$(mktemp -d)"
+export MINIFETCH_STATE_DIR
+# and the daemon's snapshot away from a real one
+MINIFETCH_SHM="/minifetch-smoke-$$"
+export MINIFETCH_SHM
+# and the caller's own config file out of every run
+MINIFETCH_CONFIG="$MINIFETCH_STATE_DIR/no-config"
+export MINIFETCH_CONFIG
+daemon_pid=""
+trap 'rm -rf "$MINIFETCH_STATE_DIR"; [ -z "$daemon_pid" ] || kill "$daemon_pid" 2>/dev/null || :' EXIT
+
 if [ ! -x "$BIN" ]; then
     echo "error: build minifetch before running smoke tests" >&2
     exit 1
 fi
 
+# The checks written in python drive minifetch on pseudo-terminals
+# through tests/pty_harness.py; without python3 they, and the fixture
+# checks, are skipped
+if command -v python3 >/dev/null 2>&1; then
+    have_python=1
+else
+    have_python=""
+    echo "smoke: python3 not found, skipping the checks that need it" >&2
+fi
+pty_check() {
+    if [ -z "$have_python" ]; then
+        cat >/dev/null
+        return 0
+    fi
+    PYTHONPATH="$ROOT_DIR/tests" python3 - "$@"
+}
+
 # Basic run should include non-empty logo column and kernel line
 output="$("$BIN")"
 printf '%s\n' "$output" | head -n 1 | grep "[^[:space:]]" >/dev/null 2>&1 || {
@@ -36,6 +66,303 @@ printf '%s\n' "$hidden_output" | grep "Kernel:" >/dev/null 2>&1 || {
     exit 1
 }
 
+# --sink renders hidden mode once for several terminals of different
+# sizes; a display that stops reading must not hold back the others
+if "$BIN" --sink /nonexistent/tty >/dev/null 2>&1; then
+    echo "error: expected --sink to fail on a path it cannot open" >&2
+    exit 1
+fi
+pty_check "$BIN" <<'PY'
+import os, select, signal, subprocess, sys, time
+from pty_harness import TIMEOUT, display, fail, moves
+
+sizes = [(30, 100), (20, 60), (24, 80)]
+ptys = [display(rows, cols) for rows, cols in sizes]
+# The last display is stalled with XOFF and never read.
+os.write(ptys[2][0], b"\x13")
+args = [sys.argv[1]]
+for _, slave in ptys:
+    args += ["--sink", os.ttyname(slave)]
+proc = subprocess.Popen(args, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
+# Frames keep coming next to the stalled display: each live one gets
+# twice what it had once its first frame was in.
+got = [b"", b""]
+first = [0, 0]
+deadline = time.time() + TIMEOUT
+while not all(first[k] and len(got[k]) >= 2 * first[k] for k in (0, 1)) and time.time() < deadline:
+    ready, _, _ = select.select([ptys[0][0], ptys[1][0]], [], [], 0.05)
+    for k in (0, 1):
+        if ptys[k][0] in ready:
+            got[k] += os.read(ptys[k][0], 65536)
+            if not first[k] and b"press q" in got[k]:
+                first[k] = len(got[k])
+proc.send_signal(signal.SIGTERM)
+try:
+    status = proc.wait(timeout=TIMEOUT)
+except subprocess.TimeoutExpired:
+    proc.kill()
+    fail("--sink run blocked on the stalled display")
+if status != 0:
+    fail("--sink run did not exit cleanly")
+for k in (0, 1):
+    rows, cols = sizes[k]
+    drawn = moves(got[k])
+    if not drawn or max(r for r, _ in drawn) > rows or max(c for _, c in drawn) > cols:
+        fail("sink %d got cursor moves outside its %dx%d screen" % (k, rows, cols))
+    if b"Kernel:" not in got[k] or len(got[k]) < 2 * first[k]:
+        fail("sink %d stopped receiving frames next to a stalled one" % k)
+PY
+
+# --export renders hidden mode offline; a fixed seed gives the same file
+cast="$MINIFETCH_STATE_DIR/hidden.cast"
+svg="$MINIFETCH_STATE_DIR/hidden.svg"
+"$BIN" --export "$cast" --frames 30 --seed 7
+"$BIN" --export "$cast.again" --frames 30 --seed 7
+if ! cmp -s "$cast" "$cast.again"; then
+    echo "error: --export differs between runs with the same seed" >&2
+    exit 1
+fi
+"$BIN" --export "$svg" --frames 5 --size 40x10
+"$BIN" --export "$cast.256" --frames 30 --seed 7 --gradient 256
+if "$BIN" --export "$cast.bad" --gradient sepia >/dev/null 2>&1; then
+    echo "error: expected --gradient to reject an unknown mode" >&2
+    exit 1
+fi
+# --engine swaps the background field; each one is seeded and repeatable
+if [ "$("$BIN" --engine list | grep -c "ns/cell")" -ne 3 ]; then
+    echo "error: expected --engine list to time three engines" >&2
+    exit 1
+fi
+if "$BIN" --export "$cast.bad" --engine bogus >/dev/null 2>&1; then
+    echo "error: expected --engine to reject an unknown engine" >&2
+    exit 1
+fi
+"$BIN" --export "$cast.value" --frames 10 --seed 7 --engine value
+for engine in simplex plasma; do
+    "$BIN" --export "$cast.$engine" --frames 10 --seed 7 --engine "$engine"
+    "$BIN" --export "$cast.$engine.again" --frames 10 --seed 7 --engine "$engine"
+    if ! cmp -s "$cast.$engine" "$cast.$engine.again" || cmp -s "$cast.$engine" "$cast.value"; then
+        echo "error: --engine $engine should draw its own repeatable field" >&2
+        exit 1
+    fi
+done
+"$BIN" --export "$cast.auto" --frames 3 --engine auto
+
+# A config file picks, orders and relabels fields and sets hidden-mode
+# defaults; it is compiled once to FILE.bin, which is rebuilt when the
+# file changes, and a broken one is reported and ignored
+conf="$MINIFETCH_STATE_DIR/config"
+printf 'fields = kernel, os\nlabel.os = System:\nlabel_width = 12\n' >"$conf"
+conf_out="$(MINIFETCH_CONFIG="$conf" "$BIN" | grep -E 'Kernel:|System:|OS:|Host:')"
+if [ ! -f "$conf.bin" ] || [ "$(printf '%s\n' "$conf_out" | sed -n 's/.*\(Kernel: *\).*/\1/p;s/.*\(System: *\).*/\1/p')" != "$(printf 'Kernel:      \nSystem:      ')" ]; then
+    echo "error: config file fields, labels or width not applied" >&2
+    exit 1
+fi
+if [ "$(MINIFETCH_CONFIG="$conf" "$BIN" | grep -E 'Kernel:|System:|OS:|Host:')" != "$conf_out" ]; then
+    echo "error: the cached config renders differently" >&2
+    exit 1
+fi
+if [ "$(MINIFETCH_CONFIG="$conf" "$BIN" -a | grep -c 'Host:')" -ne 1 ]; then
+    echo "error: -a should still show fields the config leaves out" >&2
+    exit 1
+fi
+printf 'label.kernel = Linux:\n' >>"$conf"
+if ! MINIFETCH_CONFIG="$conf" "$BIN" | grep 'Linux: ' >/dev/null 2>&1; then
+    echo "error: an edited config file should replace its cache" >&2
+    exit 1
+fi
+printf 'hidden.seed = 7\n' >"$conf.seed"
+MINIFETCH_CONFIG="$conf.seed" "$BIN" --export "$cast.conf" --frames 30
+if ! cmp -s "$cast" "$cast.conf"; then
+    echo "error: hidden.seed in the config should act like --seed" >&2
+    exit 1
+fi
+printf 'colour.label = red\n' >"$conf.bad"
+bad_err="$(MINIFETCH_CONFIG="$conf.bad" "$BIN" 2>&1 >/dev/null)"
+case "$bad_err" in
+*"config.bad:1: not an SGR parameter list 'red'"*) ;;
+*)
+    echo "error: expected a broken config to be reported, got: $bad_err" >&2
+    exit 1
+    ;;
+esac
+pty_check "$cast" "$svg" "$cast.256" <<'PY'
+import json, re, sys
+import xml.dom.minidom
+
+lines = open(sys.argv[1], encoding="utf-8").read().splitlines()
+header = json.loads(lines[0])
+events = [json.loads(line) for line in lines[1:]]
+if header != {"version": 2, "width": 80, "height": 24} or len(events) != 30:
+    sys.exit("error: unexpected asciicast header or event count")
+if [e[0] for e in events] != sorted(e[0] for e in events) or any(e[1] != "o" for e in events):
+    sys.exit("error: asciicast events out of order")
+if "Kernel:" not in events[0][2]:
+    sys.exit("error: asciicast first frame lacks the info panel")
+doc = xml.dom.minidom.parse(sys.argv[2])
+if len(doc.getElementsByTagName("text")) != 5 * 10:
+    sys.exit("error: expected 5 SVG frames of 10 rows")
+# Colour goes out once per run of same-coloured cells, not per cell
+first = json.loads(open(sys.argv[3], encoding="utf-8").read().splitlines()[1])[2]
+sgrs = len(re.findall("\x1b\\[38;5;[0-9]+m", first))
+cells = len(re.sub("\x1b\\[[0-9;?]*[A-Za-z]", "", first))
+if sgrs == 0 or sgrs * 4 > cells:
+    sys.exit("error: --gradient 256 sent %d colour changes for %d cells" % (sgrs, cells))
+PY
+
+# --record saves the frames hidden mode draws; --replay plays them back,
+# clipped to a smaller terminal, and stops at the end of the file
+pty_check "$BIN" "$MINIFETCH_STATE_DIR/hidden.mfr" <<'PY'
+import os, sys, time
+from pty_harness import Term, fail, moves, run
+
+term = Term([sys.argv[1], "--record", sys.argv[2]], 30, 100)
+term.until(lambda got: b"Kernel:" in got)
+term.pump(1.5)
+if term.finish(b"q") != 0 or os.path.getsize(sys.argv[2]) == 0:
+    fail("--record run failed")
+start = time.time()
+rc, got = run([sys.argv[1], "--replay", sys.argv[2]], 20, 60)
+took = time.time() - start
+drawn = moves(got)
+# The recording spans most of its 1.5 s; a replay that ignores the
+# recorded pace is done in a few milliseconds.
+if rc != 0 or b"Kernel:" not in got or took < 0.5:
+    fail("--replay did not play the recording back at its pace")
+if max(r for r, _ in drawn) > 20 or max(c for _, c in drawn) > 60:
+    fail("--replay drew outside the terminal")
+PY
+if "$BIN" --replay "$cast" >/dev/null 2>&1; then
+    echo "error: expected --replay to reject a file that is not a recording" >&2
+    exit 1
+fi
+
+# Replayed cells go straight to the terminal, so a recording that
+# carries a control byte, bare or escaped, is refused
+printf 'MFR1\002\001F\000\001\000\002AB' >"$cast"
+if ! "$BIN" --replay "$cast" >/dev/null 2>&1; then
+    echo "error: expected --replay to play a well-formed recording" >&2
+    exit 1
+fi
+for cells in 'A\033' '\377\001\033A' '\377\002\302\233A'; do
+    printf "MFR1\\002\\001F\\000\\001\\000\\002$cells" >"$cast"
+    if "$BIN" --replay "$cast" >/dev/null 2>&1; then
+        echo "error: expected --replay to reject a recording with control bytes" >&2
+        exit 1
+    fi
+done
+
+# A burst of resizes is drawn once, at the size it ends on: growing
+# keeps what is on screen and paints the rest, shrinking clears once
+pty_check "$BIN" <<'PY'
+import sys
+from pty_harness import Term, fail, screen
+
+
+def storm(sizes, settled):
+    term = Term([sys.argv[1], "--hidden"], sizes[0][0], sizes[0][1])
+    term.until(lambda got: b"press q" in got)
+    before = len(term.got)
+    for rows, cols in sizes[1:]:
+        term.resize(rows, cols)
+        term.pump(0.03)
+    term.until(lambda got: settled(got[before:]))
+    if term.finish() != 0:
+        fail("hidden mode did not survive a resize burst")
+    return term.got[:before], term.got[before:]
+
+
+def grown(after):
+    lines = screen(after)
+    return len(lines) == 30 and "press q" in lines[29]
+
+
+before, after = storm([(20, 60)] + [(20 + i, 60 + 4 * i) for i in range(1, 11)], grown)
+lines = screen(before + after)
+if b"\x1b[2J" in after or len(lines) != 30 or max(len(line) for line in lines) != 100:
+    fail("a growing terminal should be painted at its new size without a clear")
+if [i for i, line in enumerate(lines) if "press q" in line] != [29] or sum("Kernel:" in line for line in lines) != 1:
+    fail("a grown terminal kept stale parts of the old frame")
+before, after = storm([(30, 100)] + [(30 - i, 100 - 4 * i) for i in range(1, 11)],
+                      lambda after: b"press q" in after.partition(b"\x1b[2J")[2])
+if after.count(b"\x1b[2J") != 1:
+    fail("a shrinking terminal should be cleared once, not per size")
+PY
+
+# The terminal is asked what it supports once; later runs in the same
+# terminal answer from the cache without writing a query. Hidden mode
+# then uses REP, and a focus report in its input does not stop it
+pty_check "$BIN" <<'PY'
+import os, re, sys
+from pty_harness import Term, fail, run
+
+ANSWER = (b"\x1b[5;1R\x1b[5;3R\x1bP1$r0;38:2::1:2:3m\x1b\\\x1b[?2026;2$y\x1b[?1004;2$y"
+          b"\x1bP>|SmokeTerm(1.0)\x1b\\\x1b[>41;390;0c\x1b[?62;22c")
+ENV = dict(os.environ, TERM="xterm-smoke", TERM_PROGRAM="smoke", TERM_PROGRAM_VERSION="1")
+ENV.pop("COLORTERM", None)
+ENV.pop("VTE_VERSION", None)
+
+
+def termcaps(env, *answers):
+    rc, got = run([sys.argv[1], "--termcaps"], env=env, replies=answers)
+    if rc != 0:
+        fail("--termcaps failed")
+    return got.decode("utf-8", "replace")
+
+
+got = termcaps(ENV, ANSWER)
+if "SmokeTerm(1.0) (probed)" not in got or got.count(": yes") != 4:
+    fail("--termcaps did not read the terminal's answers: %r" % got)
+got = termcaps(ENV)
+if "\x1b[c" in got or "SmokeTerm(1.0) (cached)" not in got or got.count(": yes") != 4:
+    fail("a second run in the same terminal should use the cache: %r" % got)
+got = termcaps(dict(ENV, TERM_PROGRAM_VERSION="2"))
+if "\x1b[c" not in got or "(no answer)" not in got or ": yes" in got:
+    fail("a new terminal version should be probed again: %r" % got)
+
+# Without $TERM_PROGRAM the tty and its login session key the cache, so
+# runs in one session skip the probe and a new session probes afresh.
+# REP is never remembered for a terminal that does not say who it is
+BARE = dict(ENV)
+BARE.pop("TERM_PROGRAM")
+BARE.pop("TERM_PROGRAM_VERSION")
+TWICE = ["sh", "-c", '"$0" --termcaps && "$0" --termcaps', sys.argv[1]]
+
+
+def session(env, *answers):
+    rc, got = run(TWICE, env=env, replies=answers, session=True)
+    if rc != 0:
+        fail("--termcaps failed")
+    return got.decode("utf-8", "replace")
+
+
+got = session(BARE, ANSWER)
+if got.count("\x1b[6n") != 2 or "SmokeTerm(1.0) (probed)" not in got or "SmokeTerm(1.0) (cached)" not in got:
+    fail("a second run in the same session should use the cache: %r" % got)
+got = session(BARE, ANSWER)
+if "(probed)" not in got:
+    fail("a new session should be probed again: %r" % got)
+got = session(dict(BARE, TERM="xterm-mute"))
+if got.count("\x1b[c") != 1 or "unknown (no answer)" not in got or "unknown (cached)" not in got:
+    fail("a terminal that did not answer should not be asked again in its session: %r" % got)
+got = session(dict(BARE, TERM="xterm-anon"), re.sub(rb"\x1bP>.*?\x1b\\|\x1b\[>[\d;]*c", b"", ANSWER))
+first, second = got.split("terminal: ")[1:]
+if "rep: yes" not in first or "(cached)" not in second or "rep: no" not in second:
+    fail("REP should not be remembered for a terminal without an identity: %r" % got)
+
+term = Term([sys.argv[1], "--hidden"], 50, 200, ENV)
+if not term.until(lambda got: re.search(rb"\x1b\[\d+b", got)):
+    fail("hidden mode did not use the cached REP")
+for report in (b"\x1b[O", b"\x1b[I"):
+    term.send(report)
+    term.pump(0.1)
+    mark = len(term.got)
+    if not term.until(lambda got: len(got) > mark):
+        fail("hidden mode should keep drawing whatever the focus")
+if term.finish(b"q") != 0:
+    fail("hidden mode failed with focus reports")
+PY
+
 if [ -x "$LINUX_BIN" ]; then
     extras="$("$LINUX_BIN" -a)"
     printf '%s\n' "$extras" | grep "Memory:" >/dev/null 2>&1 || {
@@ -46,6 +373,139 @@ if [ -x "$LINUX_BIN" ]; then
         echo "error: expected Uptime line when -a with linux build" >&2
         exit 1
     }
+    printf '%s\n' "$extras" | grep "Load:.*% *; load" >/dev/null 2>&1 || {
+        echo "error: expected Load line when -a with linux build" >&2
+        exit 1
+    }
+    printf '%s\n' "$extras" | grep "Procs:.*threads.*; rss " >/dev/null 2>&1 || {
+        echo "error: expected Procs line when -a with linux build" >&2
+        exit 1
+    }
+    "$LINUX_BIN" --mounts 1 | grep "Mounts:" >/dev/null 2>&1 || {
+        echo "error: expected Mounts line with --mounts on linux build" >&2
+        exit 1
+    }
+    # Batched reads (or their fallback) must not change what is printed
+    uring_out="$(MINIFETCH_IO=uring "$LINUX_BIN" -a | grep -E 'OS:|Host:')"
+    sync_out="$("$LINUX_BIN" -a | grep -E 'OS:|Host:')"
+    if [ "$uring_out" != "$sync_out" ]; then
+        echo "error: MINIFETCH_IO=uring changed the Linux output" >&2
+        exit 1
+    fi
+    # --root and --roots-under read identity files from unpacked images
+    roots="$MINIFETCH_STATE_DIR/roots"
+    mkdir -p "$roots/alpine/etc" "$roots/debian/usr/lib" "$roots/debian/etc"
+    printf 'NAME="Alpine Linux"\nID=alpine\nVERSION_ID=3.19.1\nPRETTY_NAME="Alpine Linux v3.19"\n' \
+        >"$roots/alpine/etc/os-release"
+    echo builder >"$roots/alpine/etc/hostname"
+    printf 'PRETTY_NAME="Debian GNU/Linux 12 (bookworm)"\nID=debian\nVERSION_ID="12"\n' >"$roots/debian/usr/lib/os-release"
+    # absolute links must resolve inside the root, not on the host
+    ln -s /usr/lib/os-release "$roots/debian/etc/os-release"
+    "$LINUX_BIN" --root "$roots/alpine" | grep "OS:.*Alpine Linux v3.19" >/dev/null 2>&1 || {
+        echo "error: expected --root to read the image's os-release" >&2
+        exit 1
+    }
+    fleet_out="$("$LINUX_BIN" --roots-under "$roots" | sort)"
+    tab="$(printf '\t')"
+    expected="alpine${tab}Alpine Linux v3.19${tab}alpine${tab}3.19.1${tab}builder
+debian${tab}Debian GNU/Linux 12 (bookworm)${tab}debian${tab}12${tab}-"
+    if [ "$fleet_out" != "$expected" ]; then
+        echo "error: unexpected --roots-under records" >&2
+        exit 1
+    fi
+    # parsers against synthetic /proc and /sys trees (tools/gen_fixture.sh),
+    # which are written by python too
+    if [ -n "$have_python" ]; then
+        fixtures="$MINIFETCH_STATE_DIR/fixtures"
+        sh "$ROOT_DIR/tools/gen_fixture.sh" "$fixtures/small" small
+        sh "$ROOT_DIR/tools/gen_fixture.sh" "$fixtures/old" old
+        small_out="$(MINIFETCH_SYSROOT="$fixtures/small" "$LINUX_BIN" -a | sed 's/^.*  \([A-Z][A-Za-z /]*:\)  */\1 /')"
+        old_out="$(MINIFETCH_SYSROOT="$fixtures/old" "$LINUX_BIN" -a | sed 's/^.*  \([A-Z][A-Za-z /]*:\)  */\1 /')"
+        for want in \
+            "OS: Fixture Linux small" \
+            "Host: fixture-small" \
+            "CPU: 4" \
+            "Topology: 1 node (0: 0-3, 15.6 GiB); SMT on; L1d 48K x2, L1i 32K x2, L2 2M x2, L3 64M x1" \
+            "Disk I/O: vdb read 7.81 MiB written 3.91 MiB, vda read 3.91 MiB written 1.95 MiB (totals)" \
+            "Net: eth1 rx 1.91 MiB tx 977 KiB, eth0 rx 977 KiB tx 488 KiB (totals)" \
+            "Memory: 7.81 GiB / 15.6 GiB" \
+            "Uptime: 1d 5h 7m" \
+            "Sensors: pkg0 55°C; fan1 1200 RPM" \
+            "Procs: 200 (500 threads, 4 zombies); rss proc 200 7.81 MiB, proc 199 7.77 MiB, proc 198 7.73 MiB; cpu proc 200 14%, proc 199 14%, proc 198 14%" \
+            "Pressure: some cpu 1.25/0.50 mem 1.25/0.50 io 1.25/0.50; full cpu 0.75/0.25 mem 0.75/0.25 io 0.75/0.25"; do
+            printf '%s\n' "$small_out" | grep -Fx "$want" >/dev/null 2>&1 || {
+                echo "error: expected '$want' from the small fixture" >&2
+                exit 1
+            }
+        done
+        # 3.10-era kernel: no MemAvailable, PSI, smt/active or hwmon
+        for want in \
+            "CPU: 8" \
+            "Topology: 1 node (0: 0-7, 15.6 GiB); L1d 48K x4, L1i 32K x4, L2 2M x4, L3 64M x1" \
+            "Memory: 8.79 GiB / 15.6 GiB"; do
+            printf '%s\n' "$old_out" | grep -Fx "$want" >/dev/null 2>&1 || {
+                echo "error: expected '$want' from the old fixture" >&2
+                exit 1
+            }
+        done
+        if printf '%s\n' "$old_out" | grep -E '^(Pressure|Sensors):' >/dev/null 2>&1; then
+            echo "error: the old fixture has no PSI or hwmon" >&2
+            exit 1
+        fi
+        # Hidden mode re-collects the panel in the background: an Uptime that
+        # moves on shows up on screen without restarting
+        pty_check "$LINUX_BIN" "$fixtures/small" <<'PY'
+import os, re, sys
+from pty_harness import Term, fail, screen
+
+env = dict(os.environ, MINIFETCH_SYSROOT=sys.argv[2])
+term = Term([sys.argv[1], "--hidden", "--refresh", "1"], 30, 100, env)
+term.until(lambda got: b"Uptime:" in got)
+with open(os.path.join(sys.argv[2], "proc/uptime"), "w") as f:
+    f.write("200000.42 800000.00\n")
+bumped = term.until(lambda got: re.search(r"Uptime: +2d 7h 33m ", "\n".join(screen(got))))
+if term.finish(b"q") != 0:
+    fail("hidden mode with --refresh did not exit cleanly")
+if not bumped:
+    fail("hidden mode kept showing the uptime it started with")
+PY
+    fi
+    # A running daemon holds the snapshot; clients render the same table
+    "$LINUX_BIN" --daemon &
+    daemon_pid=$!
+    tries=0
+    while [ ! -e "/dev/shm$MINIFETCH_SHM" ] && [ "$tries" -lt 10 ]; do
+        tries=$((tries + 1))
+        sleep 1
+    done
+    if "$LINUX_BIN" --daemon 2>/dev/null; then
+        echo "error: a second --daemon should refuse to start" >&2
+        exit 1
+    fi
+    shm_out="$("$LINUX_BIN" --from-shm | grep -E 'OS:|Kernel:|Host:')"
+    direct_out="$("$LINUX_BIN" | grep -E 'OS:|Kernel:|Host:')"
+    if [ "$shm_out" != "$direct_out" ]; then
+        echo "error: expected --from-shm to match a direct run while --daemon runs" >&2
+        exit 1
+    fi
+    kill "$daemon_pid"
+    daemon_pid=""
+fi
+
+# Tiny build must match the Linux build on the fields that do not drift
+# between two runs
+if [ -x "$TINY_BIN" ] && [ -x "$LINUX_BIN" ]; then
+    drifting='Memory:|Uptime:|Disk:|Disk I/O:|Net:|Mounts:|Load:|Pressure:|Procs:|Sensors:'
+    tiny_out="$("$TINY_BIN" -a | grep -Ev "$drifting")"
+    linux_out="$("$LINUX_BIN" -a | grep -Ev "$drifting")"
+    if [ "$tiny_out" != "$linux_out" ]; then
+        echo "error: minifetch-tiny output differs from minifetch-linux" >&2
+        exit 1
+    fi
+    "$TINY_BIN" -a | grep "Uptime:" >/dev/null 2>&1 || {
+        echo "error: expected Uptime line from minifetch-tiny -a" >&2
+        exit 1
+    }
 fi
 
 echo "smoke: ok"
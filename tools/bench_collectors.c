@@ -0,0 +1,157 @@
+/* Runs every collector against the tree named by MINIFETCH_SYSROOT (see
+ * tools/gen_fixture.sh) and prints per-call latency and heap use. Built
+ * and run by `make bench`; not part of the shipped binaries.
+ *
+ *     bench_collectors [label [iterations]]
+ *
+ * The first call of each collector is a warm-up and is not counted, so
+ * the numbers are for the cached path (state kept in memory, as in
+ * --daemon and --watch). Load sleeps to reach its minimum sample age, so
+ * its wall time is mostly that sleep; cpu time covers worker threads. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core.h"
+#include "fileio.h"
+#include "linux_extras.h"
+#include "state.h"
+
+#define MF_BENCH_DEFAULT_ITERS 10U
+
+struct mf_bench_field {
+    const char *name;
+    int (*collect)(char *out, size_t outsz);
+};
+
+static const struct mf_bench_field g_bench_fields[] = {
+    { "OS",       mf_collect_os },
+    { "Kernel",   mf_collect_kernel },
+    { "Host",     mf_collect_host },
+    { "CPU",      mf_collect_cpu },
+    { "Load",     mf_collect_load },
+    { "Topology", mf_collect_topology },
+    { "Shell",    mf_collect_shell },
+    { "Disk",     mf_collect_disk },
+    { "Disk I/O", mf_collect_diskio },
+    { "Net",      mf_collect_net },
+    { "Memory",   mf_collect_mem },
+    { "Uptime",   mf_collect_uptime },
+    { "Sensors",  mf_collect_sensors },
+    { "Procs",    mf_collect_procs },
+    { "Pressure", mf_collect_pressure },
+    { "Mounts",   mf_collect_mounts }
+};
+
+static uint64_t g_allocs;
+static uint64_t g_alloc_bytes;
+
+#ifdef __GLIBC__
+/* glibc lets a program replace malloc; counting here catches the
+ * allocations made inside libc too (opendir, fdopendir, getline). */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static void mf_bench_count(size_t bytes)
+{
+    __atomic_fetch_add(&g_allocs, 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_alloc_bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    mf_bench_count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    mf_bench_count(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    mf_bench_count(size);
+    return __libc_realloc(ptr, size);
+}
+#define MF_BENCH_COUNTS_ALLOCS 1
+#else
+#define MF_BENCH_COUNTS_ALLOCS 0
+#endif
+
+static uint64_t mf_bench_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    const char *root;
+    const char *label;
+    unsigned long iters;
+    size_t i;
+
+    root = getenv("MINIFETCH_SYSROOT");
+    label = argc > 1 ? argv[1] : (root != NULL ? root : "/");
+    iters = argc > 2 ? strtoul(argv[2], NULL, 10) : MF_BENCH_DEFAULT_ITERS;
+    if (iters == 0UL) {
+        iters = MF_BENCH_DEFAULT_ITERS;
+    }
+    if (root != NULL && root[0] != '\0') {
+        int rootfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (rootfd < 0) {
+            fprintf(stderr, "bench_collectors: cannot open %s\n", root);
+            return 1;
+        }
+        mf_fileio_set_root(rootfd);
+    }
+    mf_state_use_memory();
+    mf_mounts_configure(MF_MOUNTS_TOP_DEFAULT, NULL);
+
+    printf("%s (%lu calls each)\n", label, iters);
+    printf("  %-9s %3s %12s %12s %10s %12s\n", "field", "ok", "wall us", "cpu us", "allocs", "bytes");
+    for (i = 0; i < sizeof(g_bench_fields) / sizeof(g_bench_fields[0]); ++i) {
+        const struct mf_bench_field *bf = &g_bench_fields[i];
+        char value[256];
+        uint64_t wall;
+        uint64_t cpu;
+        uint64_t allocs;
+        uint64_t bytes;
+        unsigned long n;
+        int ok;
+
+        ok = bf->collect(value, sizeof(value)) == 0;
+        allocs = __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+        bytes = __atomic_load_n(&g_alloc_bytes, __ATOMIC_RELAXED);
+        wall = mf_bench_ns(CLOCK_MONOTONIC);
+        cpu = mf_bench_ns(CLOCK_PROCESS_CPUTIME_ID);
+        for (n = 0; n < iters; ++n) {
+            ok &= bf->collect(value, sizeof(value)) == 0;
+        }
+        wall = mf_bench_ns(CLOCK_MONOTONIC) - wall;
+        cpu = mf_bench_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+        allocs = __atomic_load_n(&g_allocs, __ATOMIC_RELAXED) - allocs;
+        bytes = __atomic_load_n(&g_alloc_bytes, __ATOMIC_RELAXED) - bytes;
+
+        printf("  %-9s %3s %12.1f %12.1f", bf->name, ok ? "yes" : "no", (double)wall / 1000.0 / (double)iters,
+               (double)cpu / 1000.0 / (double)iters);
+        if (MF_BENCH_COUNTS_ALLOCS) {
+            printf(" %10.1f %12.0f\n", (double)allocs / (double)iters, (double)bytes / (double)iters);
+        } else {
+            printf(" %10s %12s\n", "-", "-");
+        }
+    }
+    return 0;
+}
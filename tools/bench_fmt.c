@@ -0,0 +1,268 @@
+/* Checks the integer formatters in fmt.c against the snprintf code they
+ * replaced and times both. Built and run by `make bench-fmt`; not part
+ * of the shipped binaries.
+ *
+ *     bench_fmt [inputs [rounds]]
+ *
+ * Every input is formatted both ways and compared byte for byte; any
+ * difference is printed and makes the exit status 1. Byte counts stay
+ * below 2^53, where the historical double path was exact. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fmt.h"
+
+#define MF_BENCH_DEFAULT_INPUTS 100000UL
+#define MF_BENCH_DEFAULT_ROUNDS 20UL
+#define MF_BENCH_MAX_BYTES ((1ULL << 53) - 1U)
+#define MF_BENCH_MAX_SECONDS (1ULL << 40)
+
+enum mf_bench_kind {
+    MF_BENCH_BYTES = 0,
+    MF_BENCH_PERCENT = 1,
+    MF_BENCH_DURATION = 2
+};
+
+struct mf_bench_input {
+    uint64_t a;
+    uint64_t b;
+};
+
+static const char *const g_bench_names[] = { "bytes", "percent", "duration" };
+
+static uint64_t g_rng = 0x9e3779b97f4a7c15ULL;
+
+/* Keeps the formatted text observable so the loops are not elided. */
+static volatile char g_sink;
+
+static uint64_t mf_bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift64*: the same inputs on every run. */
+static uint64_t mf_bench_rand(void)
+{
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return g_rng * 0x2545f4914f6cdd1dULL;
+}
+
+/* Random magnitude first, so small values are as common as large ones. */
+static uint64_t mf_bench_rand_below(uint64_t limit)
+{
+    uint64_t v;
+
+    v = mf_bench_rand() >> (mf_bench_rand() % 64U);
+    return v % (limit + 1U);
+}
+
+/* The historical mf_format_bytes from term.c. */
+static void mf_ref_bytes(uint64_t n, char *out, size_t outsz)
+{
+    static const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB", "PiB" };
+    int unit_index;
+    double value;
+
+    value = (double)n;
+    unit_index = 0;
+    while (value >= 1024.0 && unit_index < (int)(sizeof(units) / sizeof(units[0]) - 1U)) {
+        value /= 1024.0;
+        unit_index++;
+    }
+
+    if (value >= 100.0) {
+        snprintf(out, outsz, "%.0f %s", value, units[unit_index]);
+    } else if (value >= 10.0) {
+        snprintf(out, outsz, "%.1f %s", value, units[unit_index]);
+    } else {
+        snprintf(out, outsz, "%.2f %s", value, units[unit_index]);
+    }
+}
+
+/* The historical percentage from mf_collect_disk. */
+static void mf_ref_percent(uint64_t part, uint64_t whole, char *out, size_t outsz)
+{
+    snprintf(out, outsz, "%.0f%%", ((double)part / (double)whole) * 100.0);
+}
+
+/* The historical mf_collect_uptime formatting. */
+static void mf_ref_duration(uint64_t seconds, char *out, size_t outsz)
+{
+    long total_minutes;
+    long days;
+    long hours;
+    long minutes;
+
+    total_minutes = (long)((double)seconds / 60.0);
+    days = total_minutes / (60 * 24);
+    total_minutes -= days * 60 * 24;
+    hours = total_minutes / 60;
+    minutes = total_minutes - hours * 60;
+
+    if (days > 0) {
+        snprintf(out, outsz, "%ldd %ldh %ldm", days, hours, minutes);
+    } else if (hours > 0) {
+        snprintf(out, outsz, "%ldh %ldm", hours, minutes);
+    } else {
+        snprintf(out, outsz, "%ldm", minutes);
+    }
+}
+
+static void mf_bench_ref(int kind, const struct mf_bench_input *in, char *out, size_t outsz)
+{
+    switch (kind) {
+    case MF_BENCH_BYTES:
+        mf_ref_bytes(in->a, out, outsz);
+        break;
+    case MF_BENCH_PERCENT:
+        mf_ref_percent(in->a, in->b, out, outsz);
+        break;
+    default:
+        mf_ref_duration(in->a, out, outsz);
+        break;
+    }
+}
+
+static void mf_bench_fmt(int kind, const struct mf_bench_input *in, char *out, size_t outsz)
+{
+    struct mf_fmt f;
+
+    mf_fmt_init(&f, out, outsz);
+    switch (kind) {
+    case MF_BENCH_BYTES:
+        mf_fmt_bytes(&f, in->a);
+        break;
+    case MF_BENCH_PERCENT:
+        mf_fmt_percent(&f, in->a, in->b);
+        break;
+    default:
+        mf_fmt_duration(&f, in->a);
+        break;
+    }
+}
+
+static void mf_bench_fill(int kind, struct mf_bench_input *in, unsigned long count)
+{
+    unsigned long i;
+
+    for (i = 0; i < count; ++i) {
+        switch (kind) {
+        case MF_BENCH_BYTES:
+            in[i].a = mf_bench_rand_below(MF_BENCH_MAX_BYTES);
+            in[i].b = 0U;
+            break;
+        case MF_BENCH_PERCENT:
+            in[i].b = mf_bench_rand_below(MF_BENCH_MAX_BYTES - 1U) + 1U;
+            in[i].a = mf_bench_rand() % (in[i].b + 1U);
+            break;
+        default:
+            in[i].a = mf_bench_rand_below(MF_BENCH_MAX_SECONDS);
+            in[i].b = 0U;
+            break;
+        }
+    }
+    if (kind == MF_BENCH_BYTES && count >= 4U) {
+        /* The precision and unit steps, where rounding is tightest. */
+        in[0].a = 0U;
+        in[1].a = 1023U;
+        in[2].a = 10239U;
+        in[3].a = 102399U;
+    }
+}
+
+static unsigned long mf_bench_check(int kind, const struct mf_bench_input *in, unsigned long count)
+{
+    char want[64];
+    char got[64];
+    unsigned long bad;
+    unsigned long i;
+
+    bad = 0U;
+    for (i = 0; i < count; ++i) {
+        mf_bench_ref(kind, &in[i], want, sizeof(want));
+        mf_bench_fmt(kind, &in[i], got, sizeof(got));
+        if (strcmp(want, got) != 0) {
+            if (bad < 10U) {
+                fprintf(stderr, "bench_fmt: %s %llu/%llu: snprintf \"%s\", fmt \"%s\"\n", g_bench_names[kind],
+                        (unsigned long long)in[i].a, (unsigned long long)in[i].b, want, got);
+            }
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/* Best of rounds, in ns per call: the minimum is the least noisy. */
+static double mf_bench_time(int kind, const struct mf_bench_input *in, unsigned long count, unsigned long rounds,
+                            void (*format)(int, const struct mf_bench_input *, char *, size_t))
+{
+    char out[64];
+    uint64_t best;
+    unsigned long r;
+    unsigned long i;
+
+    best = UINT64_MAX;
+    for (r = 0; r < rounds; ++r) {
+        uint64_t t;
+
+        t = mf_bench_ns();
+        for (i = 0; i < count; ++i) {
+            format(kind, &in[i], out, sizeof(out));
+            g_sink = out[0];
+        }
+        t = mf_bench_ns() - t;
+        if (t < best) {
+            best = t;
+        }
+    }
+    return (double)best / (double)count;
+}
+
+int main(int argc, char **argv)
+{
+    struct mf_bench_input *in;
+    unsigned long count;
+    unsigned long rounds;
+    unsigned long bad;
+    int kind;
+
+    count = argc > 1 ? strtoul(argv[1], NULL, 10) : MF_BENCH_DEFAULT_INPUTS;
+    rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : MF_BENCH_DEFAULT_ROUNDS;
+    if (count == 0UL) {
+        count = MF_BENCH_DEFAULT_INPUTS;
+    }
+    if (rounds == 0UL) {
+        rounds = MF_BENCH_DEFAULT_ROUNDS;
+    }
+    in = (struct mf_bench_input *)malloc(count * sizeof(*in));
+    if (in == NULL) {
+        fprintf(stderr, "bench_fmt: out of memory\n");
+        return 1;
+    }
+
+    printf("%lu inputs each, best of %lu rounds\n", count, rounds);
+    printf("  %-9s %10s %12s %12s\n", "kind", "mismatch", "snprintf ns", "fmt ns");
+    bad = 0U;
+    for (kind = MF_BENCH_BYTES; kind <= MF_BENCH_DURATION; ++kind) {
+        unsigned long kind_bad;
+
+        mf_bench_fill(kind, in, count);
+        kind_bad = mf_bench_check(kind, in, count);
+        printf("  %-9s %10lu %12.1f %12.1f\n", g_bench_names[kind], kind_bad,
+               mf_bench_time(kind, in, count, rounds, mf_bench_ref), mf_bench_time(kind, in, count, rounds, mf_bench_fmt));
+        bad += kind_bad;
+    }
+
+    free(in);
+    return bad == 0U ? 0 : 1;
+}
@@ -12,13 +12,16 @@ outdir="$(dirname "$output")"
 
 mkdir -p "$outdir"
 
+tools="$(cd "$(dirname "$0")" && pwd)"
 tmp="$(mktemp)"
 trap 'rm -f "$tmp"' EXIT
 
-python3 - "$input" "$tmp" <<'PY'
+PYTHONPATH="$tools" python3 - "$input" "$tmp" <<'PY'
 import sys
 from pathlib import Path
 
+from mf_wcwidth import Widths
+
 if len(sys.argv) != 3:
     sys.exit("expected input and output paths")
 
@@ -47,9 +50,11 @@ def escape(line: str) -> str:
 
 
 def logo_width(lines):
+    # The widths term.c measures the lines with at run time.
+    widths = Widths()
     width = 0
     for line in lines:
-        length = len(line)
+        length = widths.text(line)
         if length > width:
             width = length
     return width
@@ -0,0 +1,167 @@
+#!/bin/sh
+set -eu
+
+# Writes a synthetic /proc and /sys tree for the Linux collectors. Point
+# a Linux build at it with MINIFETCH_SYSROOT=<outdir> (or --root). The
+# contents are deterministic so tests can check the parsed values.
+#
+# Presets:
+#   small   4 CPUs, 20 mounts, 200 PIDs
+#   medium  128 CPUs on 2 nodes, 1000 mounts, 5000 PIDs
+#   huge    1024 CPUs on 8 nodes, 10000 mounts, 200000 PIDs
+#   old     8 CPUs and a 3.10-era kernel: no MemAvailable, no PSI, no
+#           smt/active, no hwmon
+
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <outdir> <small|medium|huge|old>" >&2
+    exit 1
+fi
+
+outdir="$1"
+preset="$2"
+
+case "$preset" in
+    small|medium|huge|old) ;;
+    *)
+        echo "error: unknown preset '$preset'" >&2
+        exit 1
+        ;;
+esac
+
+rm -rf "$outdir"
+mkdir -p "$outdir"
+
+python3 - "$outdir" "$preset" <<'PY'
+import os
+import sys
+
+root, preset = sys.argv[1], sys.argv[2]
+
+PRESETS = {
+    #         cpus  nodes mounts  pids    disks nics
+    "small":  (4,    1,    20,     200,    2,    2),
+    "medium": (128,  2,    1000,   5000,   16,   8),
+    "huge":   (1024, 8,    10000,  200000, 64,   64),
+    "old":    (8,    1,    20,     200,    2,    2),
+}
+cpus, nodes, mounts, pids, disks, nics = PRESETS[preset]
+old = preset == "old"
+MEM_KIB = 16384000 * nodes
+UPTIME = 86400 + 3600 * 5 + 60 * 7
+
+
+def put(rel, text):
+    path = os.path.join(root, rel)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def cpulist(first, last):
+    return "%d-%d" % (first, last) if last > first else "%d" % first
+
+
+# Identity
+put("etc/os-release",
+    'PRETTY_NAME="Fixture Linux %s"\nNAME="Fixture Linux"\nID=fixture\nVERSION_ID="1.0"\n' % preset)
+put("etc/hostname", "fixture-%s\n" % preset)
+put("proc/sys/kernel/random/boot_id", "00000000-0000-4000-8000-%012d\n" % cpus)
+
+# Memory: 3.10 and older have no MemAvailable; the collector falls back
+# to MemFree + Buffers + Cached.
+meminfo = ["MemTotal:       %d kB" % MEM_KIB, "MemFree:        %d kB" % (MEM_KIB // 4)]
+if not old:
+    meminfo.append("MemAvailable:   %d kB" % (MEM_KIB // 2))
+meminfo += ["Buffers:        %d kB" % (MEM_KIB // 16), "Cached:         %d kB" % (MEM_KIB // 8),
+            "SwapCached:            0 kB", "SwapTotal:             0 kB", "SwapFree:              0 kB"]
+put("proc/meminfo", "\n".join(meminfo) + "\n")
+put("proc/uptime", "%d.42 %d.00\n" % (UPTIME, UPTIME * cpus))
+put("proc/loadavg", "%d.50 %d.25 %d.00 3/%d %d\n" % (cpus // 4, cpus // 4, cpus // 4, pids, pids))
+
+# /proc/stat: aggregate line, one line per CPU, then the usual tail
+lines = ["cpu  %d 0 %d %d 0 0 0 0 0 0" % (1000 * cpus, 500 * cpus, 8500 * cpus)]
+for c in range(cpus):
+    lines.append("cpu%d 1000 0 500 8500 0 0 0 0 0 0" % c)
+lines += ["intr 0", "ctxt 123456", "btime 1700000000", "processes %d" % pids,
+          "procs_running 3", "procs_blocked 0", "softirq 0"]
+put("proc/stat", "\n".join(lines) + "\n")
+
+if not old:
+    for res in ("cpu", "memory", "io"):
+        put("proc/pressure/" + res,
+            "some avg10=1.25 avg60=0.50 avg300=0.10 total=1000\n"
+            "full avg10=0.75 avg60=0.25 avg300=0.05 total=500\n")
+
+put("proc/self/cgroup", "0::/\n")
+put("sys/fs/cgroup/cgroup.controllers", "cpu memory io\n")
+
+# Processes: every 50th is a zombie; RSS grows with the PID, CPU time
+# with the PID modulo 1000
+for pid in range(1, pids + 1):
+    state = "Z" if pid % 50 == 0 else "S"
+    fields = [state, "1", str(pid), str(pid), "0", "-1", "4194304", "0", "0", "0", "0",
+              str(5000 * (pid % 1000)), str(2500 * (pid % 1000)), "0", "0", "20", "0", str(1 + pid % 4), "0", "100",
+              str(4096 * pid), str(10 * pid)]
+    put("proc/%d/stat" % pid, "%d (proc %d) %s\n" % (pid, pid, " ".join(fields)))
+
+# Mounts: one ext4 filesystem per mount point, all inside the fixture so
+# --root statvfs finds them
+mi = ["1 0 253:0 / / rw,relatime - ext4 /dev/vda1 rw",
+      "2 1 0:22 / /proc rw,relatime - proc proc rw",
+      "3 1 0:23 / /sys rw,relatime - sysfs sysfs rw"]
+for m in range(mounts - 1):
+    os.makedirs(os.path.join(root, "mnt/v%d" % m), exist_ok=True)
+    mi.append("%d 1 254:%d / /mnt/v%d rw,relatime - ext4 /dev/vdb%d rw" % (m + 4, m, m, m))
+put("proc/self/mountinfo", "\n".join(mi) + "\n")
+
+# Block devices and network interfaces
+ds = []
+for d in range(disks):
+    name = "vd" + chr(ord("a") + d % 26) + ("" if d < 26 else str(d // 26))
+    os.makedirs(os.path.join(root, "sys/block", name), exist_ok=True)
+    ds.append("%4d %7d %s %d 0 %d 0 %d 0 %d 0 0 0 0" % (253, d * 16, name, 1000 * (d + 1), 8000 * (d + 1),
+                                                      500 * (d + 1), 4000 * (d + 1)))
+    ds.append("%4d %7d %s1 10 0 80 0 5 0 40 0 0 0 0" % (253, d * 16 + 1, name))
+ds.append("   7       0 loop0 1 0 8 0 0 0 0 0 0 0 0")
+put("proc/diskstats", "\n".join(ds) + "\n")
+
+nd = ["Inter-|   Receive                                                |  Transmit",
+      " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed",
+      "    lo: 1000 10 0 0 0 0 0 0 1000 10 0 0 0 0 0 0"]
+for n in range(nics):
+    nd.append("  eth%d: %d 100 0 0 0 0 0 0 %d 50 0 0 0 0 0 0" % (n, 1000000 * (n + 1), 500000 * (n + 1)))
+put("proc/net/dev", "\n".join(nd) + "\n")
+
+# Topology: SMT pairs, per-core L1/L2, one L3 per node
+sysd = "sys/devices/system/"
+per_node = cpus // nodes
+put(sysd + "cpu/online", cpulist(0, cpus - 1) + "\n")
+put(sysd + "cpu/possible", cpulist(0, cpus - 1) + "\n")
+if not old:
+    put(sysd + "cpu/smt/active", "1\n")
+put(sysd + "node/online", cpulist(0, nodes - 1) + "\n")
+for n in range(nodes):
+    put(sysd + "node/node%d/cpulist" % n, cpulist(n * per_node, (n + 1) * per_node - 1) + "\n")
+    put(sysd + "node/node%d/meminfo" % n, "Node %d MemTotal:       16384000 kB\nNode %d MemFree:        8192000 kB\n" % (n, n))
+caches = [(1, "Data", "48K"), (1, "Instruction", "32K"), (2, "Unified", "2048K"), (3, "Unified", "65536K")]
+for c in range(cpus):
+    pair = c - c % 2
+    node = c // per_node
+    for i, (level, kind, size) in enumerate(caches):
+        base = sysd + "cpu/cpu%d/cache/index%d/" % (c, i)
+        shared = cpulist(pair, pair + 1) if level < 3 else cpulist(node * per_node, (node + 1) * per_node - 1)
+        put(base + "level", "%d\n" % level)
+        put(base + "type", kind + "\n")
+        put(base + "size", size + "\n")
+        put(base + "shared_cpu_list", shared + "\n")
+    put(sysd + "cpu/cpufreq/policy%d/scaling_cur_freq" % c, "2400000\n")
+
+# Sensors: one coretemp package per node and a fan controller
+if not old:
+    put("sys/class/hwmon/hwmon0/name", "coretemp\n")
+    for n in range(nodes):
+        put("sys/class/hwmon/hwmon0/temp%d_label" % (n * 8 + 1), "Package id %d\n" % n)
+        put("sys/class/hwmon/hwmon0/temp%d_input" % (n * 8 + 1), "%d\n" % (55000 + 1000 * n))
+    put("sys/class/hwmon/hwmon1/name", "nct6775\n")
+    put("sys/class/hwmon/hwmon1/fan1_input", "1200\n")
+PY
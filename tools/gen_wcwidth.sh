@@ -0,0 +1,74 @@
+#!/bin/sh
+set -eu
+
+tools="$(cd "$(dirname "$0")" && pwd)"
+
+# --ranges regenerates tools/wcwidth_ranges.txt from this python's
+# unicodedata, which must be the version tools/mf_wcwidth.py pins.
+if [ "$#" -eq 1 ] && [ "$1" = "--ranges" ]; then
+    PYTHONPATH="$tools" exec python3 -c 'import mf_wcwidth; mf_wcwidth.write_ranges()'
+fi
+
+if [ "$#" -ne 1 ]; then
+    echo "Usage: $0 <output.c> | --ranges" >&2
+    exit 1
+fi
+
+output="$1"
+outdir="$(dirname "$output")"
+
+mkdir -p "$outdir"
+
+tmp="$(mktemp)"
+trap 'rm -f "$tmp"' EXIT
+
+PYTHONPATH="$tools" python3 - "$tmp" <<'PY'
+import sys
+from pathlib import Path
+
+from mf_wcwidth import MAX_CP, Widths
+
+if len(sys.argv) != 2:
+    sys.exit("expected output path")
+
+out_path = Path(sys.argv[1])
+widths = Widths()
+
+BLOCK = 256
+
+
+blocks = []
+block_index = {}
+stage1 = []
+
+for base in range(0, MAX_CP, BLOCK):
+    packed = bytearray(BLOCK // 4)
+    for off in range(BLOCK):
+        packed[off >> 2] |= widths.width(base + off) << ((off & 3) * 2)
+    key = bytes(packed)
+    if key not in block_index:
+        block_index[key] = len(blocks)
+        blocks.append(key)
+    stage1.append(block_index[key])
+
+if len(blocks) > 256:
+    sys.exit("width table has too many distinct blocks for an 8-bit index")
+
+with out_path.open("w", encoding="utf-8") as f:
+    f.write('/* Generated by tools/gen_wcwidth.sh from Unicode '
+            + widths.version + '; do not edit. */\n')
+    f.write('#include "wcwidth_table.h"\n\n')
+    f.write('const unsigned char g_wcwidth_stage1[MF_WCWIDTH_STAGE1_LEN] = {\n')
+    for i in range(0, len(stage1), 16):
+        f.write('    ' + ', '.join(str(v) for v in stage1[i:i + 16]) + ',\n')
+    f.write('};\n\n')
+    f.write('const unsigned char g_wcwidth_stage2[][MF_WCWIDTH_BLOCK_BYTES] = {\n')
+    for blk in blocks:
+        f.write('    {\n')
+        for i in range(0, len(blk), 16):
+            f.write('        ' + ', '.join('0x{:02x}'.format(v) for v in blk[i:i + 16]) + ',\n')
+        f.write('    },\n')
+    f.write('};\n')
+PY
+
+mv "$tmp" "$output"
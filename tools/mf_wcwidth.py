@@ -0,0 +1,102 @@
+"""Display widths shared by gen_wcwidth.sh (the table term.c looks up)
+and embed_logo.sh (the logo's width), so the two can never disagree.
+
+The widths come from tools/wcwidth_ranges.txt, generated from one pinned
+Unicode version; which host python builds the tree does not matter.
+Run "sh tools/gen_wcwidth.sh --ranges" with a python of that version to
+regenerate it after changing the rules below.
+"""
+import bisect
+import os
+
+UNICODE_VERSION = "14.0.0"
+RANGES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "wcwidth_ranges.txt")
+MAX_CP = 0x110000
+
+
+def rule(cp):
+    """Width of cp by the rules, from the host's unicodedata."""
+    import unicodedata
+
+    # ASCII is handled by the fast path in term.c; keep it at one column
+    # so the table and the fast path always agree.
+    if cp < 0x80:
+        return 1
+    if cp < 0xA0:
+        return 0
+    ch = chr(cp)
+    cat = unicodedata.category(ch)
+    if cat in ("Mn", "Me"):
+        return 0
+    if cat == "Cf" and cp != 0x00AD:
+        return 0
+    if 0x1160 <= cp <= 0x11FF or 0xD7B0 <= cp <= 0xD7FF:
+        # Hangul medial vowels and final consonants combine with the
+        # preceding leading jamo.
+        return 0
+    if cp == 0x200B:
+        return 0
+    if cat == "Cs":
+        return 1
+    if cat == "Cn":
+        # unicodedata calls every unassigned code point full-width;
+        # EastAsianWidth.txt only reserves the CJK blocks and planes 2-3.
+        wide = (0x3400 <= cp <= 0x4DBF or 0x4E00 <= cp <= 0x9FFF or 0xF900 <= cp <= 0xFAFF or
+                0x20000 <= cp <= 0x2FFFD or 0x30000 <= cp <= 0x3FFFD)
+        return 2 if wide else 1
+    if unicodedata.east_asian_width(ch) in ("W", "F"):
+        return 2
+    return 1
+
+
+def write_ranges(path=RANGES):
+    """Regenerates the ranges file; the host must have the pinned version."""
+    import unicodedata
+
+    if unicodedata.unidata_version != UNICODE_VERSION:
+        raise SystemExit("wcwidth: python has Unicode %s, the table is pinned to %s"
+                         % (unicodedata.unidata_version, UNICODE_VERSION))
+    runs = []
+    for cp in range(MAX_CP):
+        w = rule(cp)
+        if w == 1:
+            continue
+        if runs and runs[-1][1] == cp - 1 and runs[-1][2] == w:
+            runs[-1][1] = cp
+        else:
+            runs.append([cp, cp, w])
+    with open(path, "w", encoding="ascii") as f:
+        f.write("# Display widths other than 1, from Unicode %s by tools/mf_wcwidth.py;\n" % UNICODE_VERSION)
+        f.write("# regenerate with: sh tools/gen_wcwidth.sh --ranges\n")
+        for first, last, w in runs:
+            f.write("%04X..%04X %d\n" % (first, last, w))
+
+
+class Widths:
+    """The widths in the ranges file."""
+
+    def __init__(self, path=RANGES):
+        self.firsts = []
+        self.runs = []
+        self.version = None
+        with open(path, encoding="ascii") as f:
+            for line in f:
+                if line.startswith("#"):
+                    if self.version is None and " Unicode " in line:
+                        self.version = line.split(" Unicode ", 1)[1].split()[0].rstrip(";")
+                    continue
+                span, w = line.split()
+                first, last = span.split("..")
+                self.firsts.append(int(first, 16))
+                self.runs.append((int(last, 16), int(w)))
+        if self.version != UNICODE_VERSION:
+            raise SystemExit("wcwidth: %s is not from Unicode %s" % (path, UNICODE_VERSION))
+
+    def width(self, cp):
+        i = bisect.bisect_right(self.firsts, cp) - 1
+        if i >= 0 and cp <= self.runs[i][0]:
+            return self.runs[i][1]
+        return 1
+
+    def text(self, s):
+        return sum(self.width(ord(ch)) for ch in s)